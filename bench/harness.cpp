@@ -0,0 +1,251 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <stdexcept>
+#include <string_view>
+
+#include "harness.hpp"
+
+namespace bench {
+namespace {
+std::string escape(std::string_view s) {
+  std::string escaped;
+  for (const auto c : s) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+
+  return escaped;
+}
+
+std::string unescape(std::string_view s) {
+  std::string unescaped;
+  for (size_t i = 0; i < s.size(); ++i) {
+    if (s[i] == '\\' && i + 1 < s.size()) {
+      ++i;
+    }
+    unescaped += s[i];
+  }
+
+  return unescaped;
+}
+} // namespace
+
+Harness::Harness(HarnessSettings s)
+    : settings{s}, VK{{
+                       .windowing = false,
+                       // no layer overhead, ORPHEE_VK_PROFILE overrides it
+                       .profile = orphee::InstanceProfile::eRelease,
+                   }} {
+  auto dR = VK.createDevice({
+      .tag = "main",
+      .count = 1,
+      .capabilities = {vk::QueueFlagBits::eCompute},
+  });
+  if (!dR) {
+    throw std::runtime_error("Failed to create device");
+  }
+  D = std::move(*dR);
+
+  Q = D.queues.at("main0").get();
+  // CMD
+  CP = D.h.createCommandPool(
+      {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, Q->fIdx});
+
+  CMD = std::move(
+      D.h.allocateCommandBuffers({CP, vk::CommandBufferLevel::ePrimary, 1})
+          .front());
+  // SYNC
+  vk::SemaphoreTypeCreateInfo semaphoreTypeInfo{vk::SemaphoreType::eTimeline,
+                                                0};
+  timelineSemaphore = D.h.createSemaphore({{}, &semaphoreTypeInfo});
+  // without timestamps on the queue runs are timed on the host
+  const auto families = D.physical.getQueueFamilyProperties();
+  if (families.at(Q->fIdx).timestampValidBits != 0) {
+    timestamps = D.h.createQueryPool({{}, vk::QueryType::eTimestamp, 2});
+    timestampPeriod = D.physical.getProperties().limits.timestampPeriod;
+  }
+}
+
+Harness::~Harness() { D.h.waitIdle(); }
+
+void Harness::submit(const Record &r) {
+  record(r);
+  submit();
+}
+
+void Harness::submit() {
+  vk::CommandBufferSubmitInfo cmdSubmit{*CMD};
+  vk::SemaphoreSubmitInfo signalSemaphore{timelineSemaphore, ++timeline, {},
+                                          {}};
+  vk::SubmitInfo2 info{{}, {}, cmdSubmit, signalSemaphore};
+  Q->h.submit2(info);
+
+  std::array<uint64_t, 1> waitValue{timeline};
+  const auto wR =
+      D.h.waitSemaphores({{}, *timelineSemaphore, waitValue}, UINT64_MAX);
+  if (wR != vk::Result::eSuccess) {
+    throw std::runtime_error("Failed to wait for semaphore");
+  }
+}
+
+double Harness::gpu(const Record &r) {
+  return measure([&] {
+    record([&](const vk::raii::CommandBuffer &cmd) {
+      if (*timestamps) {
+        cmd.resetQueryPool(timestamps, 0, 2);
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands,
+                            timestamps, 0);
+      }
+      r(cmd);
+      if (*timestamps) {
+        cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands,
+                            timestamps, 1);
+      }
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    submit();
+    if (!*timestamps) {
+      return std::chrono::duration<double, std::milli>(
+                 std::chrono::steady_clock::now() - start)
+          .count();
+    }
+
+    const auto [qR, ticks] = timestamps.getResults<uint64_t>(
+        0, 2, 2 * sizeof(uint64_t), sizeof(uint64_t),
+        vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+    if (qR != vk::Result::eSuccess) {
+      throw std::runtime_error("Failed to read timestamps");
+    }
+    return static_cast<double>(ticks[1] - ticks[0]) * timestampPeriod * 1e-6;
+  });
+}
+
+double Harness::host(const std::function<void()> &fn) {
+  return measure([&] {
+    const auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(
+               std::chrono::steady_clock::now() - start)
+        .count();
+  });
+}
+
+double Harness::recording(const Record &r) {
+  return measure([&] {
+    CMD.begin({});
+    const auto start = std::chrono::steady_clock::now();
+    r(CMD);
+    const auto ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    CMD.end();
+
+    submit();
+    return ms;
+  });
+}
+
+std::string Harness::deviceName() const {
+  return D.physical.getProperties().deviceName.data();
+}
+
+double Harness::measure(const std::function<double()> &sample) const {
+  std::vector<double> samples;
+  for (uint32_t i = 0; i < settings.warmup + settings.iterations; ++i) {
+    const auto ms = sample();
+    if (i >= settings.warmup) {
+      samples.push_back(ms);
+    }
+  }
+
+  const auto median = samples.begin() + samples.size() / 2;
+  std::nth_element(samples.begin(), median, samples.end());
+
+  return *median;
+}
+
+void Harness::record(const Record &r) {
+  // no one time submit flag, submit() may replay the commands
+  CMD.begin({});
+  r(CMD);
+  CMD.end();
+}
+
+void save(const std::filesystem::path &file, const std::string &device,
+          const std::vector<Result> &results) {
+  std::ofstream out{file, std::ios::trunc};
+  out << std::setprecision(6);
+  out << "{\n  \"device\": \"" << escape(device)
+      << "\",\n  \"results\": [\n";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const auto &r = results[i];
+    out << "    {\"name\": \"" << escape(r.name)
+        << "\", \"value\": " << r.value << ", \"unit\": \""
+        << escape(r.unit) << "\", \"higherIsBetter\": "
+        << (r.higherIsBetter ? "true" : "false") << "}"
+        << (i + 1 < results.size() ? ",\n" : "\n");
+  }
+  out << "  ]\n}\n";
+
+  if (!out) {
+    throw std::runtime_error("Failed to write " + file.string());
+  }
+}
+
+std::map<std::string, double> loadBaseline(const std::filesystem::path &file) {
+  std::ifstream in{file};
+  if (!in) {
+    throw std::runtime_error("Failed to read " + file.string());
+  }
+
+  // save writes one result per line, no general JSON parsing needed
+  const std::regex entry{
+      R"re("name": "((?:[^"\\]|\\.)+)", "value": ([^,]+),)re"};
+  std::map<std::string, double> baseline;
+  for (std::string line; std::getline(in, line);) {
+    std::smatch m;
+    if (std::regex_search(line, m, entry)) {
+      baseline[unescape(m[1].str())] = std::stod(m[2].str());
+    }
+  }
+
+  return baseline;
+}
+
+uint32_t compare(const std::vector<Result> &results,
+                 const std::map<std::string, double> &baseline,
+                 double tolerance) {
+  uint32_t regressions = 0;
+  std::cout << std::fixed << std::setprecision(3);
+  for (const auto &r : results) {
+    std::cout << std::left << std::setw(28) << r.name << std::right
+              << std::setw(14) << r.value << ' ' << r.unit;
+
+    const auto it = baseline.find(r.name);
+    if (it == baseline.end()) {
+      std::cout << "  (new)\n";
+      continue;
+    }
+
+    const auto base = it->second;
+    const auto change = base != 0.0 ? (r.value - base) / base : 0.0;
+    const auto regressed =
+        r.higherIsBetter ? change < -tolerance : change > tolerance;
+    regressions += regressed ? 1 : 0;
+    std::cout << "  baseline " << base << ' ' << std::showpos
+              << change * 100.0 << '%' << std::noshowpos
+              << (regressed ? "  REGRESSION\n" : "\n");
+  }
+  std::cout.unsetf(std::ios::fixed);
+
+  return regressions;
+}
+} // namespace bench
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <orphee/orphee.hpp>
+
+namespace bench {
+struct Result {
+  std::string name;
+  double value;
+  std::string unit;
+  // a regression is a drop when true and a rise otherwise
+  bool higherIsBetter;
+};
+
+struct HarnessSettings {
+  uint32_t warmup = 2;
+  // the median run is kept
+  uint32_t iterations = 10;
+};
+
+// Headless compute device with a single command buffer. Benchmarks record
+// into it and every submission is waited for, so nothing overlaps between
+// runs.
+struct Harness {
+  using Record = std::function<void(const vk::raii::CommandBuffer &cmd)>;
+
+  explicit Harness(HarnessSettings s = {});
+
+  Harness(const Harness &) = delete;
+
+  Harness &operator=(const Harness &) = delete;
+
+  ~Harness();
+
+  // records and submits once
+  void submit(const Record &record);
+
+  // submits the last recorded commands again
+  void submit();
+
+  // milliseconds between timestamps around the recorded commands, the host
+  // time of the submission when the queue has no timestamps
+  [[nodiscard]] double gpu(const Record &record);
+
+  // host milliseconds of fn
+  [[nodiscard]] double host(const std::function<void()> &fn);
+
+  // host milliseconds spent recording, the commands are then submitted
+  [[nodiscard]] double recording(const Record &record);
+
+  [[nodiscard]] std::string deviceName() const;
+
+  HarnessSettings settings;
+  // Vulkan
+  orphee::vkManager VK;
+  orphee::Device D;
+  orphee::Queue *Q{};
+
+private:
+  // median of the samples
+  [[nodiscard]] double measure(const std::function<double()> &sample) const;
+
+  void record(const Record &record);
+
+  /* CMD */
+  vk::raii::CommandPool CP{nullptr};
+  vk::raii::CommandBuffer CMD{nullptr};
+  /* SYNC */
+  vk::raii::Semaphore timelineSemaphore{nullptr};
+  uint64_t timeline = 0;
+  /* timestamps */
+  vk::raii::QueryPool timestamps{nullptr};
+  double timestampPeriod{};
+};
+
+// {"device": ..., "results": [...]}, one result per line
+void save(const std::filesystem::path &file, const std::string &device,
+          const std::vector<Result> &results);
+
+// values by name of a file written by save
+[[nodiscard]] std::map<std::string, double>
+loadBaseline(const std::filesystem::path &file);
+
+// Prints every result against the baseline and returns the number of
+// results worse than it by more than tolerance, a fraction of the baseline.
+// Results missing from the baseline are reported but never regress.
+uint32_t compare(const std::vector<Result> &results,
+                 const std::map<std::string, double> &baseline,
+                 double tolerance);
+} // namespace bench
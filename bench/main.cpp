@@ -0,0 +1,477 @@
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <orphee/orphee.hpp>
+#include <orphee/shaders.hpp>
+
+#include "harness.hpp"
+
+using bench::Harness;
+using bench::Result;
+
+constexpr vk::DeviceSize COPY_SIZE = 64 << 20;
+constexpr uint32_t IMAGE_SIZE = 2048;
+// dispatches of a single workgroup per run
+constexpr uint32_t DISPATCHES = 1024;
+// local size of descriptorBench and addressBench
+constexpr uint32_t GROUP_SIZE = 64;
+constexpr uint32_t GRID_SIZE = 4096;
+constexpr uint32_t STENCIL_STEPS = 8;
+
+// mirrors the push constants of heatTransfer
+struct HTArgs {
+  vk::DeviceAddress current;
+  vk::DeviceAddress target;
+  uint32_t width;
+  uint32_t height;
+  float minTemperature;
+  float maxTemperature;
+};
+
+double gbps(vk::DeviceSize bytes, double ms) {
+  return static_cast<double>(bytes) / (ms * 1e6);
+}
+
+// per item, in microseconds
+double each(double ms, uint32_t count) { return ms * 1e3 / count; }
+
+vk::MemoryBarrier2 computeBarrier() {
+  return {vk::PipelineStageFlagBits2::eComputeShader,
+          vk::AccessFlagBits2::eShaderStorageWrite,
+          vk::PipelineStageFlagBits2::eComputeShader,
+          vk::AccessFlagBits2::eShaderStorageRead |
+              vk::AccessFlagBits2::eShaderStorageWrite};
+}
+
+// counters for one workgroup per dispatch
+orphee::vmaBuffer slices(const Harness &H) {
+  return H.D.createBuffer(
+      {{},
+       DISPATCHES * GROUP_SIZE * sizeof(uint32_t),
+       vk::BufferUsageFlagBits::eStorageBuffer |
+           vk::BufferUsageFlagBits::eShaderDeviceAddress |
+           vk::BufferUsageFlagBits::eTransferDst},
+      orphee::ResourceClass::eStreaming);
+}
+
+/* upload */
+// host writes through a staging buffer copied on the queue, against writes
+// straight into mapped memory the device reads (device local with resizable
+// BAR or unified memory, host memory otherwise)
+std::vector<Result> upload(Harness &H) {
+  const std::vector<std::byte> source(COPY_SIZE, std::byte{1});
+
+  const auto staging = H.D.createBuffer(
+      {{}, COPY_SIZE, vk::BufferUsageFlagBits::eTransferSrc},
+      orphee::ResourceClass::eStaging);
+  const auto local = H.D.createBuffer(
+      {{}, COPY_SIZE, vk::BufferUsageFlagBits::eTransferDst},
+      orphee::ResourceClass::eSimState);
+
+  VmaAllocationCreateInfo mappedInfo{};
+  mappedInfo.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                     VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  mappedInfo.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+  const auto mapped = H.D.createBuffer(
+      {{}, COPY_SIZE, vk::BufferUsageFlagBits::eStorageBuffer}, mappedInfo);
+
+  const auto stagingMs = H.host([&] {
+    std::memcpy(staging.allocationInfo.pMappedData, source.data(), COPY_SIZE);
+    vmaFlushAllocation(H.D.allocator, staging.allocation, 0, COPY_SIZE);
+    H.submit([&](const vk::raii::CommandBuffer &cmd) {
+      vk::BufferCopy2 region{0, 0, COPY_SIZE};
+      cmd.copyBuffer2({staging.h, local.h, region});
+    });
+  });
+
+  const auto mappedMs = H.host([&] {
+    std::memcpy(mapped.allocationInfo.pMappedData, source.data(), COPY_SIZE);
+    vmaFlushAllocation(H.D.allocator, mapped.allocation, 0, COPY_SIZE);
+  });
+
+  return {{"upload.staging", gbps(COPY_SIZE, stagingMs), "GB/s", true},
+          {"upload.mapped", gbps(COPY_SIZE, mappedMs), "GB/s", true}};
+}
+
+/* copies */
+std::vector<Result> copies(Harness &H) {
+  const vk::BufferCreateInfo bufferInfo{
+      {},
+      COPY_SIZE,
+      vk::BufferUsageFlagBits::eTransferSrc |
+          vk::BufferUsageFlagBits::eTransferDst};
+  const auto src =
+      H.D.createBuffer(bufferInfo, orphee::ResourceClass::eSimState);
+  const auto dst =
+      H.D.createBuffer(bufferInfo, orphee::ResourceClass::eSimState);
+
+  const auto bufferMs = H.gpu([&](const vk::raii::CommandBuffer &cmd) {
+    vk::BufferCopy2 region{0, 0, COPY_SIZE};
+    cmd.copyBuffer2({src.h, dst.h, region});
+  });
+
+  const vk::ImageCreateInfo imageInfo{
+      {},
+      vk::ImageType::e2D,
+      vk::Format::eR8G8B8A8Unorm,
+      {IMAGE_SIZE, IMAGE_SIZE, 1},
+      1,
+      1,
+      vk::SampleCountFlagBits::e1,
+      vk::ImageTiling::eOptimal,
+      vk::ImageUsageFlagBits::eTransferSrc |
+          vk::ImageUsageFlagBits::eTransferDst,
+      vk::SharingMode::eExclusive,
+      {},
+      vk::ImageLayout::eUndefined};
+  const auto srcImage =
+      H.D.createImage(imageInfo, orphee::ResourceClass::eSimState);
+  const auto dstImage =
+      H.D.createImage(imageInfo, orphee::ResourceClass::eSimState);
+
+  const vk::ImageSubresourceRange range{vk::ImageAspectFlagBits::eColor, 0, 1,
+                                        0, 1};
+  H.submit([&](const vk::raii::CommandBuffer &cmd) {
+    const std::array<vk::ImageMemoryBarrier2, 2> barriers{
+        vk::ImageMemoryBarrier2{vk::PipelineStageFlagBits2::eNone,
+                                vk::AccessFlagBits2::eNone,
+                                vk::PipelineStageFlagBits2::eCopy,
+                                vk::AccessFlagBits2::eTransferRead,
+                                vk::ImageLayout::eUndefined,
+                                vk::ImageLayout::eTransferSrcOptimal,
+                                vk::QueueFamilyIgnored,
+                                vk::QueueFamilyIgnored,
+                                srcImage.h,
+                                range},
+        vk::ImageMemoryBarrier2{vk::PipelineStageFlagBits2::eNone,
+                                vk::AccessFlagBits2::eNone,
+                                vk::PipelineStageFlagBits2::eCopy,
+                                vk::AccessFlagBits2::eTransferWrite,
+                                vk::ImageLayout::eUndefined,
+                                vk::ImageLayout::eTransferDstOptimal,
+                                vk::QueueFamilyIgnored,
+                                vk::QueueFamilyIgnored,
+                                dstImage.h,
+                                range}};
+    cmd.pipelineBarrier2({{}, {}, {}, barriers});
+  });
+
+  const auto imageMs = H.gpu([&](const vk::raii::CommandBuffer &cmd) {
+    const vk::ImageSubresourceLayers layers{vk::ImageAspectFlagBits::eColor, 0,
+                                            0, 1};
+    vk::ImageCopy2 region{
+        layers, {}, layers, {}, {IMAGE_SIZE, IMAGE_SIZE, 1}};
+    cmd.copyImage2({srcImage.h, vk::ImageLayout::eTransferSrcOptimal,
+                    dstImage.h, vk::ImageLayout::eTransferDstOptimal,
+                    region});
+  });
+
+  const vk::DeviceSize imageBytes = IMAGE_SIZE * IMAGE_SIZE * 4;
+  return {{"copy.buffer", gbps(COPY_SIZE, bufferMs), "GB/s", true},
+          {"copy.image", gbps(imageBytes, imageMs), "GB/s", true}};
+}
+
+/* dispatch, submit and barriers */
+std::vector<Result> overhead(Harness &H) {
+  const auto counters = slices(H);
+  const orphee::ComputeKernel kernel{H.D,
+                                     orphee::shaders::get("addressBench")};
+  kernel.checkArgs<vk::DeviceAddress>();
+
+  // one slice per dispatch, nothing to synchronize between them
+  const auto dispatches = [&](const vk::raii::CommandBuffer &cmd,
+                              bool barriers) {
+    const vk::MemoryBarrier2 barrier = computeBarrier();
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *kernel.pipeline);
+    for (uint32_t i = 0; i < DISPATCHES; ++i) {
+      if (barriers && i > 0) {
+        cmd.pipelineBarrier2({{}, barrier, {}, {}});
+      }
+      const vk::DeviceAddress slice =
+          counters.address + i * GROUP_SIZE * sizeof(uint32_t);
+      cmd.pushConstants<vk::DeviceAddress>(kernel.layout, kernel.argsStages,
+                                           0, slice);
+      cmd.dispatch(1, 1, 1);
+    }
+  };
+
+  const auto dispatchMs = H.gpu(
+      [&](const vk::raii::CommandBuffer &cmd) { dispatches(cmd, false); });
+  const auto barrierMs = H.gpu(
+      [&](const vk::raii::CommandBuffer &cmd) { dispatches(cmd, true); });
+
+  // an empty command buffer submitted and waited for
+  H.submit([](const vk::raii::CommandBuffer &) {});
+  const auto submitMs = H.host([&] { H.submit(); });
+
+  return {
+      {"dispatch", each(dispatchMs, DISPATCHES), "us", false},
+      {"barrier",
+       std::max(0.0, each(barrierMs - dispatchMs, DISPATCHES - 1)), "us",
+       false},
+      {"submit", submitMs * 1e3, "us", false}};
+}
+
+/* descriptors */
+// host time recording a storage buffer binding and a dispatch, through a
+// written set, a pushed set and a device address in push constants
+std::vector<Result> descriptors(Harness &H) {
+  const auto counters = slices(H);
+  const vk::DeviceSize slice = GROUP_SIZE * sizeof(uint32_t);
+
+  const auto code = orphee::shaders::get("descriptorBench");
+  const auto module = H.D.h.createShaderModule({{}, code});
+  const vk::PipelineShaderStageCreateInfo stageInfo{
+      {}, vk::ShaderStageFlagBits::eCompute, *module, "main", {}};
+  const vk::DescriptorSetLayoutBinding countersBinding{
+      0, vk::DescriptorType::eStorageBuffer, 1,
+      vk::ShaderStageFlagBits::eCompute};
+
+  std::vector<Result> results;
+  /* written sets */
+  {
+    const auto setLayout = H.D.descriptorSetLayout({{}, countersBinding});
+    const auto layout = H.D.pipelineLayout({{}, setLayout});
+    const auto pipeline =
+        H.D.h.createComputePipeline(nullptr, {{}, stageInfo, layout});
+
+    const vk::DescriptorPoolSize poolSize{vk::DescriptorType::eStorageBuffer,
+                                          DISPATCHES};
+    // the sets are freed on destruction
+    const auto pool = H.D.h.createDescriptorPool(
+        {vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, DISPATCHES,
+         poolSize});
+    const std::vector<vk::DescriptorSetLayout> layouts(DISPATCHES, setLayout);
+    const auto sets = H.D.h.allocateDescriptorSets({*pool, layouts});
+
+    const auto ms = H.recording([&](const vk::raii::CommandBuffer &cmd) {
+      cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline);
+      for (uint32_t i = 0; i < DISPATCHES; ++i) {
+        const vk::DescriptorBufferInfo bufferInfo{counters.h, i * slice,
+                                                  slice};
+        H.D.h.updateDescriptorSets(
+            vk::WriteDescriptorSet{*sets[i], 0, 0,
+                                   vk::DescriptorType::eStorageBuffer, {},
+                                   bufferInfo},
+            {});
+        cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute, layout, 0,
+                               *sets[i], {});
+        cmd.dispatch(1, 1, 1);
+      }
+    });
+    results.push_back(
+        {"descriptors.update", each(ms, DISPATCHES) * 1e3, "ns", false});
+  }
+  /* pushed sets */
+  if (H.D.capabilities.pushDescriptors) {
+    const auto setLayout = H.D.descriptorSetLayout(
+        {vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR,
+         countersBinding});
+    const auto layout = H.D.pipelineLayout({{}, setLayout});
+    const auto pipeline =
+        H.D.h.createComputePipeline(nullptr, {{}, stageInfo, layout});
+
+    const auto ms = H.recording([&](const vk::raii::CommandBuffer &cmd) {
+      cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline);
+      for (uint32_t i = 0; i < DISPATCHES; ++i) {
+        const vk::DescriptorBufferInfo bufferInfo{counters.h, i * slice,
+                                                  slice};
+        orphee::pushDescriptors(
+            cmd, vk::PipelineBindPoint::eCompute, layout, 0,
+            vk::WriteDescriptorSet{
+                {}, 0, 0, vk::DescriptorType::eStorageBuffer, {}, bufferInfo});
+        cmd.dispatch(1, 1, 1);
+      }
+    });
+    results.push_back(
+        {"descriptors.push", each(ms, DISPATCHES) * 1e3, "ns", false});
+  } else {
+    std::cerr << "VK_KHR_push_descriptor is not available\n";
+  }
+  /* device addresses */
+  {
+    const orphee::ComputeKernel kernel{H.D,
+                                       orphee::shaders::get("addressBench")};
+    kernel.checkArgs<vk::DeviceAddress>();
+
+    const auto ms = H.recording([&](const vk::raii::CommandBuffer &cmd) {
+      cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *kernel.pipeline);
+      for (uint32_t i = 0; i < DISPATCHES; ++i) {
+        cmd.pushConstants<vk::DeviceAddress>(kernel.layout, kernel.argsStages,
+                                             0, counters.address + i * slice);
+        cmd.dispatch(1, 1, 1);
+      }
+    });
+    results.push_back(
+        {"descriptors.address", each(ms, DISPATCHES) * 1e3, "ns", false});
+  }
+
+  return results;
+}
+
+/* pipelines */
+// heatTransfer pipeline creation through an empty pipeline cache and one
+// already holding it. Drivers keeping their own cache make cold creations
+// look warm, such cache must be disabled for meaningful cold numbers (e.g.
+// MESA_SHADER_CACHE_DISABLE=true).
+std::vector<Result> pipelines(Harness &H) {
+  const auto code = orphee::shaders::get("heatTransfer");
+  const auto module = H.D.h.createShaderModule({{}, code});
+  const vk::PipelineShaderStageCreateInfo stageInfo{
+      {}, vk::ShaderStageFlagBits::eCompute, *module, "main", {}};
+  const vk::PushConstantRange args{vk::ShaderStageFlagBits::eCompute, 0,
+                                   sizeof(HTArgs)};
+  const auto layout = H.D.pipelineLayout({{}, {}, args});
+  const vk::ComputePipelineCreateInfo info{{}, stageInfo, layout};
+
+  const auto coldMs = H.host([&] {
+    const auto cache = H.D.h.createPipelineCache({});
+    const auto pipeline = H.D.h.createComputePipeline(cache, info);
+  });
+
+  const auto cache = H.D.h.createPipelineCache({});
+  // populates the cache
+  const auto first = H.D.h.createComputePipeline(cache, info);
+  const auto warmMs = H.host([&] {
+    const auto pipeline = H.D.h.createComputePipeline(cache, info);
+  });
+
+  return {{"pipeline.cold", coldMs, "ms", false},
+          {"pipeline.warm", warmMs, "ms", false}};
+}
+
+/* stencil */
+// heatTransfer steps on a GRID_SIZE square, default workgroup shape
+std::vector<Result> stencil(Harness &H) {
+  const vk::DeviceSize size =
+      static_cast<vk::DeviceSize>(GRID_SIZE) * GRID_SIZE * sizeof(float);
+  const vk::BufferCreateInfo info{
+      {},
+      size,
+      vk::BufferUsageFlagBits::eStorageBuffer |
+          vk::BufferUsageFlagBits::eShaderDeviceAddress |
+          vk::BufferUsageFlagBits::eTransferDst};
+  const std::array<orphee::vmaBuffer, 2> T{
+      H.D.createBuffer(info, orphee::ResourceClass::eSimState),
+      H.D.createBuffer(info, orphee::ResourceClass::eSimState)};
+
+  const orphee::ComputeKernel kernel{H.D, orphee::shaders::get("heatTransfer")};
+  kernel.checkArgs<HTArgs>();
+  const auto g = kernel.groups(GRID_SIZE, GRID_SIZE);
+
+  // no denormals or NaNs from uninitialized memory
+  H.submit([&](const vk::raii::CommandBuffer &cmd) {
+    cmd.fillBuffer(T[0].h, 0, vk::WholeSize, 0);
+    cmd.fillBuffer(T[1].h, 0, vk::WholeSize, 0);
+  });
+
+  const auto ms = H.gpu([&](const vk::raii::CommandBuffer &cmd) {
+    const vk::MemoryBarrier2 barrier = computeBarrier();
+    for (uint32_t s = 0; s < STENCIL_STEPS; ++s) {
+      if (s > 0) {
+        cmd.pipelineBarrier2({{}, barrier, {}, {}});
+      }
+      const HTArgs args{T[s % 2].address, T[(s + 1) % 2].address, GRID_SIZE,
+                        GRID_SIZE, 0.0F, 1.0F};
+      kernel.dispatch(cmd, args, g[0], g[1]);
+    }
+  });
+
+  const auto cells = static_cast<double>(GRID_SIZE) * GRID_SIZE * STENCIL_STEPS;
+  return {{"stencil", cells / (ms * 1e6), "GCell/s", true}};
+}
+
+struct Benchmark {
+  std::string_view name;
+  std::vector<Result> (*run)(Harness &);
+};
+
+constexpr std::array<Benchmark, 6> BENCHMARKS{{
+    {"upload", upload},
+    {"copy", copies},
+    {"overhead", overhead},
+    {"descriptors", descriptors},
+    {"pipeline", pipelines},
+    {"stencil", stencil},
+}};
+
+int usage(const char *name) {
+  std::cerr << "Usage: " << name
+            << " [--out file] [--baseline file] [--tolerance fraction]"
+               " [--iterations n] [--filter name]\n"
+               "Writes the results as JSON (orphee_bench.json by default)."
+               " With a baseline,\nexits with 2 when a result is worse than"
+               " it by more than the tolerance (0.1).\nBenchmarks: upload"
+               " copy overhead descriptors pipeline stencil\n";
+  return 1;
+}
+
+int main(int argc, char **argv) {
+  std::string out = "orphee_bench.json";
+  std::string baselineFile;
+  std::string filter;
+  double tolerance = 0.1;
+  bench::HarnessSettings settings;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    if (i + 1 == argc) {
+      return usage(argv[0]);
+    }
+    const std::string value = argv[++i];
+    if (arg == "--out") {
+      out = value;
+    } else if (arg == "--baseline") {
+      baselineFile = value;
+    } else if (arg == "--tolerance") {
+      tolerance = std::stod(value);
+    } else if (arg == "--iterations") {
+      settings.iterations = static_cast<uint32_t>(std::stoul(value));
+      // the median needs at least one sample
+      if (settings.iterations == 0) {
+        return usage(argv[0]);
+      }
+    } else if (arg == "--filter") {
+      filter = value;
+    } else {
+      return usage(argv[0]);
+    }
+  }
+
+  try {
+    // read first, a missing baseline should not wait for the whole run
+    const auto baseline = baselineFile.empty()
+                              ? std::map<std::string, double>{}
+                              : bench::loadBaseline(baselineFile);
+
+    Harness H{settings};
+    std::vector<Result> results;
+    for (const auto &b : BENCHMARKS) {
+      if (!filter.empty() && b.name != filter) {
+        continue;
+      }
+      for (auto &r : b.run(H)) {
+        results.push_back(std::move(r));
+      }
+    }
+
+    bench::save(out, H.deviceName(), results);
+    const auto regressions = bench::compare(results, baseline, tolerance);
+    if (regressions > 0) {
+      std::cerr << regressions << " regression(s) over " << tolerance * 100.0
+                << "% against " << baselineFile << "\n";
+      return 2;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << e.what() << std::endl;
+    return 1;
+  }
+
+  return 0;
+}
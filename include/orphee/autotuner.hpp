@@ -0,0 +1,78 @@
+#pragma once
+
+#include <filesystem>
+#include <functional>
+#include <map>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <orphee/compute.hpp>
+
+namespace orphee {
+struct AutotunerSettings {
+  // choices of every device, empty keeps them in memory only
+  std::filesystem::path cacheFile = "autotune.txt";
+  uint32_t warmup = 2;
+  // the median run is kept
+  uint32_t iterations = 5;
+};
+
+// Power of two workgroup shapes of up to dims dimensions for the local size
+// specialization constants of the kernel, within the device limits. The
+// default shape of the module comes first.
+[[nodiscard]] std::vector<Specialization>
+localSizeCandidates(const Device &device, const ShaderReflection &kernel,
+                    uint32_t dims);
+
+// every candidate with every value of the constant
+[[nodiscard]] std::vector<Specialization>
+expand(std::span<const Specialization> candidates, uint32_t id,
+       std::span<const uint32_t> values);
+
+// Times kernel variants with timestamp queries on the queue and picks the
+// fastest. Choices are stored by device UUID and key, the key names the
+// kernel and its problem size and must not contain spaces. A stored choice
+// is reused as long as it is still one of the candidates.
+struct Autotuner {
+  using Build = std::function<ComputeKernel(const Specialization &)>;
+
+  // records a single run of the variant, binding what it uses
+  using Record = std::function<void(const vk::raii::CommandBuffer &cmd,
+                                    const ComputeKernel &kernel)>;
+
+  Autotuner(const Device &device, Queue &queue, AutotunerSettings s = {});
+
+  Autotuner(const Autotuner &) = delete;
+
+  Autotuner &operator=(const Autotuner &) = delete;
+
+  ~Autotuner() = default;
+
+  // throws std::runtime_error when no candidate could be built
+  Specialization tune(const std::string &key,
+                      std::span<const Specialization> candidates,
+                      const Build &build, const Record &record);
+
+  AutotunerSettings settings;
+
+private:
+  // milliseconds
+  double time(const ComputeKernel &kernel, const Record &record);
+
+  void load();
+
+  void save() const;
+
+  const Device *device;
+  Queue *queue;
+  std::string uuid;
+  vk::raii::CommandPool CP{nullptr};
+  vk::raii::CommandBuffer CMD{nullptr};
+  vk::raii::Fence fence{nullptr};
+  vk::raii::QueryPool timestamps{nullptr};
+  float timestampPeriod{};
+  // device UUID to key to choice
+  std::map<std::string, std::map<std::string, Specialization>> choices;
+};
+} // namespace orphee
@@ -0,0 +1,106 @@
+#pragma once
+
+#include <array>
+#include <type_traits>
+#include <vector>
+
+#include <orphee/vulkan.hpp>
+
+namespace orphee {
+struct BindlessHeapSettings {
+  // descriptor counts are clamped to the device update after bind limits
+  uint32_t storageBuffers = 65536;
+  uint32_t storageImages = 16384;
+  uint32_t sampledImages = 65536;
+  uint32_t samplers = 256;
+  uint32_t pushConstantSize = 128;
+};
+
+// Single global update after bind, partially bound descriptor set holding
+// arrays of every resource type. Resources get a stable index in their array
+// when added, shaders index them through push constants. Every pipeline
+// built on the heap shares its pipeline layout, so the set is bound once per
+// command buffer.
+//
+//   layout(set = 0, binding = 0) buffer B { ... } storageBuffers[];
+//   layout(set = 0, binding = 1) uniform image2D storageImages[];
+//   layout(set = 0, binding = 2) uniform texture2D sampledImages[];
+//   layout(set = 0, binding = 3) uniform sampler samplers[];
+struct BindlessHeap {
+  enum Binding : uint32_t {
+    eStorageBuffer = 0,
+    eStorageImage = 1,
+    eSampledImage = 2,
+    eSampler = 3,
+  };
+
+  using Index = uint32_t;
+
+  [[nodiscard]] static vk::DescriptorType typeOf(Binding b);
+
+  BindlessHeap(std::nullptr_t) {}
+
+  BindlessHeap(const Device &device, BindlessHeapSettings s = {});
+
+  Index addStorageBuffer(vk::Buffer buffer, vk::DeviceSize offset = 0,
+                         vk::DeviceSize range = vk::WholeSize);
+
+  Index addStorageImage(vk::ImageView view,
+                        vk::ImageLayout layout = vk::ImageLayout::eGeneral);
+
+  Index addSampledImage(
+      vk::ImageView view,
+      vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+  Index addSampler(vk::Sampler sampler);
+
+  // rewrites an index in place, e.g. after the resource got moved
+  void setStorageBuffer(Index i, vk::Buffer buffer, vk::DeviceSize offset = 0,
+                        vk::DeviceSize range = vk::WholeSize);
+
+  void setStorageImage(Index i, vk::ImageView view,
+                       vk::ImageLayout layout = vk::ImageLayout::eGeneral);
+
+  void setSampledImage(
+      Index i, vk::ImageView view,
+      vk::ImageLayout layout = vk::ImageLayout::eShaderReadOnlyOptimal);
+
+  void setSampler(Index i, vk::Sampler sampler);
+
+  // the index is recycled, no pending work may still reference it, throws
+  // if it is not in use
+  void remove(Binding b, Index i);
+
+  void bind(const vk::raii::CommandBuffer &cmd,
+            vk::PipelineBindPoint bindPoint) const {
+    cmd.bindDescriptorSets(bindPoint, layout, 0, set, {});
+  }
+
+  template <typename Args>
+  void push(const vk::raii::CommandBuffer &cmd, const Args &args) const {
+    static_assert(std::is_trivially_copyable_v<Args>);
+
+    cmd.pushConstants<Args>(layout, vk::ShaderStageFlagBits::eAll, 0, args);
+  }
+
+  BindlessHeapSettings settings;
+  vk::DescriptorSetLayout setLayout{};
+  vk::raii::DescriptorPool pool{nullptr};
+  // owned by pool
+  vk::DescriptorSet set{};
+  vk::PipelineLayout layout{};
+
+private:
+  Index allocate(Binding b);
+
+  void write(Binding b, Index i, const vk::DescriptorBufferInfo *bufferInfo,
+             const vk::DescriptorImageInfo *imageInfo);
+
+  const Device *device{};
+  std::array<uint32_t, 4> capacity{};
+  std::array<Index, 4> next{};
+  std::array<std::vector<Index>, 4> freed;
+  // indices handed out and not removed since
+  std::array<std::vector<bool>, 4> live;
+};
+} // namespace orphee
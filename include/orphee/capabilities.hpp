@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+
+#include <vulkan/vulkan.hpp>
+
+namespace orphee {
+// Optional features and extensions the device was created with, enabled
+// whenever supported. Required ones (ORPHEE_REQUIRED_VK_DEVICE_FEATURES and
+// ORPHEE_REQUIRED_VK_DEVICE_EXTENSIONS) are always there and not listed.
+struct Capabilities {
+  /* core features */
+  bool pipelineStatisticsQuery{};
+  bool shaderFloat64{};
+  bool shaderInt64{};
+  bool shaderInt16{};
+  /* 1.1 and 1.2 features */
+  bool shaderFloat16{};
+  bool shaderInt8{};
+  bool storageBuffer16BitAccess{};
+  bool storageBuffer8BitAccess{};
+  /* subgroups */
+  // operations available in compute shaders, none when compute shaders do
+  // not support subgroup operations
+  vk::SubgroupFeatureFlags subgroupOperations;
+  uint32_t subgroupSize{};
+  /* extensions */
+  // VK_KHR_push_descriptor
+  bool pushDescriptors{};
+  // VK_EXT_descriptor_buffer, requested through Settings::descriptors
+  bool descriptorBuffer{};
+  // VK_EXT_shader_object, requested through Settings::shaderObjects
+  bool shaderObjects{};
+  // VK_EXT_graphics_pipeline_library, requested through
+  // Settings::pipelineLibraries
+  bool pipelineLibraries{};
+  // VK_EXT_mesh_shader with task and mesh shaders
+  bool meshShaders{};
+};
+} // namespace orphee
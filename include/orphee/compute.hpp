@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+#include <orphee/bindless.hpp>
+#include <orphee/reflection.hpp>
+#include <orphee/vulkan.hpp>
+
+namespace orphee {
+// specialization constant values by constant id, 32-bit constants only
+using Specialization = std::map<uint32_t, uint32_t>;
+
+// Compute kernel taking its arguments as a push constant block. Buffers are
+// passed as device addresses (GL_EXT_buffer_reference), so switching buffers
+// between dispatches needs no descriptor updates. The pipeline layout comes
+// from the device layout cache, kernels with the same arguments share it.
+// The module is reflected when the kernel is created, checkArgs catches C++
+// argument blocks out of sync with the shader. Specialized workgroup sizes
+// are reflected in localSize.
+struct ComputeKernel {
+  ComputeKernel(std::nullptr_t) {}
+
+  // layout derived from the module interface
+  ComputeKernel(const Device &device, std::span<const uint32_t> code,
+                const Specialization &specialization = {});
+
+  ComputeKernel(const Device &device, std::span<const uint32_t> code,
+                uint32_t argsSize,
+                std::span<const vk::DescriptorSetLayout> setLayouts = {});
+
+  // shares the heap pipeline layout, the heap must outlive the kernel and be
+  // bound to the command buffer before dispatching. Throws when the module
+  // uses bindings the heap does not provide.
+  ComputeKernel(const Device &device, std::span<const uint32_t> code,
+                const BindlessHeap &heap,
+                const Specialization &specialization = {});
+
+  template <typename Args> void checkArgs() const {
+    checkPushConstants(reflection, sizeof(Args), alignof(Args));
+  }
+
+  // workgroups covering x * y * z invocations
+  [[nodiscard]] std::array<uint32_t, 3> groups(uint32_t x, uint32_t y = 1,
+                                               uint32_t z = 1) const {
+    return {(x + localSize[0] - 1) / localSize[0],
+            (y + localSize[1] - 1) / localSize[1],
+            (z + localSize[2] - 1) / localSize[2]};
+  }
+
+  template <typename Args>
+  void dispatch(const vk::raii::CommandBuffer &cmd, const Args &args,
+                uint32_t x, uint32_t y = 1, uint32_t z = 1) const {
+    static_assert(std::is_trivially_copyable_v<Args>);
+
+    cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *pipeline);
+    cmd.pushConstants<Args>(layout, argsStages, 0, args);
+    cmd.dispatch(x, y, z);
+  }
+
+  ShaderReflection reflection;
+  Specialization specialization;
+  std::array<uint32_t, 3> localSize{1, 1, 1};
+  std::vector<vk::DescriptorSetLayout> setLayouts;
+  vk::PipelineLayout layout{};
+  vk::ShaderStageFlags argsStages{vk::ShaderStageFlagBits::eCompute};
+  vk::raii::Pipeline pipeline{nullptr};
+
+private:
+  void createPipeline(const Device &device, std::span<const uint32_t> code);
+};
+} // namespace orphee
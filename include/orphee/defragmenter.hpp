@@ -0,0 +1,94 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+
+#include <orphee/vulkan.hpp>
+
+namespace orphee {
+struct DefragmentationSettings {
+  // ratio of unused to allocated block bytes that starts a defragmentation
+  float threshold = 0.25F;
+  vk::DeviceSize maxBytesPerPass = 32ULL * 1024ULL * 1024ULL;
+  uint32_t maxAllocationsPerPass = 64;
+};
+
+// Incremental VMA defragmentation, only tracked resources are moved. VMA
+// never moves dedicated allocations, track() ignores them: create resources
+// with Placement::eMovable. Tracked buffers, and images whose contents are
+// kept, need eTransferSrc and eTransferDst usage, track() throws otherwise.
+// update() must be called once per frame when no submitted work references
+// tracked resources (e.g. right after waiting the frame fence). Moved
+// resources get new handles and their onMove callback is invoked so views
+// and descriptors can be rewritten.
+struct Defragmenter {
+  using MoveCallback = std::function<void()>;
+
+  Defragmenter(const Device &device, Queue &queue,
+               DefragmentationSettings s = {});
+
+  Defragmenter(const Defragmenter &) = delete;
+
+  Defragmenter &operator=(const Defragmenter &) = delete;
+
+  ~Defragmenter();
+
+  void track(vmaBuffer &buffer, const vk::BufferCreateInfo &info,
+             MoveCallback onMove = {});
+
+  void track(vmaImage &image, const vk::ImageCreateInfo &info,
+             vk::ImageLayout layout, MoveCallback onMove = {});
+
+  void untrack(const vmaBuffer &buffer);
+
+  void untrack(const vmaImage &image);
+
+  // tracked images must report their layout between frames
+  void setLayout(const vmaImage &image, vk::ImageLayout layout);
+
+  [[nodiscard]] float fragmentation() const;
+
+  // returns true while a defragmentation is in progress
+  bool update();
+
+  DefragmentationSettings settings;
+
+private:
+  struct Resource {
+    vmaBuffer *buffer{};
+    vmaImage *image{};
+    vk::BufferCreateInfo bufferInfo;
+    vk::ImageCreateInfo imageInfo;
+    vk::ImageLayout layout{vk::ImageLayout::eUndefined};
+    MoveCallback onMove;
+  };
+
+  struct Move {
+    Resource *resource;
+    VmaAllocation allocation;
+    vk::Buffer buffer;
+    vk::Image image;
+  };
+
+  [[nodiscard]] vk::DeviceSize blockBytes() const;
+
+  void begin();
+
+  void end();
+
+  bool pass();
+
+  void recordBufferMove(Move &m, VmaAllocation target);
+
+  void recordImageMove(Move &m, VmaAllocation target);
+
+  const Device *device;
+  Queue *queue;
+  vk::raii::CommandPool CP{nullptr};
+  vk::raii::CommandBuffer CMD{nullptr};
+  vk::raii::Fence fence{nullptr};
+  std::unordered_map<VmaAllocation, Resource> resources;
+  VmaDefragmentationContext context{};
+  vk::DeviceSize idleBlockBytes{};
+};
+} // namespace orphee
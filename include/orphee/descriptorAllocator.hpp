@@ -0,0 +1,74 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include <orphee/vulkan.hpp>
+
+namespace orphee {
+struct DescriptorAllocatorSettings {
+  uint32_t setsPerPool = 64;
+  uint32_t maxSetsPerPool = 4096;
+  // pool sizes are setsPerPool * ratio descriptors of each type
+  std::vector<std::pair<vk::DescriptorType, float>> ratios{
+      {vk::DescriptorType::eUniformBuffer, 1.0F},
+      {vk::DescriptorType::eStorageBuffer, 2.0F},
+      {vk::DescriptorType::eStorageImage, 1.0F},
+      {vk::DescriptorType::eSampledImage, 1.0F},
+      {vk::DescriptorType::eCombinedImageSampler, 1.0F},
+      {vk::DescriptorType::eSampler, 0.5F},
+  };
+};
+
+// Allocates descriptor sets from per thread pool lists, so allocation takes
+// no lock once a thread has its pools. Full or fragmented pools are retired
+// and replaced by twice larger ones up to maxSetsPerPool. Layouts from the
+// device layout cache too large for a maxSetsPerPool pool get a pool sized
+// for them. Sets are never freed individually, reset() recycles every pool
+// at once (e.g. once per frame after waiting the frame fence) and must not
+// run concurrently with allocate().
+struct DescriptorAllocator {
+  DescriptorAllocator(const Device &device,
+                      DescriptorAllocatorSettings s = {});
+
+  DescriptorAllocator(const DescriptorAllocator &) = delete;
+
+  DescriptorAllocator &operator=(const DescriptorAllocator &) = delete;
+
+  ~DescriptorAllocator() = default;
+
+  vk::DescriptorSet allocate(vk::DescriptorSetLayout layout);
+
+  void reset();
+
+  DescriptorAllocatorSettings settings;
+
+private:
+  struct Pools {
+    vk::raii::DescriptorPool current{nullptr};
+    std::vector<vk::raii::DescriptorPool> full;
+    std::vector<vk::raii::DescriptorPool> ready;
+    // pools sized for a single layout, destroyed on reset
+    std::vector<vk::raii::DescriptorPool> oversized;
+    uint32_t setsPerPool;
+  };
+
+  Pools &local();
+
+  // returns true when the new current pool was created, not recycled
+  bool next(Pools &pools);
+
+  [[nodiscard]] bool
+  fitsPool(const std::vector<vk::DescriptorPoolSize> &sizes) const;
+
+  vk::raii::DescriptorPool createPool(uint32_t sets) const;
+
+  const Device *device;
+  uint64_t id;
+  std::mutex mutex;
+  // shared with the weak thread local entries, which expire with them
+  std::vector<std::shared_ptr<Pools>> threads;
+};
+} // namespace orphee
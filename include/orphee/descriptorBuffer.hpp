@@ -0,0 +1,63 @@
+#pragma once
+
+#include <vector>
+
+#include <orphee/vulkan.hpp>
+
+namespace orphee {
+// VK_EXT_descriptor_buffer backed sets for a single set layout. Descriptors
+// are fetched with vkGetDescriptorEXT straight into a mapped buffer, so
+// writing a set is a memcpy with no driver bookkeeping and writes to
+// distinct sets can be done from several threads. The layout must be
+// created with eDescriptorBufferEXT and pipelines using it with
+// vk::PipelineCreateFlagBits::eDescriptorBufferEXT.
+struct DescriptorBuffer {
+  DescriptorBuffer(std::nullptr_t) {}
+
+  // bindings of the layout must be numbered 0 to bindingCount - 1
+  DescriptorBuffer(const Device &device, vk::DescriptorSetLayout layout,
+                   uint32_t bindingCount, uint32_t capacity);
+
+  // returns the slot of a new set, slots are released together by reset()
+  uint32_t allocate();
+
+  void reset() { next = 0; }
+
+  void writeUniformBuffer(uint32_t set, uint32_t binding,
+                          vk::DeviceAddress address, vk::DeviceSize range,
+                          uint32_t element = 0) const;
+
+  void writeStorageBuffer(uint32_t set, uint32_t binding,
+                          vk::DeviceAddress address, vk::DeviceSize range,
+                          uint32_t element = 0) const;
+
+  void writeStorageImage(uint32_t set, uint32_t binding, vk::ImageView view,
+                         uint32_t element = 0) const;
+
+  void writeSampledImage(uint32_t set, uint32_t binding, vk::ImageView view,
+                         uint32_t element = 0) const;
+
+  void writeSampler(uint32_t set, uint32_t binding, vk::Sampler sampler,
+                    uint32_t element = 0) const;
+
+  // binds the whole buffer, needed once per command buffer
+  void bindBuffer(const vk::raii::CommandBuffer &cmd) const;
+
+  void bind(const vk::raii::CommandBuffer &cmd,
+            vk::PipelineBindPoint bindPoint, vk::PipelineLayout pipelineLayout,
+            uint32_t firstSet, uint32_t set) const;
+
+  vmaBuffer buffer{nullptr};
+  vk::DeviceSize setSize{};
+
+private:
+  void write(uint32_t set, uint32_t binding, uint32_t element,
+             const vk::DescriptorGetInfoEXT &info, size_t size) const;
+
+  const Device *device{};
+  vk::PhysicalDeviceDescriptorBufferPropertiesEXT properties;
+  std::vector<vk::DeviceSize> bindingOffsets;
+  uint32_t capacity{};
+  uint32_t next{};
+};
+} // namespace orphee
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <array>
+
+#include <orphee/vulkan.hpp>
+
+namespace orphee {
+// Records the writes straight into the command buffer (VK_KHR_push_descriptor)
+// instead of updating a pool allocated set. The set layout must be created
+// with ePushDescriptorKHR, dstSet of the writes is ignored.
+template <typename... Writes>
+void pushDescriptors(const vk::raii::CommandBuffer &cmd,
+                     vk::PipelineBindPoint bindPoint,
+                     vk::PipelineLayout layout, uint32_t set,
+                     const Writes &...writes) {
+  const std::array<vk::WriteDescriptorSet, sizeof...(Writes)> w{writes...};
+  cmd.pushDescriptorSetKHR(bindPoint, layout, set, w);
+}
+} // namespace orphee
@@ -0,0 +1,173 @@
+#pragma once
+
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <orphee/vulkan.hpp>
+
+namespace orphee {
+struct GpuProfilerSettings {
+  // query pools in rotation, results are read that many frames later so
+  // it must not be lower than the frames the application keeps in flight
+  uint32_t framesInFlight = 2;
+  // scopes per frame at most, later ones are not measured
+  uint32_t maxScopes = 64;
+  // frames of history kept per pass
+  uint32_t history = 240;
+  // counted for scopes not nested in another counted one, needs the
+  // pipelineStatisticsQuery feature and is ignored without it
+  vk::QueryPipelineStatisticFlags statistics =
+      vk::QueryPipelineStatisticFlagBits::eInputAssemblyPrimitives |
+      vk::QueryPipelineStatisticFlagBits::eVertexShaderInvocations |
+      vk::QueryPipelineStatisticFlagBits::eClippingPrimitives |
+      vk::QueryPipelineStatisticFlagBits::eFragmentShaderInvocations |
+      vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations;
+};
+
+// Timings and counters of a named pass over the last frames it was
+// recorded in.
+struct GpuPass {
+  // p in [0, 1] over the history, in milliseconds
+  [[nodiscard]] double percentile(double p) const;
+
+  std::string name;
+  // ring buffer of milliseconds, next is the oldest sample once full
+  std::vector<double> samples;
+  size_t next{};
+  // last frame the pass was resolved in
+  double last{};
+  // from the first timestamp of that frame
+  double start{};
+  uint32_t depth{};
+  uint64_t frame{};
+  // statistics of that frame in the order of GpuProfiler::counters(),
+  // empty when none were counted
+  std::vector<uint64_t> counters;
+};
+
+// A scope of a resolved frame, on the host steady clock in nanoseconds.
+struct GpuEvent {
+  uint32_t pass;
+  uint32_t depth;
+  int64_t begin;
+  int64_t end;
+};
+
+// Measures GPU time and pipeline statistics of named scopes. Each frame in
+// flight writes into its own query pools, which are read back without
+// waiting once the frame comes around again. Scopes may nest and the same
+// name may be used several times in a frame, the times and counters add
+// up. A scope must begin and end on the same side of a render pass.
+struct GpuProfiler {
+  // ends its queries on destruction
+  struct Scope {
+    Scope(const Scope &) = delete;
+
+    Scope &operator=(const Scope &) = delete;
+
+    ~Scope();
+
+  private:
+    friend struct GpuProfiler;
+
+    Scope(GpuProfiler *p, const vk::raii::CommandBuffer &cmd, uint32_t query,
+          bool counting)
+        : profiler{p}, cmd{&cmd}, query{query}, counting{counting} {}
+
+    GpuProfiler *profiler;
+    const vk::raii::CommandBuffer *cmd;
+    uint32_t query;
+    bool counting;
+  };
+
+  GpuProfiler(const Device &device, const Queue &queue,
+              GpuProfilerSettings s = {});
+
+  GpuProfiler(const GpuProfiler &) = delete;
+
+  GpuProfiler &operator=(const GpuProfiler &) = delete;
+
+  ~GpuProfiler() = default;
+
+  // Resolves the frame last recorded into the next pool and resets it, to
+  // be recorded first in the command buffer of the frame once its previous
+  // use is known to be complete (e.g. after waiting the frame fence).
+  void beginFrame(const vk::raii::CommandBuffer &cmd);
+
+  [[nodiscard]] Scope scope(const vk::raii::CommandBuffer &cmd,
+                            std::string_view name);
+
+  // in order of first use
+  [[nodiscard]] const std::vector<GpuPass> &passes() const { return stats; }
+
+  // first to last timestamp of the frames
+  [[nodiscard]] const GpuPass &frame() const { return frameStats; }
+
+  // Scopes of the last resolved frames, maxScopes * history at most and
+  // not in order once full. GPU timestamps are mapped to the host clock with
+  // an offset measured on creation, which drifts over long runs.
+  [[nodiscard]] const std::vector<GpuEvent> &events() const { return timeline; }
+
+  // frame the passes were last resolved in
+  [[nodiscard]] uint64_t resolved() const { return resolvedFrame; }
+
+  // false when the queue does not support timestamps, scopes are no-ops
+  [[nodiscard]] bool enabled() const { return !pools.empty(); }
+
+  // statistics counted per scope, in the order of GpuPass::counters
+  [[nodiscard]] const std::vector<vk::QueryPipelineStatisticFlagBits> &
+  counters() const {
+    return statistics;
+  }
+
+  // Writes the history summary and last counters of every pass, as JSON
+  // when the extension is .json and CSV otherwise.
+  void save(const std::filesystem::path &file) const;
+
+  GpuProfilerSettings settings;
+
+private:
+  struct Recorded {
+    uint32_t pass;
+    uint32_t depth;
+    // into the statistics pool, UINT32_MAX when not counted
+    uint32_t counted;
+  };
+
+  struct Frame {
+    vk::raii::QueryPool timestamps{nullptr};
+    vk::raii::QueryPool statistics{nullptr};
+    std::vector<Recorded> scopes;
+    uint32_t counted{};
+    uint64_t index{};
+  };
+
+  void calibrate(const Device &device, const Queue &queue);
+
+  void resolve(Frame &f);
+
+  void record(GpuPass &pass, double ms) const;
+
+  [[nodiscard]] uint32_t passIndex(std::string_view name);
+
+  std::vector<Frame> pools;
+  double timestampPeriod{};
+  uint64_t validMask{};
+  // host nanoseconds at GPU timestamp 0
+  int64_t hostOffset{};
+  std::vector<GpuEvent> timeline;
+  size_t timelineNext{};
+  uint64_t frameIndex{};
+  uint64_t resolvedFrame{};
+  uint32_t depth{};
+  bool counting{false};
+  bool overflow{false};
+  std::vector<vk::QueryPipelineStatisticFlagBits> statistics;
+  std::vector<GpuPass> stats;
+  std::unordered_map<std::string, uint32_t> names;
+  GpuPass frameStats;
+};
+} // namespace orphee
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <shared_mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace orphee {
+// Structurally hashed descriptor set layouts and pipeline layouts. Equal
+// create infos return the same handle, which stays valid as long as the
+// device. Lookups are thread-safe. The only pNext understood is
+// vk::DescriptorSetLayoutBindingFlagsCreateInfo, other chained structs are
+// not part of the key.
+struct LayoutCache {
+  vk::DescriptorSetLayout
+  descriptorSetLayout(const vk::raii::Device &device,
+                      const vk::DescriptorSetLayoutCreateInfo &info);
+
+  vk::PipelineLayout pipelineLayout(const vk::raii::Device &device,
+                                    const vk::PipelineLayoutCreateInfo &info);
+
+  // descriptors a set of a cached layout holds by type, empty for layouts
+  // created elsewhere
+  [[nodiscard]] std::vector<vk::DescriptorPoolSize>
+  poolSizes(vk::DescriptorSetLayout layout) const;
+
+  [[nodiscard]] size_t size() const;
+
+private:
+  struct Binding {
+    vk::DescriptorSetLayoutBinding binding;
+    std::vector<vk::Sampler> immutableSamplers;
+    vk::DescriptorBindingFlags flags;
+
+    bool operator==(const Binding &other) const;
+  };
+
+  struct SetLayoutKey {
+    vk::DescriptorSetLayoutCreateFlags flags;
+    std::vector<Binding> bindings;
+
+    bool operator==(const SetLayoutKey &other) const = default;
+  };
+
+  struct PipelineLayoutKey {
+    vk::PipelineLayoutCreateFlags flags;
+    std::vector<vk::DescriptorSetLayout> setLayouts;
+    std::vector<vk::PushConstantRange> pushConstantRanges;
+
+    bool operator==(const PipelineLayoutKey &other) const = default;
+  };
+
+  struct Hash {
+    size_t operator()(const SetLayoutKey &k) const;
+
+    size_t operator()(const PipelineLayoutKey &k) const;
+  };
+
+  mutable std::shared_mutex mutex;
+  std::unordered_map<SetLayoutKey, vk::raii::DescriptorSetLayout, Hash>
+      setLayouts;
+  std::unordered_map<PipelineLayoutKey, vk::raii::PipelineLayout, Hash>
+      pipelineLayouts;
+  std::unordered_map<VkDescriptorSetLayout, std::vector<vk::DescriptorPoolSize>>
+      setLayoutSizes;
+};
+} // namespace orphee
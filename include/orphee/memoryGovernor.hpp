@@ -0,0 +1,80 @@
+#pragma once
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <orphee/vulkan.hpp>
+
+namespace orphee {
+struct HeapBudget {
+  vk::DeviceSize usage{};
+  vk::DeviceSize budget{};
+  vk::DeviceSize headroom{};
+  vk::MemoryHeapFlags flags;
+};
+
+struct MemoryGovernorSettings {
+  // eviction starts once a heap usage goes above softLimit * budget
+  float softLimit = 0.9F;
+};
+
+// Polls VK_EXT_memory_budget through VMA and evicts registered resources,
+// lowest priority and least recently used first, before a heap runs out.
+// update() must be called once per frame when no submitted work references
+// evictable resources (e.g. right after waiting the frame fence).
+struct MemoryGovernor {
+  using EvictCallback = std::function<void()>;
+
+  using Handle = uint64_t;
+
+  MemoryGovernor(const Device &device, MemoryGovernorSettings s = {});
+
+  MemoryGovernor(const MemoryGovernor &) = delete;
+
+  MemoryGovernor &operator=(const MemoryGovernor &) = delete;
+
+  ~MemoryGovernor() = default;
+
+  // the callback must free the allocation, the handle is dropped before it
+  // runs, it may untrack other resources
+  Handle track(VmaAllocation allocation, float priority, EvictCallback evict);
+
+  void untrack(Handle h);
+
+  void touch(Handle h);
+
+  void update();
+
+  // evicts until size bytes fit in the heap under the soft limit
+  bool reserve(uint32_t heap, vk::DeviceSize size);
+
+  [[nodiscard]] const std::vector<HeapBudget> &heaps() const { return budgets; }
+
+  [[nodiscard]] uint32_t heapOf(VmaAllocation allocation) const;
+
+  MemoryGovernorSettings settings;
+
+private:
+  struct Resource {
+    VmaAllocation allocation;
+    uint32_t heap;
+    vk::DeviceSize size;
+    float priority;
+    uint64_t lastUsed;
+    EvictCallback evict;
+  };
+
+  void poll();
+
+  vk::DeviceSize evict(uint32_t heap, vk::DeviceSize bytes);
+
+  [[nodiscard]] vk::DeviceSize softLimit(uint32_t heap) const;
+
+  const Device *device;
+  std::vector<HeapBudget> budgets;
+  std::unordered_map<Handle, Resource> resources;
+  Handle next{1};
+  uint64_t frame{};
+};
+} // namespace orphee
@@ -1,5 +1,25 @@
 #pragma once
 
+#include <orphee/autotuner.hpp>
+#include <orphee/bindless.hpp>
+#include <orphee/capabilities.hpp>
+#include <orphee/compute.hpp>
+#include <orphee/defragmenter.hpp>
+#include <orphee/descriptorAllocator.hpp>
+#include <orphee/descriptorBuffer.hpp>
+#include <orphee/descriptors.hpp>
+#include <orphee/gpuProfiler.hpp>
+#include <orphee/layoutCache.hpp>
+#include <orphee/memoryGovernor.hpp>
+#include <orphee/pipelineCompiler.hpp>
+#include <orphee/pipelineLibrary.hpp>
+#include <orphee/probe.hpp>
+#include <orphee/reflection.hpp>
+#ifdef ORPHEE_SHADER_COMPILER
+#include <orphee/shaderCompiler.hpp>
+#endif
+#include <orphee/shaderObject.hpp>
+#include <orphee/trace.hpp>
 #include <orphee/vkManager.hpp>
 #include <orphee/vulkan.hpp>
 
@@ -12,16 +32,18 @@ constexpr uint32_t ORPHEE_VERSION_MINOR = 0;
 
 constexpr uint32_t ORPHEE_VK_VERSION = VK_API_VERSION_1_3;
 
-const std::vector<const char *> ORPHEE_REQUIRED_VK_INSTANCE_LAYERS{
-    "VK_LAYER_KHRONOS_validation",
-};
+const std::vector<const char *> ORPHEE_REQUIRED_VK_INSTANCE_LAYERS{};
+
+// enabled by every InstanceProfile but eRelease
+constexpr auto ORPHEE_VK_VALIDATION_LAYER = "VK_LAYER_KHRONOS_validation";
 
 const std::vector<const char *> ORPHEE_REQUIRED_VK_INSTANCE_EXTENSIONS{};
 
+// with the platform ones of Settings::surfaceExtensions, or
+// VK_EXT_headless_surface with Settings::headless
 const std::vector<const char *>
     ORPHEE_REQUIRED_VK_INSTANCE_WINDOWING_EXTENSIONS{
         VK_KHR_SURFACE_EXTENSION_NAME,
-        "VK_KHR_win32_surface",
     };
 
 const std::vector<const char *> ORPHEE_REQUIRED_VK_DEVICE_EXTENSIONS{
@@ -45,6 +67,12 @@ const std::vector<const char *> ORPHEE_REQUIRED_VK_DEVICE_WINDOWING_EXTENSIONS{
     VK_KHR_SWAPCHAIN_EXTENSION_NAME,
 };
 
+// enabled when available, query with Device::capabilities
+const std::vector<const char *> ORPHEE_OPTIONAL_VK_DEVICE_EXTENSIONS{
+    VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME,
+    VK_EXT_MESH_SHADER_EXTENSION_NAME,
+};
+
 static vk::PhysicalDeviceFeatures2 getFeatures2() { return {}; }
 
 static vk::PhysicalDeviceVulkan11Features getFeaturesVK11() { return {}; }
@@ -53,6 +81,17 @@ static vk::PhysicalDeviceVulkan12Features getFeaturesVK12() {
   vk::PhysicalDeviceVulkan12Features f12{};
   f12.setTimelineSemaphore(vk::True);
   f12.setBufferDeviceAddress(vk::True);
+  // bindless heap
+  f12.setDescriptorIndexing(vk::True);
+  f12.setRuntimeDescriptorArray(vk::True);
+  f12.setDescriptorBindingPartiallyBound(vk::True);
+  f12.setDescriptorBindingUpdateUnusedWhilePending(vk::True);
+  f12.setDescriptorBindingStorageBufferUpdateAfterBind(vk::True);
+  f12.setDescriptorBindingStorageImageUpdateAfterBind(vk::True);
+  f12.setDescriptorBindingSampledImageUpdateAfterBind(vk::True);
+  f12.setShaderStorageBufferArrayNonUniformIndexing(vk::True);
+  f12.setShaderStorageImageArrayNonUniformIndexing(vk::True);
+  f12.setShaderSampledImageArrayNonUniformIndexing(vk::True);
   return f12;
 }
 
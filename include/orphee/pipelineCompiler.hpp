@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <variant>
+#include <vector>
+
+#include <orphee/vulkan.hpp>
+
+namespace orphee {
+struct ComputePipelineDesc {
+  std::vector<uint32_t> code;
+  vk::PipelineLayout layout;
+  std::string entryPoint = "main";
+};
+
+// Graphics pipeline for dynamic rendering with a dynamic viewport and
+// scissor and blending disabled, the description owns all its state so it
+// can be compiled after the caller returns.
+struct GraphicsPipelineDesc {
+  std::vector<uint32_t> vertexCode;
+  std::vector<uint32_t> fragmentCode;
+  vk::PipelineLayout layout;
+  std::vector<vk::VertexInputBindingDescription> vertexBindings;
+  std::vector<vk::VertexInputAttributeDescription> vertexAttributes;
+  vk::PrimitiveTopology topology{vk::PrimitiveTopology::eTriangleList};
+  vk::CullModeFlags cullMode{vk::CullModeFlagBits::eBack};
+  vk::FrontFace frontFace{vk::FrontFace::eCounterClockwise};
+  std::vector<vk::Format> colorFormats;
+  vk::Format depthFormat{vk::Format::eUndefined};
+};
+
+// Pipeline compiled by a PipelineCompiler, owns the pipeline once ready.
+struct PipelineHandle {
+  PipelineHandle(std::nullptr_t) {}
+
+  [[nodiscard]] bool ready() const;
+
+  // compilation finished with an error, wait() rethrows it
+  [[nodiscard]] bool failed() const;
+
+  // the pipeline once compiled, the placeholder until then or on failure
+  [[nodiscard]] vk::Pipeline get() const;
+
+  // blocks until compiled, rethrows compilation errors
+  vk::Pipeline wait() const;
+
+private:
+  friend struct PipelineCompiler;
+
+  struct State {
+    std::mutex mutex;
+    std::condition_variable done;
+    std::atomic<bool> ready{false};
+    vk::raii::Pipeline pipeline{nullptr};
+    std::exception_ptr error;
+    vk::Pipeline placeholder;
+  };
+
+  explicit PipelineHandle(std::shared_ptr<State> s) : state{std::move(s)} {}
+
+  std::shared_ptr<State> state;
+};
+
+struct PipelineCompilerSettings {
+  // 0 uses one thread per hardware thread
+  uint32_t threads = 0;
+  // pipelines created per driver call at most
+  uint32_t batchSize = 8;
+  // loaded on creation and saved on destruction when set
+  std::filesystem::path cacheFile;
+};
+
+// Compiles pipelines on worker threads sharing one pipeline cache. Queued
+// descriptions of the same kind are batched into one create call, spread
+// over the workers so startup takes as long as the slowest batch. Pending
+// pipelines are abandoned on destruction, the device must outlive the
+// compiler and its handles.
+struct PipelineCompiler {
+  PipelineCompiler(const Device &device, PipelineCompilerSettings s = {});
+
+  PipelineCompiler(const PipelineCompiler &) = delete;
+
+  PipelineCompiler &operator=(const PipelineCompiler &) = delete;
+
+  ~PipelineCompiler();
+
+  PipelineHandle compile(ComputePipelineDesc desc,
+                         vk::Pipeline placeholder = {});
+
+  PipelineHandle compile(GraphicsPipelineDesc desc,
+                         vk::Pipeline placeholder = {});
+
+  // blocks until every queued pipeline is compiled
+  void wait();
+
+  PipelineCompilerSettings settings;
+  vk::raii::PipelineCache cache{nullptr};
+
+private:
+  using Desc = std::variant<ComputePipelineDesc, GraphicsPipelineDesc>;
+
+  struct Job {
+    Desc desc;
+    std::shared_ptr<PipelineHandle::State> state;
+  };
+
+  PipelineHandle enqueue(Desc desc, vk::Pipeline placeholder);
+
+  void work();
+
+  void build(std::vector<Job> &batch);
+
+  static void finish(PipelineHandle::State &state, vk::raii::Pipeline pipeline,
+                     std::exception_ptr error = {});
+
+  const Device *device;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable idle;
+  std::deque<Job> jobs;
+  uint32_t busy{};
+  bool stop{false};
+  std::vector<std::thread> workers;
+};
+} // namespace orphee
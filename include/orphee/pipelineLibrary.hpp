@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <functional>
+#include <future>
+#include <unordered_map>
+
+#include <orphee/pipelineCompiler.hpp>
+
+namespace orphee {
+// Builds graphics pipelines out of VK_EXT_graphics_pipeline_library parts.
+// The vertex input, pre-rasterization, fragment shader and fragment output
+// parts of a description are compiled once and shared by every pipeline
+// using them, so a new combination only costs a fast link and is usable in
+// the frame it is first asked for. An optimized link is started in the
+// background and replaces the fast-linked pipeline once done. Requires
+// Settings::pipelineLibraries, the device must outlive the library.
+struct GraphicsPipelineLibrary {
+  explicit GraphicsPipelineLibrary(const Device &device);
+
+  GraphicsPipelineLibrary(const GraphicsPipelineLibrary &) = delete;
+
+  GraphicsPipelineLibrary &operator=(const GraphicsPipelineLibrary &) = delete;
+
+  // waits for the optimized links in flight
+  ~GraphicsPipelineLibrary() = default;
+
+  using Handle = uint64_t;
+
+  // links the pipeline of the description on first use, hashing the
+  // description covers its SPIR-V so keep the handle for per frame lookups
+  Handle prepare(const GraphicsPipelineDesc &desc);
+
+  // the fast-linked pipeline stays valid after the optimized one replaces it
+  vk::Pipeline get(Handle handle);
+
+  vk::Pipeline get(const GraphicsPipelineDesc &desc) {
+    return get(prepare(desc));
+  }
+
+  // parts compiled so far
+  [[nodiscard]] size_t parts() const { return libraries.size(); }
+
+private:
+  using Parts = std::array<vk::Pipeline, 4>;
+
+  struct Linked {
+    vk::raii::Pipeline fast{nullptr};
+    vk::raii::Pipeline optimized{nullptr};
+    std::future<vk::raii::Pipeline> optimizing;
+  };
+
+  vk::Pipeline part(uint64_t key,
+                    const std::function<vk::raii::Pipeline()> &build);
+
+  [[nodiscard]] vk::raii::Pipeline link(const Parts &parts,
+                                        vk::PipelineLayout layout,
+                                        bool optimize) const;
+
+  const Device *device;
+  vk::raii::PipelineCache cache{nullptr};
+  std::unordered_map<uint64_t, vk::raii::Pipeline> libraries;
+  // destroyed first, the pending links use the parts
+  std::unordered_map<uint64_t, Linked> pipelines;
+};
+} // namespace orphee
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.hpp>
+#include <vulkan/vulkan_raii.hpp>
+
+namespace orphee {
+// Instance layers and extensions, sorted by name.
+struct InstanceProbe {
+  [[nodiscard]] bool hasLayer(const char *name) const;
+
+  [[nodiscard]] bool hasExtension(const char *name) const;
+
+  std::vector<vk::LayerProperties> layers;
+  std::vector<vk::ExtensionProperties> extensions;
+};
+
+// Extensions of a physical device sorted by name, and its queue families.
+struct DeviceProbe {
+  [[nodiscard]] bool hasExtension(const char *name) const;
+
+  std::vector<vk::ExtensionProperties> extensions;
+  std::vector<vk::QueueFamilyProperties> families;
+};
+
+// Enumerates once per manager, and once across runs with a file. Stored
+// instance results are reused under the same loader version and loader
+// environment variables (VK_ICD_FILENAMES, VK_LAYER_PATH...), those of a
+// device under the same UUID, driver and API versions. The file must be
+// removed after installing or removing layers.
+struct ProbeCache {
+  explicit ProbeCache(std::filesystem::path file = {});
+
+  ProbeCache(const ProbeCache &) = delete;
+
+  ProbeCache &operator=(const ProbeCache &) = delete;
+
+  ~ProbeCache() = default;
+
+  [[nodiscard]] const InstanceProbe &instance(const vk::raii::Context &context);
+
+  [[nodiscard]] const DeviceProbe &
+  device(const vk::raii::PhysicalDevice &device);
+
+  // writes the file when something was enumerated since it was read, with
+  // the devices probed since then only
+  void save();
+
+  std::filesystem::path file;
+
+private:
+  void load();
+
+  std::string instanceKey;
+  std::optional<InstanceProbe> instanceProbe;
+  // by UUID, driver and API versions
+  std::map<std::string, DeviceProbe> devices;
+  std::set<std::string> probed;
+  bool dirty{false};
+};
+} // namespace orphee
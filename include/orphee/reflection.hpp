@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <orphee/vulkan.hpp>
+
+namespace orphee {
+struct ReflectedBinding {
+  uint32_t set;
+  uint32_t binding;
+  vk::DescriptorType type;
+  // 0 for runtime arrays, their size is up to the pipeline layout
+  uint32_t count;
+  std::string name;
+};
+
+struct ReflectedMember {
+  std::string name;
+  uint32_t offset;
+  uint32_t size;
+  // e.g. "uint32", "float32", "vec4<float32>" or "ptr", compared across
+  // stages
+  std::string type;
+};
+
+struct ReflectedPushConstants {
+  std::string name;
+  uint32_t size;
+  std::vector<ReflectedMember> members;
+};
+
+struct ReflectedSpecializationConstant {
+  uint32_t id;
+  uint32_t size;
+  std::string name;
+};
+
+// Interface of a SPIR-V module, parsed from its decorations and types
+struct ShaderReflection {
+  vk::ShaderStageFlagBits stage{};
+  std::string entryPoint;
+  // compute workgroup size, literal or default value of its spec constants
+  std::array<uint32_t, 3> localSize{1, 1, 1};
+  std::array<std::optional<uint32_t>, 3> localSizeIds;
+  std::vector<ReflectedBinding> bindings;
+  std::optional<ReflectedPushConstants> pushConstants;
+  std::vector<ReflectedSpecializationConstant> specializationConstants;
+};
+
+// throws std::runtime_error on malformed modules
+[[nodiscard]] ShaderReflection reflect(std::span<const uint32_t> code);
+
+struct ReflectedLayout {
+  // indexed by set number
+  std::vector<vk::DescriptorSetLayout> setLayouts;
+  vk::PipelineLayout layout;
+};
+
+// Merges the stages into descriptor set layouts and push constant ranges
+// taken from the device layout cache. Bindings and push constant members
+// shared by several stages must agree, runtime arrays are not supported.
+[[nodiscard]] ReflectedLayout
+reflectPipelineLayout(const Device &device,
+                      std::span<const ShaderReflection> stages);
+
+// throws when a C++ argument block of size bytes does not match the push
+// constants of the stage, std430 tail padding aside
+void checkPushConstants(const ShaderReflection &stage, size_t size,
+                        size_t alignment);
+} // namespace orphee
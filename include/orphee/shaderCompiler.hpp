@@ -0,0 +1,100 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <span>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace orphee {
+struct ShaderCompilerSettings {
+  std::filesystem::path sourceDir = "shaders";
+  std::filesystem::path cacheDir = "shader_cache";
+  // searched after the directory of the including file
+  std::vector<std::filesystem::path> includeDirs;
+  std::chrono::milliseconds pollInterval{250};
+};
+
+using ShaderDefines = std::vector<std::pair<std::string, std::string>>;
+
+// Compiles GLSL to SPIR-V with glslang (ORPHEE_SHADER_COMPILER builds only).
+// The stage comes from the file name, e.g. heatTransfer.comp.glsl. Results
+// are cached on disk under a FNV-1a hash of the source, its includes, the
+// defines and the glslang version. Watched shaders are recompiled on a
+// background thread when they or their includes change, their callbacks
+// run from poll() on the calling thread.
+struct ShaderCompiler {
+  using ReloadCallback = std::function<void(std::span<const uint32_t> code)>;
+
+  using Handle = uint64_t;
+
+  ShaderCompiler(ShaderCompilerSettings s = {});
+
+  ShaderCompiler(const ShaderCompiler &) = delete;
+
+  ShaderCompiler &operator=(const ShaderCompiler &) = delete;
+
+  ~ShaderCompiler();
+
+  // throws std::runtime_error with the glslang log on compilation errors
+  std::vector<uint32_t> compile(const std::filesystem::path &file,
+                                const ShaderDefines &defines = {});
+
+  Handle watch(const std::filesystem::path &file, ShaderDefines defines,
+               ReloadCallback onReload);
+
+  void unwatch(Handle h);
+
+  // runs the callbacks of finished recompilations, e.g. once per frame once
+  // no submitted work uses the pipelines being replaced. Exceptions thrown by
+  // a callback are logged.
+  void poll();
+
+  ShaderCompilerSettings settings;
+
+private:
+  struct Source {
+    std::string text;
+    // every file read, the shader first, for watching
+    std::vector<std::filesystem::path> files;
+    // over the contents of every file
+    uint64_t hash;
+  };
+
+  struct Watched {
+    std::filesystem::path file;
+    ShaderDefines defines;
+    ReloadCallback onReload;
+    std::filesystem::file_time_type lastWrite;
+    std::vector<std::filesystem::path> files;
+  };
+
+  Source read(const std::filesystem::path &file) const;
+
+  static std::filesystem::file_time_type
+  lastWrite(const std::vector<std::filesystem::path> &files);
+
+  std::vector<uint32_t> build(const std::filesystem::path &file,
+                              const ShaderDefines &defines,
+                              std::vector<std::filesystem::path> *files);
+
+  void run();
+
+  std::mutex compileMutex;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::unordered_map<Handle, Watched> watched;
+  std::vector<std::pair<Handle, std::vector<uint32_t>>> ready;
+  Handle next{1};
+  std::atomic<bool> stop{false};
+  std::thread watcher;
+};
+} // namespace orphee
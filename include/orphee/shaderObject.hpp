@@ -0,0 +1,49 @@
+#pragma once
+
+#include <span>
+#include <vector>
+
+#include <orphee/vulkan.hpp>
+
+namespace orphee {
+// Fixed-function state of a draw with shader objects, every piece of it is
+// dynamic so changing it needs no compilation.
+struct RenderState {
+  std::vector<vk::VertexInputBindingDescription2EXT> vertexBindings;
+  std::vector<vk::VertexInputAttributeDescription2EXT> vertexAttributes;
+  vk::PrimitiveTopology topology{vk::PrimitiveTopology::eTriangleList};
+  vk::PolygonMode polygonMode{vk::PolygonMode::eFill};
+  vk::CullModeFlags cullMode{vk::CullModeFlagBits::eBack};
+  vk::FrontFace frontFace{vk::FrontFace::eCounterClockwise};
+  bool depthTest = false;
+  bool depthWrite = false;
+  vk::CompareOp depthCompare{vk::CompareOp::eLess};
+  // alpha blending on every color attachment
+  bool blend = false;
+  uint32_t colorAttachments = 1;
+};
+
+// Vertex and fragment shaders linked as VkShaderEXT objects
+// (VK_EXT_shader_object), used instead of a graphics pipeline. The layouts
+// must match the pipeline layout descriptors are bound with. The task and
+// mesh stages are unbound on devices with mesh shaders enabled.
+struct GraphicsShaders {
+  GraphicsShaders(std::nullptr_t) {}
+
+  GraphicsShaders(const Device &device, std::span<const uint32_t> vertexCode,
+                  std::span<const uint32_t> fragmentCode,
+                  std::span<const vk::DescriptorSetLayout> setLayouts = {},
+                  std::span<const vk::PushConstantRange> pushConstants = {});
+
+  void bind(const vk::raii::CommandBuffer &cmd) const;
+
+  std::vector<vk::raii::ShaderEXT> shaders;
+  // Capabilities::meshShaders of the device
+  bool meshStages = false;
+};
+
+// sets all the state shader object draws need, viewport and scissor
+// cover the extent
+void setRenderState(const vk::raii::CommandBuffer &cmd,
+                    const RenderState &state, vk::Extent2D extent);
+} // namespace orphee
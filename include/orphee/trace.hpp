@@ -0,0 +1,59 @@
+#pragma once
+
+// CPU zones for Chrome trace / Perfetto timelines (ORPHEE_TRACING builds
+// only). Every macro expands to nothing otherwise, arguments included.
+//
+//   ORPHEE_ZONE("name")            times the enclosing block
+//   ORPHEE_TRACE_THREAD("name")    names the calling thread in traces
+//   ORPHEE_TRACE_SAVE(path, gpu)   writes a trace, gpu is a GpuProfiler
+//                                  pointer whose scopes share the timeline,
+//                                  or nullptr
+
+#ifdef ORPHEE_TRACING
+
+#include <filesystem>
+
+namespace orphee {
+struct GpuProfiler;
+
+namespace trace {
+// Each thread appends to its own ring buffer of the latest events, without
+// locks. Names must outlive the trace, e.g. string literals.
+void begin(const char *name);
+
+void end();
+
+void threadName(const char *name);
+
+// Events of running threads may be overwritten while they are written,
+// save when the zones of interest are done.
+void save(const std::filesystem::path &file, const GpuProfiler *gpu);
+
+struct Zone {
+  explicit Zone(const char *name) { begin(name); }
+
+  Zone(const Zone &) = delete;
+
+  Zone &operator=(const Zone &) = delete;
+
+  ~Zone() { end(); }
+};
+} // namespace trace
+} // namespace orphee
+
+#define ORPHEE_TRACE_CONCAT_(a, b) a##b
+#define ORPHEE_TRACE_CONCAT(a, b) ORPHEE_TRACE_CONCAT_(a, b)
+#define ORPHEE_ZONE(name)                                                      \
+  const ::orphee::trace::Zone ORPHEE_TRACE_CONCAT(orpheeZone, __COUNTER__) {   \
+    name                                                                       \
+  }
+#define ORPHEE_TRACE_THREAD(name) ::orphee::trace::threadName(name)
+#define ORPHEE_TRACE_SAVE(path, gpu) ::orphee::trace::save(path, gpu)
+
+#else
+
+#define ORPHEE_ZONE(name) static_cast<void>(0)
+#define ORPHEE_TRACE_THREAD(name) static_cast<void>(0)
+#define ORPHEE_TRACE_SAVE(path, gpu) static_cast<void>(0)
+
+#endif
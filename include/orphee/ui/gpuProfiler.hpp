@@ -0,0 +1,12 @@
+#pragma once
+
+#include <orphee/gpuProfiler.hpp>
+
+namespace orphee::ui {
+// ImGui window with the frame time history, a timeline of the last resolved
+// frame, the last, median, p95 and p99 times and the counters of every pass
+// and buttons saving them to gpuProfile.csv or .json in the working
+// directory. Passes used several times in a frame are drawn once, from their
+// first start.
+void gpuProfilerWindow(const GpuProfiler &profiler, bool *open = nullptr);
+} // namespace orphee::ui
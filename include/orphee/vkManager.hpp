@@ -1,14 +1,64 @@
 #pragma once
 
+#include <chrono>
+#include <filesystem>
+#include <memory>
 #include <optional>
 #include <span>
 #include <string>
+#include <vector>
 
+#include <orphee/probe.hpp>
 #include <orphee/vulkan.hpp>
 
 namespace orphee {
+// Instance layers and debug messenger, ORPHEE_VK_PROFILE=release, debug,
+// gpu or sync overrides the one in Settings.
+enum class InstanceProfile {
+  // no layer nor messenger
+  eRelease,
+  // VK_LAYER_KHRONOS_validation, messages logged through spdlog
+  eDebug,
+  // eDebug with GPU-assisted validation of shader accesses
+  eGpuAssisted,
+  // eDebug with synchronization validation
+  eSynchronization,
+};
+
+// Pins createDevice to a physical device, every set field must match.
+// ORPHEE_VK_DEVICE overrides it with an index, a UUID or a name.
+struct DeviceSelection {
+  // part of the device name, e.g. "llvmpipe"
+  std::string name;
+  // deviceUUID as 32 lowercase hex digits
+  std::string uuid;
+  // in enumeration order
+  std::optional<uint32_t> index;
+
+  [[nodiscard]] bool pinned() const {
+    return !name.empty() || !uuid.empty() || index.has_value();
+  }
+};
+
 struct Settings {
   bool windowing = false;
+  // platform surface extensions, e.g. from SDL_Vulkan_GetInstanceExtensions
+  std::vector<std::string> surfaceExtensions;
+  // VK_EXT_headless_surface instead of the platform surface extensions,
+  // surfaces come from createHeadlessSurface
+  bool headless = false;
+  // falls back to ePool when VK_EXT_descriptor_buffer is not available
+  DescriptorBackend descriptors = DescriptorBackend::ePool;
+  // enables VK_EXT_shader_object when available, see Device::capabilities
+  bool shaderObjects = false;
+  // enables VK_EXT_graphics_pipeline_library when available
+  bool pipelineLibraries = false;
+  // falls back to eRelease when the validation layer is not installed
+  InstanceProfile profile = InstanceProfile::eDebug;
+  // the best scored device is picked unless pinned
+  DeviceSelection device;
+  // layers, extensions and queue families kept across runs, see ProbeCache
+  std::filesystem::path probeCache;
 };
 
 struct Meta {
@@ -38,17 +88,33 @@ public:
 
   ~vkManager();
 
+  // On the device meeting the requirements with the best score: device
+  // type first, then device local memory, subgroup size, compute limits and
+  // available optional extensions. The scores are logged.
   [[nodiscard]] std::optional<Device>
   createDevice(const QueueFamilyRequirements &reqs) const;
 
+  // Needs windowing and headless. Presents without a display server, the
+  // extent is the swapchain one.
+  [[nodiscard]] vk::raii::SurfaceKHR createHeadlessSurface() const;
+
   Settings settings;
 
   Meta meta;
 
+  // time to device is logged from it
+  std::chrono::steady_clock::time_point started{
+      std::chrono::steady_clock::now()};
+
+  std::unique_ptr<ProbeCache> probes;
+
   vk::raii::Context context;
 
   vk::raii::Instance instance;
 
+  // null with eRelease
+  vk::raii::DebugUtilsMessengerEXT messenger{nullptr};
+
 private:
   vk::raii::Instance createInstance();
 
@@ -61,11 +127,16 @@ private:
   checkInstanceExtensions(std::span<const char *> extensions) const;
 
   [[nodiscard]] static bool
-  checkPhysicalDeviceExtensions(const vk::PhysicalDevice &device,
+  checkPhysicalDeviceExtensions(const DeviceProbe &probe,
                                 std::span<const char *> extensions);
 
+  [[nodiscard]] static std::vector<const char *>
+  obtainOptionalExtensions(const DeviceProbe &probe,
+                           std::span<const char *const> extensions);
+
   [[nodiscard]] static std::optional<uint32_t>
   obtainQueueFamilies(const vk::PhysicalDevice &device,
+                      const DeviceProbe &probe,
                       const QueueFamilyRequirements &r);
 };
 } // namespace orphee
@@ -1,12 +1,19 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 #include <vulkan/vulkan.hpp>
 #include <vulkan/vulkan_raii.hpp>
 
+#include <orphee/capabilities.hpp>
+#include <orphee/layoutCache.hpp>
+
 #include <vk_mem_alloc.h>
 
 namespace orphee {
@@ -18,6 +25,64 @@ struct Queue;
 struct Device;
 struct Swapchain;
 
+enum class DescriptorBackend {
+  // vk::DescriptorPool sets written with updateDescriptorSets
+  ePool,
+  // VK_EXT_descriptor_buffer, descriptors are written into mapped memory
+  eBuffer,
+};
+
+enum class ResourceClass {
+  eRenderTarget,
+  eSimState,
+  eStreaming,
+  eStaging,
+};
+
+// VMA never moves dedicated allocations, eMovable ones come from blocks so
+// a Defragmenter can compact them.
+enum class Placement {
+  eDefault,
+  eMovable,
+};
+
+// VMA only honours the priority of dedicated allocations, blocks keep the
+// default one. Hot classes are therefore dedicated and carry a priority so
+// the driver keeps them resident under memory pressure, unless eMovable
+// trades that for defragmentation. Streaming and staging resources are many
+// small ones sub-allocated from blocks and carry none.
+[[nodiscard]] inline VmaAllocationCreateInfo
+allocationInfo(ResourceClass c, Placement p = Placement::eDefault) {
+  VmaAllocationCreateInfo info{};
+
+  switch (c) {
+  case ResourceClass::eRenderTarget:
+    info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    info.priority = 1.0F;
+    break;
+  case ResourceClass::eSimState:
+    info.flags = VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+    info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    info.priority = 0.9F;
+    break;
+  case ResourceClass::eStreaming:
+    info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    break;
+  case ResourceClass::eStaging:
+    info.flags = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+                 VMA_ALLOCATION_CREATE_MAPPED_BIT;
+    info.usage = VMA_MEMORY_USAGE_AUTO_PREFER_HOST;
+    break;
+  }
+
+  if (p == Placement::eMovable) {
+    info.flags &= ~VMA_ALLOCATION_CREATE_DEDICATED_MEMORY_BIT;
+  }
+
+  return info;
+}
+
 struct vmaBuffer {
   friend struct Device;
 
@@ -26,10 +91,12 @@ struct vmaBuffer {
   vmaBuffer(const vmaBuffer &) = default;
 
   vmaBuffer(vmaBuffer &&other) noexcept
-      : h{other.h}, size{other.size}, allocator{other.allocator},
-        allocation{other.allocation}, allocationInfo{other.allocationInfo} {
+      : h{other.h}, size{other.size}, address{other.address},
+        allocator{other.allocator}, allocation{other.allocation},
+        allocationInfo{other.allocationInfo} {
     other.h = nullptr;
     other.size = 0;
+    other.address = 0;
     other.allocator = nullptr;
     other.allocation = nullptr;
     other.allocationInfo = {};
@@ -40,12 +107,14 @@ struct vmaBuffer {
   vmaBuffer &operator=(vmaBuffer &&other) noexcept {
     h = other.h;
     size = other.size;
+    address = other.address;
     allocator = other.allocator;
     allocation = other.allocation;
     allocationInfo = other.allocationInfo;
 
     other.h = nullptr;
     other.size = 0;
+    other.address = 0;
     other.allocator = nullptr;
     other.allocation = nullptr;
     other.allocationInfo = {};
@@ -67,6 +136,7 @@ struct vmaBuffer {
 
   vk::Buffer h;
   size_t size{};
+  vk::DeviceAddress address{};
   VmaAllocator allocator{};
   VmaAllocation allocation{};
   VmaAllocationInfo allocationInfo{};
@@ -153,24 +223,33 @@ struct Device {
          VmaAllocator allocator)
       : physical{std::move(physical)}, h{std::move(device)},
         queueFamilies{std::move(qf)}, queues{std::move(qs)},
-        allocator{allocator} {}
+        layouts{std::make_unique<LayoutCache>()}, allocator{allocator} {}
 
   Device(const Device &other) = delete;
 
   Device(Device &&other) noexcept
       : physical{std::move(other.physical)}, h{std::move(other.h)},
         queueFamilies{std::move(other.queueFamilies)},
-        queues{std::move(other.queues)} {
+        queues{std::move(other.queues)},
+        extensions{std::move(other.extensions)},
+        capabilities{other.capabilities},
+        descriptorBackend{other.descriptorBackend},
+        layouts{std::move(other.layouts)} {
     std::swap(allocator, other.allocator);
   };
 
   Device &operator=(const Device &other) = delete;
 
   Device &operator=(Device &&other) noexcept {
+    // cached layouts must go before the device owning them
+    layouts = std::move(other.layouts);
     physical = std::move(other.physical);
     h = std::move(other.h);
     queueFamilies = std::move(other.queueFamilies);
     queues = std::move(other.queues);
+    extensions = std::move(other.extensions);
+    capabilities = other.capabilities;
+    descriptorBackend = other.descriptorBackend;
     std::swap(allocator, other.allocator);
 
     return *this;
@@ -199,6 +278,10 @@ struct Device {
     b.size = info.size;
     b.allocator = this->allocator;
 
+    if (info.usage & vk::BufferUsageFlagBits::eShaderDeviceAddress) {
+      b.address = h.getBufferAddress({b.h});
+    }
+
     return b;
   }
 
@@ -222,14 +305,47 @@ struct Device {
     return img;
   }
 
+  [[nodiscard]] vmaBuffer
+  createBuffer(const vk::BufferCreateInfo &info, ResourceClass c,
+               Placement p = Placement::eDefault) const {
+    return createBuffer(info, allocationInfo(c, p));
+  }
+
+  [[nodiscard]] vmaImage
+  createImage(const vk::ImageCreateInfo &info, ResourceClass c,
+              Placement p = Placement::eDefault) const {
+    return createImage(info, allocationInfo(c, p));
+  }
+
   void destroyImage(const vmaImage &img) const {
     vmaDestroyImage(this->allocator, img.h, img.allocation);
   }
 
+  // cached by content, the handles live as long as the device
+  [[nodiscard]] vk::DescriptorSetLayout
+  descriptorSetLayout(const vk::DescriptorSetLayoutCreateInfo &info) const {
+    return layouts->descriptorSetLayout(h, info);
+  }
+
+  [[nodiscard]] vk::PipelineLayout
+  pipelineLayout(const vk::PipelineLayoutCreateInfo &info) const {
+    return layouts->pipelineLayout(h, info);
+  }
+
+  [[nodiscard]] bool hasExtension(std::string_view name) const {
+    return std::find(extensions.begin(), extensions.end(), name) !=
+           extensions.end();
+  }
+
   vk::raii::PhysicalDevice physical{nullptr};
   vk::raii::Device h{nullptr};
   std::unordered_map<std::string, std::unique_ptr<QueueFamily>> queueFamilies;
   std::unordered_map<std::string, std::unique_ptr<Queue>> queues;
+  std::vector<std::string> extensions;
+  // optional features and extensions granted on creation
+  Capabilities capabilities;
+  DescriptorBackend descriptorBackend{DescriptorBackend::ePool};
+  std::unique_ptr<LayoutCache> layouts;
   VmaAllocator allocator{};
 };
 
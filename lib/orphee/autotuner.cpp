@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include <orphee/autotuner.hpp>
+#include <orphee/trace.hpp>
+
+namespace orphee {
+namespace {
+std::string toString(const Specialization &s) {
+  std::string str;
+  for (const auto &[id, value] : s) {
+    str += (str.empty() ? "" : " ") + std::to_string(id) + "=" +
+           std::to_string(value);
+  }
+
+  return str;
+}
+} // namespace
+
+std::vector<Specialization>
+localSizeCandidates(const Device &device, const ShaderReflection &kernel,
+                    uint32_t dims) {
+  for (uint32_t i = 0; i < dims; ++i) {
+    if (!kernel.localSizeIds[i]) {
+      throw std::runtime_error("Kernel workgroup size is not specialized");
+    }
+  }
+
+  const auto limits = device.physical.getProperties().limits;
+  const auto maxInvocations =
+      std::min(limits.maxComputeWorkGroupInvocations, 1024U);
+
+  std::vector<Specialization> candidates;
+  Specialization defaults;
+  for (uint32_t i = 0; i < dims; ++i) {
+    defaults[*kernel.localSizeIds[i]] = kernel.localSize[i];
+  }
+  candidates.push_back(defaults);
+
+  const auto maxY =
+      dims > 1 ? std::min(32U, limits.maxComputeWorkGroupSize[1]) : 1U;
+  for (uint32_t x = 1; x <= limits.maxComputeWorkGroupSize[0]; x *= 2) {
+    for (uint32_t y = 1; y <= maxY; y *= 2) {
+      // smaller groups leave SIMD lanes idle on every vendor
+      if (x * y < 32 || x * y > maxInvocations) {
+        continue;
+      }
+
+      Specialization s{{*kernel.localSizeIds[0], x}};
+      if (dims > 1) {
+        s[*kernel.localSizeIds[1]] = y;
+      }
+      if (s != defaults) {
+        candidates.push_back(s);
+      }
+    }
+  }
+
+  return candidates;
+}
+
+std::vector<Specialization> expand(std::span<const Specialization> candidates,
+                                   uint32_t id,
+                                   std::span<const uint32_t> values) {
+  std::vector<Specialization> expanded;
+  expanded.reserve(candidates.size() * values.size());
+  for (const auto &c : candidates) {
+    for (const auto v : values) {
+      auto s = c;
+      s[id] = v;
+      expanded.push_back(std::move(s));
+    }
+  }
+
+  return expanded;
+}
+
+Autotuner::Autotuner(const Device &device, Queue &queue, AutotunerSettings s)
+    : settings{std::move(s)}, device{&device}, queue{&queue} {
+  const auto properties =
+      device.physical.getProperties2<vk::PhysicalDeviceProperties2,
+                                     vk::PhysicalDeviceIDProperties>();
+  for (const auto b :
+       properties.get<vk::PhysicalDeviceIDProperties>().deviceUUID) {
+    uuid += fmt::format("{:02x}", b);
+  }
+
+  CP = device.h.createCommandPool(
+      {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, queue.fIdx});
+  CMD = std::move(
+      device.h.allocateCommandBuffers({CP, vk::CommandBufferLevel::ePrimary, 1})
+          .front());
+  fence = device.h.createFence({});
+  // without timestamps on the queue runs are timed on the host
+  const auto families = device.physical.getQueueFamilyProperties();
+  if (families.at(queue.fIdx).timestampValidBits != 0) {
+    timestamps = device.h.createQueryPool({{}, vk::QueryType::eTimestamp, 2});
+    timestampPeriod =
+        properties.get<vk::PhysicalDeviceProperties2>().properties.limits
+            .timestampPeriod;
+  }
+
+  load();
+}
+
+Specialization Autotuner::tune(const std::string &key,
+                               std::span<const Specialization> candidates,
+                               const Build &build, const Record &record) {
+  ORPHEE_ZONE("Autotuner::tune");
+  auto &stored = choices[uuid];
+  if (const auto it = stored.find(key); it != stored.end()) {
+    if (std::find(candidates.begin(), candidates.end(), it->second) !=
+        candidates.end()) {
+      spdlog::info("Autotuner: {} uses {}", key, toString(it->second));
+      return it->second;
+    }
+  }
+
+  std::optional<Specialization> best;
+  double bestTime = 0.0;
+  for (const auto &c : candidates) {
+    try {
+      const auto kernel = build(c);
+      const auto t = time(kernel, record);
+      spdlog::debug("Autotuner: {} [{}] {} ms", key, toString(c), t);
+
+      if (!best || t < bestTime) {
+        best = c;
+        bestTime = t;
+      }
+    } catch (const std::exception &e) {
+      // e.g. a shape the compiler can not fit in registers
+      spdlog::warn("Autotuner: {} [{}] failed: {}", key, toString(c),
+                   e.what());
+    }
+  }
+
+  if (!best) {
+    throw std::runtime_error("No variant of " + key + " could be built");
+  }
+
+  spdlog::info("Autotuner: {} picked {} ({} ms)", key, toString(*best),
+               bestTime);
+  stored[key] = *best;
+  save();
+
+  return *best;
+}
+
+double Autotuner::time(const ComputeKernel &kernel, const Record &record) {
+  std::vector<double> samples;
+  for (uint32_t i = 0; i < settings.warmup + settings.iterations; ++i) {
+    CMD.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    if (*timestamps) {
+      CMD.resetQueryPool(timestamps, 0, 2);
+      CMD.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, timestamps,
+                          0);
+    }
+    record(CMD, kernel);
+    if (*timestamps) {
+      CMD.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, timestamps,
+                          1);
+    }
+    CMD.end();
+
+    device->h.resetFences(*fence);
+    const auto start = std::chrono::steady_clock::now();
+
+    vk::CommandBufferSubmitInfo cmdSubmit{*CMD};
+    queue->h.submit2(vk::SubmitInfo2{{}, {}, cmdSubmit, {}}, fence);
+    const auto wR = device->h.waitForFences(*fence, vk::True, UINT64_MAX);
+    if (wR != vk::Result::eSuccess) {
+      throw std::runtime_error("Failed to wait for fence");
+    }
+
+    double ms =
+        std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - start)
+            .count();
+    if (*timestamps) {
+      const auto [qR, ticks] = timestamps.getResults<uint64_t>(
+          0, 2, 2 * sizeof(uint64_t), sizeof(uint64_t),
+          vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+      if (qR != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to read timestamps");
+      }
+      ms = static_cast<double>(ticks[1] - ticks[0]) * timestampPeriod * 1e-6;
+    }
+
+    if (i >= settings.warmup) {
+      samples.push_back(ms);
+    }
+  }
+
+  const auto median = samples.begin() + samples.size() / 2;
+  std::nth_element(samples.begin(), median, samples.end());
+
+  return *median;
+}
+
+void Autotuner::load() {
+  if (settings.cacheFile.empty()) {
+    return;
+  }
+
+  std::ifstream file{settings.cacheFile};
+  // one "uuid key id=value..." line per choice
+  for (std::string line; std::getline(file, line);) {
+    std::istringstream fields{line};
+    std::string deviceUUID;
+    std::string key;
+    if (!(fields >> deviceUUID >> key)) {
+      continue;
+    }
+
+    Specialization s;
+    for (std::string entry; fields >> entry;) {
+      const auto eq = entry.find('=');
+      if (eq == std::string::npos) {
+        continue;
+      }
+      s[static_cast<uint32_t>(std::stoul(entry.substr(0, eq)))] =
+          static_cast<uint32_t>(std::stoul(entry.substr(eq + 1)));
+    }
+    choices[deviceUUID][key] = std::move(s);
+  }
+}
+
+void Autotuner::save() const {
+  if (settings.cacheFile.empty()) {
+    return;
+  }
+
+  std::ofstream file{settings.cacheFile, std::ios::trunc};
+  for (const auto &[deviceUUID, keys] : choices) {
+    for (const auto &[key, s] : keys) {
+      file << deviceUUID << " " << key << " " << toString(s) << "\n";
+    }
+  }
+
+  if (!file) {
+    spdlog::warn("Failed to save autotuner choices to {}",
+                 settings.cacheFile.string());
+  }
+}
+} // namespace orphee
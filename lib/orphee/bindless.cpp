@@ -0,0 +1,181 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include <spdlog/spdlog.h>
+
+#include <orphee/bindless.hpp>
+
+namespace orphee {
+namespace {
+// indexed by BindlessHeap::Binding
+constexpr std::array<vk::DescriptorType, 4> TYPES{
+    vk::DescriptorType::eStorageBuffer, vk::DescriptorType::eStorageImage,
+    vk::DescriptorType::eSampledImage, vk::DescriptorType::eSampler};
+} // namespace
+
+BindlessHeap::BindlessHeap(const Device &device, BindlessHeapSettings s)
+    : settings{s}, device{&device} {
+  const auto properties =
+      device.physical.getProperties2<vk::PhysicalDeviceProperties2,
+                                     vk::PhysicalDeviceVulkan12Properties>();
+  const auto &limits =
+      properties.get<vk::PhysicalDeviceProperties2>().properties.limits;
+  const auto &p12 = properties.get<vk::PhysicalDeviceVulkan12Properties>();
+
+  capacity[eStorageBuffer] = std::min(
+      {s.storageBuffers, p12.maxDescriptorSetUpdateAfterBindStorageBuffers,
+       p12.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+  capacity[eStorageImage] = std::min(
+      {s.storageImages, p12.maxDescriptorSetUpdateAfterBindStorageImages,
+       p12.maxPerStageDescriptorUpdateAfterBindStorageImages});
+  capacity[eSampledImage] = std::min(
+      {s.sampledImages, p12.maxDescriptorSetUpdateAfterBindSampledImages,
+       p12.maxPerStageDescriptorUpdateAfterBindSampledImages});
+  capacity[eSampler] =
+      std::min({s.samplers, p12.maxDescriptorSetUpdateAfterBindSamplers,
+                p12.maxPerStageDescriptorUpdateAfterBindSamplers});
+  // every binding is visible to every stage, so together they must also
+  // fit the per stage limit, samplers do not count against it
+  const uint64_t resources = uint64_t{capacity[eStorageBuffer]} +
+                             capacity[eStorageImage] +
+                             capacity[eSampledImage];
+  const uint64_t maxResources = p12.maxPerStageUpdateAfterBindResources;
+  if (resources > maxResources) {
+    for (const auto b : {eStorageBuffer, eStorageImage, eSampledImage}) {
+      capacity[b] =
+          static_cast<uint32_t>(capacity[b] * maxResources / resources);
+    }
+  }
+  for (uint32_t b = 0; b < 4; ++b) {
+    live[b].resize(capacity[b]);
+  }
+  settings.pushConstantSize =
+      std::min(s.pushConstantSize, limits.maxPushConstantsSize);
+
+  spdlog::info("Bindless heap: {} storage buffers, {} storage images, {} "
+               "sampled images, {} samplers",
+               capacity[eStorageBuffer], capacity[eStorageImage],
+               capacity[eSampledImage], capacity[eSampler]);
+  /* layout */
+  std::array<vk::DescriptorSetLayoutBinding, 4> bindings{};
+  std::array<vk::DescriptorBindingFlags, 4> bindingFlags{};
+  std::array<vk::DescriptorPoolSize, 4> poolSizes{};
+  for (uint32_t b = 0; b < 4; ++b) {
+    bindings[b] = {b, TYPES[b], capacity[b], vk::ShaderStageFlagBits::eAll};
+    bindingFlags[b] = vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+                      vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending |
+                      vk::DescriptorBindingFlagBits::ePartiallyBound;
+    poolSizes[b] = {TYPES[b], capacity[b]};
+  }
+
+  vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{bindingFlags};
+  setLayout = device.descriptorSetLayout(
+      {vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool, bindings,
+       &bindingFlagsInfo});
+  /* set */
+  // the set lives as long as the pool, it is never freed on its own
+  pool = device.h.createDescriptorPool(
+      {vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind, 1, poolSizes});
+
+  auto sets = device.h.allocateDescriptorSets({*pool, setLayout});
+  set = sets.front().release();
+  /* pipeline layout */
+  vk::PushConstantRange argsRange{vk::ShaderStageFlagBits::eAll, 0,
+                                  settings.pushConstantSize};
+  layout = device.pipelineLayout({{}, setLayout, argsRange});
+}
+
+vk::DescriptorType BindlessHeap::typeOf(Binding b) { return TYPES.at(b); }
+
+BindlessHeap::Index BindlessHeap::addStorageBuffer(vk::Buffer buffer,
+                                                   vk::DeviceSize offset,
+                                                   vk::DeviceSize range) {
+  const auto i = allocate(eStorageBuffer);
+  setStorageBuffer(i, buffer, offset, range);
+
+  return i;
+}
+
+BindlessHeap::Index BindlessHeap::addStorageImage(vk::ImageView view,
+                                                  vk::ImageLayout layout) {
+  const auto i = allocate(eStorageImage);
+  setStorageImage(i, view, layout);
+
+  return i;
+}
+
+BindlessHeap::Index BindlessHeap::addSampledImage(vk::ImageView view,
+                                                  vk::ImageLayout layout) {
+  const auto i = allocate(eSampledImage);
+  setSampledImage(i, view, layout);
+
+  return i;
+}
+
+BindlessHeap::Index BindlessHeap::addSampler(vk::Sampler sampler) {
+  const auto i = allocate(eSampler);
+  setSampler(i, sampler);
+
+  return i;
+}
+
+void BindlessHeap::setStorageBuffer(Index i, vk::Buffer buffer,
+                                    vk::DeviceSize offset,
+                                    vk::DeviceSize range) {
+  vk::DescriptorBufferInfo info{buffer, offset, range};
+  write(eStorageBuffer, i, &info, nullptr);
+}
+
+void BindlessHeap::setStorageImage(Index i, vk::ImageView view,
+                                   vk::ImageLayout layout) {
+  vk::DescriptorImageInfo info{{}, view, layout};
+  write(eStorageImage, i, nullptr, &info);
+}
+
+void BindlessHeap::setSampledImage(Index i, vk::ImageView view,
+                                   vk::ImageLayout layout) {
+  vk::DescriptorImageInfo info{{}, view, layout};
+  write(eSampledImage, i, nullptr, &info);
+}
+
+void BindlessHeap::setSampler(Index i, vk::Sampler sampler) {
+  vk::DescriptorImageInfo info{sampler, {}, {}};
+  write(eSampler, i, nullptr, &info);
+}
+
+void BindlessHeap::remove(Binding b, Index i) {
+  if (i >= next[b] || !live[b][i]) {
+    throw std::runtime_error("Bindless index " + std::to_string(i) +
+                             " is not in use");
+  }
+
+  live[b][i] = false;
+  freed[b].push_back(i);
+}
+
+BindlessHeap::Index BindlessHeap::allocate(Binding b) {
+  if (!freed[b].empty()) {
+    const auto i = freed[b].back();
+    freed[b].pop_back();
+    live[b][i] = true;
+
+    return i;
+  }
+
+  if (next[b] >= capacity[b]) {
+    throw std::runtime_error("Bindless heap is full");
+  }
+
+  live[b][next[b]] = true;
+
+  return next[b]++;
+}
+
+void BindlessHeap::write(Binding b, Index i,
+                         const vk::DescriptorBufferInfo *bufferInfo,
+                         const vk::DescriptorImageInfo *imageInfo) {
+  vk::WriteDescriptorSet w{set, b, i, 1, TYPES[b], imageInfo, bufferInfo};
+  device->h.updateDescriptorSets(w, {});
+}
+} // namespace orphee
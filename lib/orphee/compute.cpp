@@ -0,0 +1,103 @@
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+#include <orphee/compute.hpp>
+
+namespace orphee {
+ComputeKernel::ComputeKernel(const Device &device,
+                             std::span<const uint32_t> code,
+                             const Specialization &specialization)
+    : reflection{reflect(code)}, specialization{specialization} {
+  const std::array<ShaderReflection, 1> stages{reflection};
+  auto r = reflectPipelineLayout(device, stages);
+  setLayouts = std::move(r.setLayouts);
+  layout = r.layout;
+
+  createPipeline(device, code);
+}
+
+ComputeKernel::ComputeKernel(
+    const Device &device, std::span<const uint32_t> code, uint32_t argsSize,
+    std::span<const vk::DescriptorSetLayout> setLayouts)
+    : reflection{reflect(code)},
+      setLayouts{setLayouts.begin(), setLayouts.end()} {
+  vk::PushConstantRange argsRange{vk::ShaderStageFlagBits::eCompute, 0,
+                                  argsSize};
+  layout = device.pipelineLayout(
+      {{},
+       static_cast<uint32_t>(this->setLayouts.size()),
+       this->setLayouts.data(),
+       1,
+       &argsRange});
+
+  createPipeline(device, code);
+}
+
+ComputeKernel::ComputeKernel(const Device &device,
+                             std::span<const uint32_t> code,
+                             const BindlessHeap &heap,
+                             const Specialization &specialization)
+    : reflection{reflect(code)}, specialization{specialization},
+      setLayouts{heap.setLayout},
+      layout{heap.layout},
+      argsStages{vk::ShaderStageFlagBits::eAll} {
+  for (const auto &b : reflection.bindings) {
+    const auto binding = static_cast<BindlessHeap::Binding>(b.binding);
+    if (b.set != 0 || b.binding > BindlessHeap::eSampler ||
+        BindlessHeap::typeOf(binding) != b.type) {
+      throw std::runtime_error("Binding " + b.name +
+                               " is not part of the bindless heap");
+    }
+  }
+
+  if (reflection.pushConstants &&
+      reflection.pushConstants->size > heap.settings.pushConstantSize) {
+    throw std::runtime_error("Kernel arguments exceed the heap push "
+                             "constant range");
+  }
+
+  createPipeline(device, code);
+}
+
+void ComputeKernel::createPipeline(const Device &device,
+                                   std::span<const uint32_t> code) {
+  /* specialization */
+  localSize = reflection.localSize;
+  std::vector<vk::SpecializationMapEntry> entries;
+  std::vector<uint32_t> data;
+  for (const auto &[id, value] : specialization) {
+    const auto &constants = reflection.specializationConstants;
+    const auto c = std::find_if(constants.begin(), constants.end(),
+                                [id](const auto &sc) { return sc.id == id; });
+    if (c == constants.end() || c->size != sizeof(uint32_t)) {
+      throw std::runtime_error("Kernel has no 32-bit specialization "
+                               "constant " +
+                               std::to_string(id));
+    }
+
+    entries.emplace_back(id, data.size() * sizeof(uint32_t),
+                         sizeof(uint32_t));
+    data.push_back(value);
+
+    for (uint32_t i = 0; i < 3; ++i) {
+      if (reflection.localSizeIds[i] == id) {
+        localSize[i] = value;
+      }
+    }
+  }
+  const vk::SpecializationInfo specializationInfo{entries, data};
+  /* pipeline */
+  const auto module =
+      device.h.createShaderModule({{}, code.size_bytes(), code.data()});
+  vk::PipelineShaderStageCreateInfo stageInfo{
+      {},
+      vk::ShaderStageFlagBits::eCompute,
+      *module,
+      "main",
+      entries.empty() ? nullptr : &specializationInfo};
+
+  pipeline = device.h.createComputePipeline(
+      nullptr, {{}, stageInfo, layout, {}, {}});
+}
+} // namespace orphee
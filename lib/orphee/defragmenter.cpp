@@ -0,0 +1,392 @@
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <orphee/defragmenter.hpp>
+#include <orphee/trace.hpp>
+
+namespace orphee {
+namespace {
+vk::ImageAspectFlags aspectOf(vk::Format format) {
+  switch (format) {
+  case vk::Format::eD16Unorm:
+  case vk::Format::eX8D24UnormPack32:
+  case vk::Format::eD32Sfloat:
+    return vk::ImageAspectFlagBits::eDepth;
+  case vk::Format::eS8Uint:
+    return vk::ImageAspectFlagBits::eStencil;
+  case vk::Format::eD16UnormS8Uint:
+  case vk::Format::eD24UnormS8Uint:
+  case vk::Format::eD32SfloatS8Uint:
+    return vk::ImageAspectFlagBits::eDepth | vk::ImageAspectFlagBits::eStencil;
+  default:
+    return vk::ImageAspectFlagBits::eColor;
+  }
+}
+
+bool dedicated(VmaAllocator allocator, VmaAllocation allocation) {
+  VmaAllocationInfo2 info{};
+  vmaGetAllocationInfo2(allocator, allocation, &info);
+  if (info.dedicatedMemory == VK_FALSE) {
+    return false;
+  }
+
+  spdlog::warn("Dedicated allocations can not be defragmented, create the "
+               "resource with Placement::eMovable");
+  return true;
+}
+
+// moves copy the contents from the old resource into the new one
+void requireCopyable(vk::BufferUsageFlags usage) {
+  const auto copy = vk::BufferUsageFlagBits::eTransferSrc |
+                    vk::BufferUsageFlagBits::eTransferDst;
+  if ((usage & copy) != copy) {
+    throw std::runtime_error("Tracked buffers need eTransferSrc and "
+                             "eTransferDst usage");
+  }
+}
+
+void requireCopyable(vk::ImageUsageFlags usage, vk::ImageLayout layout) {
+  const auto copy = vk::ImageUsageFlagBits::eTransferSrc |
+                    vk::ImageUsageFlagBits::eTransferDst;
+  // undefined contents are not copied
+  if (layout != vk::ImageLayout::eUndefined && (usage & copy) != copy) {
+    throw std::runtime_error("Tracked images with defined contents need "
+                             "eTransferSrc and eTransferDst usage");
+  }
+}
+} // namespace
+
+Defragmenter::Defragmenter(const Device &device, Queue &queue,
+                           DefragmentationSettings s)
+    : settings{s}, device{&device}, queue{&queue} {
+  CP = device.h.createCommandPool(
+      {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, queue.fIdx});
+
+  CMD = std::move(
+      device.h.allocateCommandBuffers({CP, vk::CommandBufferLevel::ePrimary, 1})
+          .front());
+
+  fence = device.h.createFence({});
+}
+
+Defragmenter::~Defragmenter() {
+  if (context != nullptr) {
+    vmaEndDefragmentation(device->allocator, context, nullptr);
+  }
+}
+
+void Defragmenter::track(vmaBuffer &buffer, const vk::BufferCreateInfo &info,
+                         MoveCallback onMove) {
+  requireCopyable(info.usage);
+  if (dedicated(device->allocator, buffer.allocation)) {
+    return;
+  }
+
+  Resource r{};
+  r.buffer = &buffer;
+  r.bufferInfo = info;
+  r.onMove = std::move(onMove);
+
+  resources.insert_or_assign(buffer.allocation, std::move(r));
+}
+
+void Defragmenter::track(vmaImage &image, const vk::ImageCreateInfo &info,
+                         vk::ImageLayout layout, MoveCallback onMove) {
+  requireCopyable(info.usage, layout);
+  if (dedicated(device->allocator, image.allocation)) {
+    return;
+  }
+
+  Resource r{};
+  r.image = &image;
+  r.imageInfo = info;
+  r.layout = layout;
+  r.onMove = std::move(onMove);
+
+  resources.insert_or_assign(image.allocation, std::move(r));
+}
+
+void Defragmenter::untrack(const vmaBuffer &buffer) {
+  resources.erase(buffer.allocation);
+}
+
+void Defragmenter::untrack(const vmaImage &image) {
+  resources.erase(image.allocation);
+}
+
+void Defragmenter::setLayout(const vmaImage &image, vk::ImageLayout layout) {
+  auto &r = resources.at(image.allocation);
+  requireCopyable(r.imageInfo.usage, layout);
+  r.layout = layout;
+}
+
+float Defragmenter::fragmentation() const {
+  const VkPhysicalDeviceMemoryProperties *memoryProperties{};
+  vmaGetMemoryProperties(device->allocator, &memoryProperties);
+
+  std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+  vmaGetHeapBudgets(device->allocator, budgets.data());
+
+  float worst = 0.0F;
+  for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; ++i) {
+    const auto &s = budgets[i].statistics;
+    // a single block can not be compacted into fewer blocks
+    if (s.blockCount < 2) {
+      continue;
+    }
+
+    const auto unused = static_cast<float>(s.blockBytes - s.allocationBytes) /
+                        static_cast<float>(s.blockBytes);
+    worst = std::max(worst, unused);
+  }
+
+  return worst;
+}
+
+bool Defragmenter::update() {
+  ORPHEE_ZONE("Defragmenter::update");
+  if (context == nullptr) {
+    // nothing was allocated or freed since the last defragmentation
+    if (blockBytes() == idleBlockBytes) {
+      return false;
+    }
+
+    if (fragmentation() < settings.threshold) {
+      return false;
+    }
+
+    begin();
+  }
+
+  if (!pass()) {
+    end();
+    return false;
+  }
+
+  return true;
+}
+
+vk::DeviceSize Defragmenter::blockBytes() const {
+  const VkPhysicalDeviceMemoryProperties *memoryProperties{};
+  vmaGetMemoryProperties(device->allocator, &memoryProperties);
+
+  std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+  vmaGetHeapBudgets(device->allocator, budgets.data());
+
+  vk::DeviceSize total = 0;
+  for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; ++i) {
+    total += budgets[i].statistics.blockBytes;
+  }
+
+  return total;
+}
+
+void Defragmenter::begin() {
+  spdlog::info("Starting defragmentation, fragmentation {:.2f}",
+               fragmentation());
+
+  VmaDefragmentationInfo info{};
+  info.flags = VMA_DEFRAGMENTATION_FLAG_ALGORITHM_BALANCED_BIT;
+  info.maxBytesPerPass = settings.maxBytesPerPass;
+  info.maxAllocationsPerPass = settings.maxAllocationsPerPass;
+
+  const auto bR = vmaBeginDefragmentation(device->allocator, &info, &context);
+  if (bR != VK_SUCCESS) {
+    throw std::runtime_error("Failed to begin defragmentation");
+  }
+}
+
+void Defragmenter::end() {
+  VmaDefragmentationStats stats{};
+  vmaEndDefragmentation(device->allocator, context, &stats);
+  context = nullptr;
+  idleBlockBytes = blockBytes();
+
+  spdlog::info("Defragmentation moved {} allocations ({} bytes), freed {} "
+               "blocks ({} bytes)",
+               stats.allocationsMoved, stats.bytesMoved,
+               stats.deviceMemoryBlocksFreed, stats.bytesFreed);
+}
+
+bool Defragmenter::pass() {
+  VmaDefragmentationPassMoveInfo passInfo{};
+  const auto bR =
+      vmaBeginDefragmentationPass(device->allocator, context, &passInfo);
+  if (bR == VK_SUCCESS) {
+    return false;
+  }
+  if (bR != VK_INCOMPLETE) {
+    throw std::runtime_error("Failed to begin defragmentation pass");
+  }
+
+  std::vector<Move> moves;
+  moves.reserve(passInfo.moveCount);
+
+  CMD.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+  for (uint32_t i = 0; i < passInfo.moveCount; ++i) {
+    auto &vm = passInfo.pMoves[i];
+
+    const auto rIt = resources.find(vm.srcAllocation);
+    if (rIt == resources.end()) {
+      vm.operation = VMA_DEFRAGMENTATION_MOVE_OPERATION_IGNORE;
+      continue;
+    }
+
+    Move m{&rIt->second, vm.srcAllocation, {}, {}};
+    if (m.resource->buffer != nullptr) {
+      recordBufferMove(m, vm.dstTmpAllocation);
+    } else {
+      recordImageMove(m, vm.dstTmpAllocation);
+    }
+    moves.push_back(m);
+  }
+
+  // make the copies visible to every later submission on this queue
+  vk::MemoryBarrier2 movedBarrier{
+      vk::PipelineStageFlagBits2::eCopy, vk::AccessFlagBits2::eTransferWrite,
+      vk::PipelineStageFlagBits2::eAllCommands,
+      vk::AccessFlagBits2::eMemoryRead | vk::AccessFlagBits2::eMemoryWrite};
+  CMD.pipelineBarrier2({{}, movedBarrier, {}, {}});
+
+  CMD.end();
+
+  if (!moves.empty()) {
+    vk::CommandBufferSubmitInfo cmdSubmitInfo{*CMD};
+    vk::SubmitInfo2 submitInfo{{}, {}, cmdSubmitInfo, {}};
+    queue->h.submit2(submitInfo, *fence);
+
+    const auto wfR = device->h.waitForFences(*fence, vk::True, UINT64_MAX);
+    if (wfR != vk::Result::eSuccess) {
+      throw std::runtime_error("Failed to wait for fence");
+    }
+    device->h.resetFences(*fence);
+  }
+
+  // swap handles, the old ones are destroyed once VMA released the memory
+  for (auto &m : moves) {
+    if (m.resource->buffer != nullptr) {
+      std::swap(m.resource->buffer->h, m.buffer);
+    } else {
+      std::swap(m.resource->image->h, m.image);
+    }
+  }
+
+  const auto eR =
+      vmaEndDefragmentationPass(device->allocator, context, &passInfo);
+
+  const auto &dispatcher = *device->h.getDispatcher();
+  for (auto &m : moves) {
+    if (m.resource->buffer != nullptr) {
+      dispatcher.vkDestroyBuffer(*device->h, static_cast<VkBuffer>(m.buffer),
+                                 nullptr);
+      vmaGetAllocationInfo(device->allocator, m.allocation,
+                           &m.resource->buffer->allocationInfo);
+      if (m.resource->bufferInfo.usage &
+          vk::BufferUsageFlagBits::eShaderDeviceAddress) {
+        m.resource->buffer->address =
+            device->h.getBufferAddress({m.resource->buffer->h});
+      }
+    } else {
+      dispatcher.vkDestroyImage(*device->h, static_cast<VkImage>(m.image),
+                                nullptr);
+      vmaGetAllocationInfo(device->allocator, m.allocation,
+                           &m.resource->image->allocationInfo);
+    }
+
+    if (m.resource->onMove) {
+      m.resource->onMove();
+    }
+  }
+
+  return eR == VK_INCOMPLETE;
+}
+
+void Defragmenter::recordBufferMove(Move &m, VmaAllocation target) {
+  auto &r = *m.resource;
+
+  auto buffer = device->h.createBuffer(r.bufferInfo);
+  const auto bR = vmaBindBufferMemory(device->allocator, target, *buffer);
+  if (bR != VK_SUCCESS) {
+    throw std::runtime_error("Failed to bind buffer memory");
+  }
+  m.buffer = buffer.release();
+
+  vk::BufferCopy2 copyRegion{0, 0, r.bufferInfo.size};
+  CMD.copyBuffer2({r.buffer->h, m.buffer, copyRegion});
+}
+
+void Defragmenter::recordImageMove(Move &m, VmaAllocation target) {
+  auto &r = *m.resource;
+
+  auto image = device->h.createImage(r.imageInfo);
+  const auto bR = vmaBindImageMemory(device->allocator, target, *image);
+  if (bR != VK_SUCCESS) {
+    throw std::runtime_error("Failed to bind image memory");
+  }
+  m.image = image.release();
+
+  // undefined contents do not need to be preserved
+  if (r.layout == vk::ImageLayout::eUndefined) {
+    return;
+  }
+
+  const auto aspect = aspectOf(r.imageInfo.format);
+  const vk::ImageSubresourceRange range{aspect, 0, vk::RemainingMipLevels, 0,
+                                        vk::RemainingArrayLayers};
+
+  vk::ImageMemoryBarrier2 toCopySrc{vk::PipelineStageFlagBits2::eAllCommands,
+                                    vk::AccessFlagBits2::eMemoryWrite,
+                                    vk::PipelineStageFlagBits2::eCopy,
+                                    vk::AccessFlagBits2::eTransferRead,
+                                    r.layout,
+                                    vk::ImageLayout::eTransferSrcOptimal,
+                                    queue->fIdx,
+                                    queue->fIdx,
+                                    r.image->h,
+                                    range};
+  vk::ImageMemoryBarrier2 toCopyDst{vk::PipelineStageFlagBits2::eNone,
+                                    vk::AccessFlagBits2::eNone,
+                                    vk::PipelineStageFlagBits2::eCopy,
+                                    vk::AccessFlagBits2::eTransferWrite,
+                                    vk::ImageLayout::eUndefined,
+                                    vk::ImageLayout::eTransferDstOptimal,
+                                    queue->fIdx,
+                                    queue->fIdx,
+                                    m.image,
+                                    range};
+  std::array<vk::ImageMemoryBarrier2, 2> toCopyBarriers{toCopySrc, toCopyDst};
+  CMD.pipelineBarrier2({{}, {}, {}, toCopyBarriers});
+
+  std::vector<vk::ImageCopy2> regions;
+  for (uint32_t mip = 0; mip < r.imageInfo.mipLevels; ++mip) {
+    const vk::ImageSubresourceLayers layers{aspect, mip, 0,
+                                            r.imageInfo.arrayLayers};
+    const vk::Extent3D extent{std::max(1U, r.imageInfo.extent.width >> mip),
+                              std::max(1U, r.imageInfo.extent.height >> mip),
+                              std::max(1U, r.imageInfo.extent.depth >> mip)};
+    regions.emplace_back(layers, vk::Offset3D{}, layers, vk::Offset3D{},
+                         extent);
+  }
+
+  CMD.copyImage2({r.image->h, vk::ImageLayout::eTransferSrcOptimal, m.image,
+                  vk::ImageLayout::eTransferDstOptimal, regions});
+
+  vk::ImageMemoryBarrier2 toLayout{vk::PipelineStageFlagBits2::eCopy,
+                                   vk::AccessFlagBits2::eTransferWrite,
+                                   vk::PipelineStageFlagBits2::eAllCommands,
+                                   vk::AccessFlagBits2::eMemoryRead |
+                                       vk::AccessFlagBits2::eMemoryWrite,
+                                   vk::ImageLayout::eTransferDstOptimal,
+                                   r.layout,
+                                   queue->fIdx,
+                                   queue->fIdx,
+                                   m.image,
+                                   range};
+  CMD.pipelineBarrier2({{}, {}, {}, toLayout});
+}
+} // namespace orphee
@@ -0,0 +1,163 @@
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <spdlog/spdlog.h>
+
+#include <orphee/descriptorAllocator.hpp>
+
+namespace orphee {
+namespace {
+std::atomic<uint64_t> nextId{1};
+
+struct ThreadPools {
+  // expires with the allocator
+  std::weak_ptr<void> owner;
+  void *pools;
+};
+
+// expired entries are dropped when the thread registers with an allocator
+thread_local std::unordered_map<uint64_t, ThreadPools> threadPools;
+} // namespace
+
+DescriptorAllocator::DescriptorAllocator(const Device &device,
+                                         DescriptorAllocatorSettings s)
+    : settings{std::move(s)}, device{&device}, id{nextId++} {}
+
+vk::DescriptorSet
+DescriptorAllocator::allocate(vk::DescriptorSetLayout layout) {
+  auto &pools = local();
+
+  const auto *dispatcher = device->h.getDispatcher();
+  const auto vkLayout = static_cast<VkDescriptorSetLayout>(layout);
+  VkDescriptorSet set{};
+  const auto tryAllocate = [&](vk::DescriptorPool pool) {
+    VkDescriptorSetAllocateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    info.descriptorPool = static_cast<VkDescriptorPool>(pool);
+    info.descriptorSetCount = 1;
+    info.pSetLayouts = &vkLayout;
+
+    const auto r =
+        dispatcher->vkAllocateDescriptorSets(*device->h, &info, &set);
+    if (r != VK_SUCCESS && r != VK_ERROR_OUT_OF_POOL_MEMORY &&
+        r != VK_ERROR_FRAGMENTED_POOL) {
+      throw std::runtime_error("Failed to allocate descriptor set");
+    }
+
+    return r == VK_SUCCESS;
+  };
+
+  if (tryAllocate(*pools.current)) {
+    return set;
+  }
+
+  // recycled and growing pools until one fits, empty for unknown layouts
+  const auto sizes = device->layouts->poolSizes(layout);
+  if (fitsPool(sizes)) {
+    for (;;) {
+      const bool created = next(pools);
+      if (tryAllocate(*pools.current)) {
+        return set;
+      }
+      // an empty pool of the largest size can not hold it either
+      if (created && pools.setsPerPool == settings.maxSetsPerPool) {
+        throw std::runtime_error(
+            "Descriptor set layout does not fit in a pool");
+      }
+    }
+  }
+
+  spdlog::info("Descriptor set layout too large for the pool ratios, "
+               "allocating it from its own pool");
+  const auto &pool =
+      pools.oversized.emplace_back(device->h.createDescriptorPool(
+          {{}, 1, static_cast<uint32_t>(sizes.size()), sizes.data()}));
+  if (!tryAllocate(*pool)) {
+    throw std::runtime_error("Failed to allocate descriptor set");
+  }
+
+  return set;
+}
+
+void DescriptorAllocator::reset() {
+  std::lock_guard lock{mutex};
+
+  for (auto &pools : threads) {
+    pools->current.reset();
+    for (auto &p : pools->full) {
+      p.reset();
+      pools->ready.push_back(std::move(p));
+    }
+    pools->full.clear();
+    pools->oversized.clear();
+  }
+}
+
+DescriptorAllocator::Pools &DescriptorAllocator::local() {
+  const auto it = threadPools.find(id);
+  if (it != threadPools.end()) {
+    return *static_cast<Pools *>(it->second.pools);
+  }
+
+  auto pools = std::make_shared<Pools>();
+  pools->setsPerPool = settings.setsPerPool;
+  pools->current = createPool(pools->setsPerPool);
+
+  std::erase_if(threadPools,
+                [](const auto &e) { return e.second.owner.expired(); });
+  threadPools[id] = {pools, pools.get()};
+
+  std::lock_guard lock{mutex};
+  return *threads.emplace_back(std::move(pools));
+}
+
+bool DescriptorAllocator::next(Pools &pools) {
+  pools.full.push_back(std::move(pools.current));
+
+  if (!pools.ready.empty()) {
+    pools.current = std::move(pools.ready.back());
+    pools.ready.pop_back();
+    return false;
+  }
+
+  pools.setsPerPool = std::min(pools.setsPerPool * 2, settings.maxSetsPerPool);
+  spdlog::info("Growing descriptor allocator, new pool of {} sets",
+               pools.setsPerPool);
+
+  pools.current = createPool(pools.setsPerPool);
+  return true;
+}
+
+bool DescriptorAllocator::fitsPool(
+    const std::vector<vk::DescriptorPoolSize> &sizes) const {
+  for (const auto &size : sizes) {
+    const auto it =
+        std::find_if(settings.ratios.begin(), settings.ratios.end(),
+                     [&](const auto &r) { return r.first == size.type; });
+    if (it == settings.ratios.end()) {
+      return false;
+    }
+
+    const auto count = static_cast<uint32_t>(
+        it->second * static_cast<float>(settings.maxSetsPerPool));
+    if (size.descriptorCount > std::max(1U, count)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+vk::raii::DescriptorPool DescriptorAllocator::createPool(uint32_t sets) const {
+  std::vector<vk::DescriptorPoolSize> sizes;
+  for (const auto &[type, ratio] : settings.ratios) {
+    const auto count =
+        static_cast<uint32_t>(ratio * static_cast<float>(sets));
+    sizes.emplace_back(type, std::max(1U, count));
+  }
+
+  return device->h.createDescriptorPool({{}, sets, sizes});
+}
+} // namespace orphee
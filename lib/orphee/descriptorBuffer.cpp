@@ -0,0 +1,139 @@
+#include <cstddef>
+#include <stdexcept>
+
+#include <orphee/descriptorBuffer.hpp>
+
+namespace orphee {
+DescriptorBuffer::DescriptorBuffer(const Device &device,
+                                   vk::DescriptorSetLayout layout,
+                                   uint32_t bindingCount, uint32_t capacity)
+    : device{&device}, capacity{capacity} {
+  if (device.descriptorBackend != DescriptorBackend::eBuffer) {
+    throw std::runtime_error("Descriptor buffers are not enabled");
+  }
+
+  const auto p = device.physical.getProperties2<
+      vk::PhysicalDeviceProperties2,
+      vk::PhysicalDeviceDescriptorBufferPropertiesEXT>();
+  properties = p.get<vk::PhysicalDeviceDescriptorBufferPropertiesEXT>();
+  /* layout */
+  const auto *dispatcher = device.h.getDispatcher();
+
+  vk::DeviceSize layoutSize{};
+  dispatcher->vkGetDescriptorSetLayoutSizeEXT(
+      *device.h, static_cast<VkDescriptorSetLayout>(layout), &layoutSize);
+
+  const auto alignment = properties.descriptorBufferOffsetAlignment;
+  setSize = (layoutSize + alignment - 1) / alignment * alignment;
+
+  for (uint32_t b = 0; b < bindingCount; ++b) {
+    vk::DeviceSize offset{};
+    dispatcher->vkGetDescriptorSetLayoutBindingOffsetEXT(
+        *device.h, static_cast<VkDescriptorSetLayout>(layout), b, &offset);
+    bindingOffsets.push_back(offset);
+  }
+  /* buffer */
+  vk::BufferCreateInfo bufferInfo{
+      {},
+      setSize * capacity,
+      vk::BufferUsageFlagBits::eResourceDescriptorBufferEXT |
+          vk::BufferUsageFlagBits::eSamplerDescriptorBufferEXT |
+          vk::BufferUsageFlagBits::eShaderDeviceAddress,
+      vk::SharingMode::eExclusive,
+      {}};
+  // host visible device local memory when available (resizable BAR)
+  VmaAllocationCreateInfo allocationInfo{};
+  allocationInfo.flags =
+      VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT |
+      VMA_ALLOCATION_CREATE_MAPPED_BIT;
+  allocationInfo.usage = VMA_MEMORY_USAGE_AUTO;
+
+  buffer = device.createBuffer(bufferInfo, allocationInfo);
+}
+
+uint32_t DescriptorBuffer::allocate() {
+  if (next >= capacity) {
+    throw std::runtime_error("Descriptor buffer is full");
+  }
+
+  return next++;
+}
+
+void DescriptorBuffer::writeUniformBuffer(uint32_t set, uint32_t binding,
+                                          vk::DeviceAddress address,
+                                          vk::DeviceSize range,
+                                          uint32_t element) const {
+  vk::DescriptorAddressInfoEXT addressInfo{address, range};
+  write(set, binding, element,
+        {vk::DescriptorType::eUniformBuffer, &addressInfo},
+        properties.uniformBufferDescriptorSize);
+}
+
+void DescriptorBuffer::writeStorageBuffer(uint32_t set, uint32_t binding,
+                                          vk::DeviceAddress address,
+                                          vk::DeviceSize range,
+                                          uint32_t element) const {
+  vk::DescriptorAddressInfoEXT addressInfo{address, range};
+  write(set, binding, element,
+        {vk::DescriptorType::eStorageBuffer, &addressInfo},
+        properties.storageBufferDescriptorSize);
+}
+
+void DescriptorBuffer::writeStorageImage(uint32_t set, uint32_t binding,
+                                         vk::ImageView view,
+                                         uint32_t element) const {
+  vk::DescriptorImageInfo imageInfo{{}, view, vk::ImageLayout::eGeneral};
+  write(set, binding, element,
+        {vk::DescriptorType::eStorageImage, &imageInfo},
+        properties.storageImageDescriptorSize);
+}
+
+void DescriptorBuffer::writeSampledImage(uint32_t set, uint32_t binding,
+                                         vk::ImageView view,
+                                         uint32_t element) const {
+  vk::DescriptorImageInfo imageInfo{
+      {}, view, vk::ImageLayout::eShaderReadOnlyOptimal};
+  write(set, binding, element,
+        {vk::DescriptorType::eSampledImage, &imageInfo},
+        properties.sampledImageDescriptorSize);
+}
+
+void DescriptorBuffer::writeSampler(uint32_t set, uint32_t binding,
+                                    vk::Sampler sampler,
+                                    uint32_t element) const {
+  write(set, binding, element, {vk::DescriptorType::eSampler, &sampler},
+        properties.samplerDescriptorSize);
+}
+
+void DescriptorBuffer::bindBuffer(const vk::raii::CommandBuffer &cmd) const {
+  vk::DescriptorBufferBindingInfoEXT bindingInfo{
+      buffer.address, vk::BufferUsageFlagBits::eResourceDescriptorBufferEXT |
+                          vk::BufferUsageFlagBits::eSamplerDescriptorBufferEXT};
+  cmd.bindDescriptorBuffersEXT(bindingInfo);
+}
+
+void DescriptorBuffer::bind(const vk::raii::CommandBuffer &cmd,
+                            vk::PipelineBindPoint bindPoint,
+                            vk::PipelineLayout pipelineLayout,
+                            uint32_t firstSet, uint32_t set) const {
+  const uint32_t bufferIndex = 0;
+  const vk::DeviceSize offset = set * setSize;
+  cmd.setDescriptorBufferOffsetsEXT(bindPoint, pipelineLayout, firstSet,
+                                    bufferIndex, offset);
+}
+
+void DescriptorBuffer::write(uint32_t set, uint32_t binding, uint32_t element,
+                             const vk::DescriptorGetInfoEXT &info,
+                             size_t size) const {
+  const vk::DeviceSize offset =
+      set * setSize + bindingOffsets.at(binding) + element * size;
+  auto *data =
+      static_cast<std::byte *>(buffer.allocationInfo.pMappedData) + offset;
+  device->h.getDescriptorEXT(info, size, data);
+  // AUTO may pick non-coherent memory, VMA skips the flush on coherent
+  if (vmaFlushAllocation(buffer.allocator, buffer.allocation, offset, size) !=
+      VK_SUCCESS) {
+    throw std::runtime_error("Failed to flush descriptor buffer");
+  }
+}
+} // namespace orphee
@@ -0,0 +1,357 @@
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <stdexcept>
+#include <numeric>
+
+#include <spdlog/spdlog.h>
+
+#include <orphee/gpuProfiler.hpp>
+#include <orphee/trace.hpp>
+
+namespace orphee {
+namespace {
+int64_t hostNow() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+} // namespace
+
+double GpuPass::percentile(double p) const {
+  if (samples.empty()) {
+    return 0.0;
+  }
+
+  auto sorted = samples;
+  const auto nth =
+      sorted.begin() + static_cast<std::ptrdiff_t>(
+                           std::clamp(p, 0.0, 1.0) *
+                           static_cast<double>(sorted.size() - 1));
+  std::nth_element(sorted.begin(), nth, sorted.end());
+
+  return *nth;
+}
+
+GpuProfiler::Scope::~Scope() {
+  if (profiler == nullptr) {
+    return;
+  }
+
+  const auto &pools = profiler->pools;
+  const auto &f = pools[profiler->frameIndex % pools.size()];
+  if (counting) {
+    cmd->endQuery(f.statistics, f.scopes[query / 2].counted);
+    profiler->counting = false;
+  }
+  cmd->writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, f.timestamps,
+                       query + 1);
+  --profiler->depth;
+}
+
+GpuProfiler::GpuProfiler(const Device &device, const Queue &queue,
+                         GpuProfilerSettings s)
+    : settings{std::move(s)} {
+  settings.framesInFlight = std::max(1U, settings.framesInFlight);
+  settings.history = std::max(1U, settings.history);
+  frameStats.name = "frame";
+
+  const auto bits = device.physical.getQueueFamilyProperties()
+                        .at(queue.fIdx)
+                        .timestampValidBits;
+  if (bits == 0) {
+    spdlog::warn("GPU profiler: queue family {} does not support timestamps",
+                 queue.fIdx);
+    return;
+  }
+  validMask = bits >= 64 ? ~uint64_t{0} : (uint64_t{1} << bits) - 1;
+  timestampPeriod = device.physical.getProperties().limits.timestampPeriod;
+
+  if (settings.statistics && !device.capabilities.pipelineStatisticsQuery) {
+    spdlog::warn("GPU profiler: pipeline statistics are not enabled");
+    settings.statistics = {};
+  }
+  // graphics statistics are invalid on other queues
+  if (!(queue.queueFamily->capabilities & vk::QueueFlagBits::eGraphics)) {
+    settings.statistics &=
+        vk::QueryPipelineStatisticFlagBits::eComputeShaderInvocations;
+  }
+  for (uint32_t bit = 1; bit != 0; bit <<= 1) {
+    const auto s = static_cast<vk::QueryPipelineStatisticFlagBits>(bit);
+    if (settings.statistics & s) {
+      statistics.push_back(s);
+    }
+  }
+
+  pools.reserve(settings.framesInFlight);
+  for (uint32_t i = 0; i < settings.framesInFlight; ++i) {
+    Frame f;
+    f.timestamps = device.h.createQueryPool(
+        {{}, vk::QueryType::eTimestamp, 2 * settings.maxScopes});
+    if (!statistics.empty()) {
+      f.statistics = device.h.createQueryPool(
+          {{},
+           vk::QueryType::ePipelineStatistics,
+           settings.maxScopes,
+           settings.statistics});
+    }
+    pools.push_back(std::move(f));
+  }
+
+  calibrate(device, queue);
+}
+
+void GpuProfiler::beginFrame(const vk::raii::CommandBuffer &cmd) {
+  ORPHEE_ZONE("GpuProfiler::beginFrame");
+  if (!enabled()) {
+    return;
+  }
+
+  ++frameIndex;
+  auto &f = pools[frameIndex % pools.size()];
+  if (!f.scopes.empty()) {
+    resolve(f);
+  }
+
+  f.scopes.clear();
+  f.counted = 0;
+  f.index = frameIndex;
+  depth = 0;
+  counting = false;
+  cmd.resetQueryPool(f.timestamps, 0, 2 * settings.maxScopes);
+  if (*f.statistics) {
+    cmd.resetQueryPool(f.statistics, 0, settings.maxScopes);
+  }
+}
+
+GpuProfiler::Scope GpuProfiler::scope(const vk::raii::CommandBuffer &cmd,
+                                      std::string_view name) {
+  if (!enabled()) {
+    return Scope{nullptr, cmd, 0, false};
+  }
+
+  auto &f = pools[frameIndex % pools.size()];
+  if (f.scopes.size() >= settings.maxScopes) {
+    if (!overflow) {
+      spdlog::warn("GPU profiler: more than {} scopes in a frame",
+                   settings.maxScopes);
+      overflow = true;
+    }
+    return Scope{nullptr, cmd, 0, false};
+  }
+
+  const auto query = static_cast<uint32_t>(2 * f.scopes.size());
+  // only one statistics query of a pool may be active at a time
+  const auto count = *f.statistics && !counting;
+  f.scopes.push_back(
+      {passIndex(name), depth++, count ? f.counted++ : UINT32_MAX});
+  cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, f.timestamps,
+                      query);
+  if (count) {
+    cmd.beginQuery(f.statistics, f.scopes.back().counted, {});
+    counting = true;
+  }
+
+  return Scope{this, cmd, query, count};
+}
+
+void GpuProfiler::calibrate(const Device &device, const Queue &queue) {
+  const auto commandPool = device.h.createCommandPool(
+      {vk::CommandPoolCreateFlagBits::eTransient, queue.fIdx});
+  const auto commandBuffers = device.h.allocateCommandBuffers(
+      {commandPool, vk::CommandBufferLevel::ePrimary, 1});
+  const auto &cmd = commandBuffers.front();
+  const auto fence = device.h.createFence({});
+  const auto &pool = pools.front().timestamps;
+
+  cmd.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  cmd.resetQueryPool(pool, 0, 1);
+  cmd.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, pool, 0);
+  cmd.end();
+
+  const vk::CommandBufferSubmitInfo cmdSubmit{*cmd};
+  const auto before = hostNow();
+  queue.h.submit2(vk::SubmitInfo2{{}, {}, cmdSubmit, {}}, fence);
+  const auto wR = device.h.waitForFences(*fence, vk::True, UINT64_MAX);
+  if (wR != vk::Result::eSuccess) {
+    throw std::runtime_error("Failed to wait for fence");
+  }
+  const auto after = hostNow();
+
+  const auto [qR, ticks] = pool.getResults<uint64_t>(
+      0, 1, sizeof(uint64_t), sizeof(uint64_t),
+      vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+  if (qR != vk::Result::eSuccess) {
+    throw std::runtime_error("Failed to read timestamps");
+  }
+
+  // the timestamp was written somewhere between submission and the wait
+  hostOffset = before + (after - before) / 2 -
+               static_cast<int64_t>(static_cast<double>(ticks[0] & validMask) *
+                                    timestampPeriod);
+}
+
+void GpuProfiler::resolve(Frame &f) {
+  const auto count = static_cast<uint32_t>(2 * f.scopes.size());
+  // the frame is complete when the pool comes around, never wait on it
+  const auto [r, ticks] = f.timestamps.getResults<uint64_t>(
+      0, count, count * sizeof(uint64_t), sizeof(uint64_t),
+      vk::QueryResultFlagBits::e64);
+  if (r != vk::Result::eSuccess) {
+    spdlog::debug("GPU profiler: frame {} is not complete, skipped", f.index);
+    return;
+  }
+
+  const auto n = statistics.size();
+  std::vector<uint64_t> counts;
+  if (f.counted > 0) {
+    const auto stride = n * sizeof(uint64_t);
+    auto [sR, values] = f.statistics.getResults<uint64_t>(
+        0, f.counted, f.counted * stride, stride,
+        vk::QueryResultFlagBits::e64);
+    if (sR != vk::Result::eSuccess) {
+      spdlog::debug("GPU profiler: frame {} is not complete, skipped",
+                    f.index);
+      return;
+    }
+    counts = std::move(values);
+  }
+
+  const auto ms = [this](uint64_t from, uint64_t to) {
+    return static_cast<double>((to - from) & validMask) * timestampPeriod *
+           1e-6;
+  };
+
+  const auto host = [this](uint64_t tick) {
+    return hostOffset + static_cast<int64_t>(
+                            static_cast<double>(tick & validMask) *
+                            timestampPeriod);
+  };
+
+  const auto origin = ticks[0];
+  double end = 0.0;
+  for (size_t i = 0; i < f.scopes.size(); ++i) {
+    const auto &s = f.scopes[i];
+    auto &pass = stats[s.pass];
+    if (pass.frame != f.index) {
+      pass.frame = f.index;
+      pass.last = 0.0;
+      pass.start = ms(origin, ticks[2 * i]);
+      pass.depth = s.depth;
+      pass.counters.clear();
+    }
+    pass.last += ms(ticks[2 * i], ticks[2 * i + 1]);
+    if (s.counted != UINT32_MAX) {
+      pass.counters.resize(n);
+      for (size_t c = 0; c < n; ++c) {
+        pass.counters[c] += counts[s.counted * n + c];
+      }
+    }
+    end = std::max(end, ms(origin, ticks[2 * i + 1]));
+
+    const GpuEvent event{s.pass, s.depth, host(ticks[2 * i]),
+                         host(ticks[2 * i + 1])};
+    if (timeline.size() < settings.maxScopes * settings.history) {
+      timeline.push_back(event);
+    } else {
+      timeline[timelineNext] = event;
+      timelineNext = (timelineNext + 1) % timeline.size();
+    }
+  }
+
+  for (auto &pass : stats) {
+    if (pass.frame == f.index) {
+      record(pass, pass.last);
+    }
+  }
+
+  frameStats.frame = f.index;
+  frameStats.last = end;
+  record(frameStats, end);
+  resolvedFrame = f.index;
+}
+
+void GpuProfiler::record(GpuPass &pass, double ms) const {
+  if (pass.samples.size() < settings.history) {
+    pass.samples.push_back(ms);
+  } else {
+    pass.samples[pass.next] = ms;
+  }
+  pass.next = (pass.next + 1) % settings.history;
+}
+
+void GpuProfiler::save(const std::filesystem::path &file) const {
+  std::ofstream out{file, std::ios::trunc};
+  const auto json = file.extension() == ".json";
+
+  std::vector<std::string> columns;
+  for (const auto s : statistics) {
+    columns.push_back(vk::to_string(s));
+  }
+
+  const auto row = [&](const GpuPass &pass, bool last) {
+    const auto mean =
+        pass.samples.empty()
+            ? 0.0
+            : std::accumulate(pass.samples.begin(), pass.samples.end(), 0.0) /
+                  static_cast<double>(pass.samples.size());
+    if (json) {
+      out << fmt::format("    {{\"pass\": \"{}\", \"frames\": {}, "
+                         "\"lastMs\": {}, \"meanMs\": {}, \"p50Ms\": {}, "
+                         "\"p95Ms\": {}, \"p99Ms\": {}",
+                         pass.name, pass.samples.size(), pass.last, mean,
+                         pass.percentile(0.5), pass.percentile(0.95),
+                         pass.percentile(0.99));
+      for (size_t c = 0; c < pass.counters.size(); ++c) {
+        out << fmt::format(", \"{}\": {}", columns[c], pass.counters[c]);
+      }
+      out << (last ? "}\n" : "},\n");
+    } else {
+      out << fmt::format("{},{},{},{},{},{},{}", pass.name,
+                         pass.samples.size(), pass.last, mean,
+                         pass.percentile(0.5), pass.percentile(0.95),
+                         pass.percentile(0.99));
+      for (size_t c = 0; c < columns.size(); ++c) {
+        out << ",";
+        if (c < pass.counters.size()) {
+          out << pass.counters[c];
+        }
+      }
+      out << "\n";
+    }
+  };
+
+  if (json) {
+    out << "{\n  \"passes\": [\n";
+  } else {
+    out << "pass,frames,lastMs,meanMs,p50Ms,p95Ms,p99Ms";
+    for (const auto &column : columns) {
+      out << "," << column;
+    }
+    out << "\n";
+  }
+  for (const auto &pass : stats) {
+    row(pass, false);
+  }
+  row(frameStats, true);
+  if (json) {
+    out << "  ]\n}\n";
+  }
+
+  if (!out) {
+    spdlog::warn("Failed to save the GPU profile to {}", file.string());
+  }
+}
+
+uint32_t GpuProfiler::passIndex(std::string_view name) {
+  const auto [it, inserted] = names.try_emplace(
+      std::string{name}, static_cast<uint32_t>(stats.size()));
+  if (inserted) {
+    GpuPass pass;
+    pass.name = name;
+    stats.push_back(std::move(pass));
+  }
+
+  return it->second;
+}
+} // namespace orphee
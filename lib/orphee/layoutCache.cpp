@@ -0,0 +1,159 @@
+#include <algorithm>
+#include <functional>
+#include <mutex>
+
+#include <orphee/layoutCache.hpp>
+
+namespace orphee {
+namespace {
+template <typename T> void combine(size_t &seed, const T &v) {
+  seed ^= std::hash<T>{}(v) + 0x9e3779b9 + (seed << 6U) + (seed >> 2U);
+}
+
+template <typename Map, typename Create>
+auto lookup(std::shared_mutex &mutex, Map &map, typename Map::key_type key,
+            Create create) {
+  {
+    std::shared_lock lock{mutex};
+    const auto it = map.find(key);
+    if (it != map.end()) {
+      return *it->second;
+    }
+  }
+
+  std::unique_lock lock{mutex};
+  // another thread may have created it in between
+  auto it = map.find(key);
+  if (it == map.end()) {
+    it = map.emplace(std::move(key), create()).first;
+  }
+
+  return *it->second;
+}
+} // namespace
+
+vk::DescriptorSetLayout LayoutCache::descriptorSetLayout(
+    const vk::raii::Device &device,
+    const vk::DescriptorSetLayoutCreateInfo &info) {
+  using BindingFlagsInfo = vk::DescriptorSetLayoutBindingFlagsCreateInfo;
+
+  const vk::DescriptorBindingFlags *bindingFlags = nullptr;
+  for (const auto *next = static_cast<const vk::BaseInStructure *>(info.pNext);
+       next != nullptr; next = next->pNext) {
+    if (next->sType == BindingFlagsInfo::structureType) {
+      bindingFlags =
+          reinterpret_cast<const BindingFlagsInfo *>(next)->pBindingFlags;
+    }
+  }
+
+  SetLayoutKey key{info.flags, {}};
+  for (uint32_t i = 0; i < info.bindingCount; ++i) {
+    Binding b{info.pBindings[i], {}, {}};
+    if (b.binding.pImmutableSamplers != nullptr) {
+      b.immutableSamplers.assign(b.binding.pImmutableSamplers,
+                                 b.binding.pImmutableSamplers +
+                                     b.binding.descriptorCount);
+      b.binding.pImmutableSamplers = nullptr;
+    }
+    if (bindingFlags != nullptr) {
+      b.flags = bindingFlags[i];
+    }
+    key.bindings.push_back(std::move(b));
+  }
+  // binding order in the create info does not matter
+  std::sort(key.bindings.begin(), key.bindings.end(),
+            [](const Binding &a, const Binding &b) {
+              return a.binding.binding < b.binding.binding;
+            });
+
+  // runs under the exclusive lock
+  return lookup(mutex, setLayouts, std::move(key), [&] {
+    auto layout = device.createDescriptorSetLayout(info);
+
+    std::vector<vk::DescriptorPoolSize> sizes;
+    for (uint32_t i = 0; i < info.bindingCount; ++i) {
+      const auto &b = info.pBindings[i];
+      const auto it = std::find_if(
+          sizes.begin(), sizes.end(),
+          [&](const auto &s) { return s.type == b.descriptorType; });
+      if (it != sizes.end()) {
+        it->descriptorCount += b.descriptorCount;
+      } else {
+        sizes.emplace_back(b.descriptorType, b.descriptorCount);
+      }
+    }
+    setLayoutSizes.insert_or_assign(*layout, std::move(sizes));
+
+    return layout;
+  });
+}
+
+vk::PipelineLayout
+LayoutCache::pipelineLayout(const vk::raii::Device &device,
+                            const vk::PipelineLayoutCreateInfo &info) {
+  PipelineLayoutKey key{
+      info.flags,
+      {info.pSetLayouts, info.pSetLayouts + info.setLayoutCount},
+      {info.pPushConstantRanges,
+       info.pPushConstantRanges + info.pushConstantRangeCount}};
+
+  return lookup(mutex, pipelineLayouts, std::move(key),
+                [&] { return device.createPipelineLayout(info); });
+}
+
+std::vector<vk::DescriptorPoolSize>
+LayoutCache::poolSizes(vk::DescriptorSetLayout layout) const {
+  std::shared_lock lock{mutex};
+  const auto it = setLayoutSizes.find(layout);
+  if (it == setLayoutSizes.end()) {
+    return {};
+  }
+
+  return it->second;
+}
+
+size_t LayoutCache::size() const {
+  std::shared_lock lock{mutex};
+  return setLayouts.size() + pipelineLayouts.size();
+}
+
+bool LayoutCache::Binding::operator==(const Binding &other) const {
+  return binding.binding == other.binding.binding &&
+         binding.descriptorType == other.binding.descriptorType &&
+         binding.descriptorCount == other.binding.descriptorCount &&
+         binding.stageFlags == other.binding.stageFlags &&
+         immutableSamplers == other.immutableSamplers && flags == other.flags;
+}
+
+size_t LayoutCache::Hash::operator()(const SetLayoutKey &k) const {
+  size_t seed = 0;
+  combine(seed, static_cast<uint32_t>(k.flags));
+  for (const auto &b : k.bindings) {
+    combine(seed, b.binding.binding);
+    combine(seed, static_cast<uint32_t>(b.binding.descriptorType));
+    combine(seed, b.binding.descriptorCount);
+    combine(seed, static_cast<uint32_t>(b.binding.stageFlags));
+    combine(seed, static_cast<uint32_t>(b.flags));
+    for (const auto &s : b.immutableSamplers) {
+      combine(seed, static_cast<VkSampler>(s));
+    }
+  }
+
+  return seed;
+}
+
+size_t LayoutCache::Hash::operator()(const PipelineLayoutKey &k) const {
+  size_t seed = 0;
+  combine(seed, static_cast<uint32_t>(k.flags));
+  for (const auto &l : k.setLayouts) {
+    combine(seed, static_cast<VkDescriptorSetLayout>(l));
+  }
+  for (const auto &r : k.pushConstantRanges) {
+    combine(seed, static_cast<uint32_t>(r.stageFlags));
+    combine(seed, r.offset);
+    combine(seed, r.size);
+  }
+
+  return seed;
+}
+} // namespace orphee
@@ -0,0 +1,147 @@
+#include <algorithm>
+#include <array>
+
+#include <spdlog/spdlog.h>
+
+#include <orphee/memoryGovernor.hpp>
+#include <orphee/trace.hpp>
+
+namespace orphee {
+MemoryGovernor::MemoryGovernor(const Device &device, MemoryGovernorSettings s)
+    : settings{s}, device{&device} {
+  poll();
+}
+
+MemoryGovernor::Handle MemoryGovernor::track(VmaAllocation allocation,
+                                             float priority,
+                                             EvictCallback evict) {
+  VmaAllocationInfo info{};
+  vmaGetAllocationInfo(device->allocator, allocation, &info);
+
+  const auto h = next++;
+  resources.insert({h, Resource{allocation, heapOf(allocation), info.size,
+                                priority, frame, std::move(evict)}});
+
+  return h;
+}
+
+void MemoryGovernor::untrack(Handle h) { resources.erase(h); }
+
+void MemoryGovernor::touch(Handle h) { resources.at(h).lastUsed = frame; }
+
+void MemoryGovernor::update() {
+  ORPHEE_ZONE("MemoryGovernor::update");
+  ++frame;
+  // budgets reported by the driver are refreshed on frame index changes
+  vmaSetCurrentFrameIndex(device->allocator, static_cast<uint32_t>(frame));
+  poll();
+
+  for (uint32_t i = 0; i < budgets.size(); ++i) {
+    const auto limit = softLimit(i);
+    if (budgets[i].usage > limit) {
+      const auto freed = evict(i, budgets[i].usage - limit);
+      if (freed > 0) {
+        poll();
+      }
+    }
+  }
+}
+
+bool MemoryGovernor::reserve(uint32_t heap, vk::DeviceSize size) {
+  const auto limit = softLimit(heap);
+  const auto required = budgets.at(heap).usage + size;
+  if (required <= limit) {
+    return true;
+  }
+
+  const auto freed = evict(heap, required - limit);
+  poll();
+
+  return freed >= required - limit;
+}
+
+uint32_t MemoryGovernor::heapOf(VmaAllocation allocation) const {
+  VmaAllocationInfo info{};
+  vmaGetAllocationInfo(device->allocator, allocation, &info);
+
+  const VkPhysicalDeviceMemoryProperties *memoryProperties{};
+  vmaGetMemoryProperties(device->allocator, &memoryProperties);
+
+  return memoryProperties->memoryTypes[info.memoryType].heapIndex;
+}
+
+void MemoryGovernor::poll() {
+  const VkPhysicalDeviceMemoryProperties *memoryProperties{};
+  vmaGetMemoryProperties(device->allocator, &memoryProperties);
+
+  std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> vmaBudgets{};
+  vmaGetHeapBudgets(device->allocator, vmaBudgets.data());
+
+  budgets.resize(memoryProperties->memoryHeapCount);
+  for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; ++i) {
+    auto &b = budgets[i];
+    b.usage = vmaBudgets[i].usage;
+    b.budget = vmaBudgets[i].budget;
+    b.headroom = b.budget > b.usage ? b.budget - b.usage : 0;
+    b.flags = vk::MemoryHeapFlags{memoryProperties->memoryHeaps[i].flags};
+  }
+}
+
+vk::DeviceSize MemoryGovernor::evict(uint32_t heap, vk::DeviceSize bytes) {
+  struct Candidate {
+    Handle h;
+    float priority;
+    uint64_t lastUsed;
+  };
+
+  std::vector<Candidate> candidates;
+  for (const auto &[h, r] : resources) {
+    // resources used this frame might still be referenced by the GPU
+    if (r.heap == heap && r.lastUsed < frame) {
+      candidates.push_back({h, r.priority, r.lastUsed});
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end(),
+            [](const auto &a, const auto &b) {
+              if (a.priority != b.priority) {
+                return a.priority < b.priority;
+              }
+              return a.lastUsed < b.lastUsed;
+            });
+
+  vk::DeviceSize freed = 0;
+  for (const auto &c : candidates) {
+    if (freed >= bytes) {
+      break;
+    }
+
+    // an earlier callback may have untracked it
+    auto it = resources.find(c.h);
+    if (it == resources.end()) {
+      continue;
+    }
+
+    spdlog::info("Evicting {} bytes from heap {} (priority {}, last used "
+                 "{} frames ago)",
+                 it->second.size, heap, c.priority, frame - c.lastUsed);
+
+    freed += it->second.size;
+    const auto evictCallback = std::move(it->second.evict);
+    resources.erase(it);
+    evictCallback();
+  }
+
+  if (freed < bytes) {
+    spdlog::warn("Heap {} is over its soft limit by {} bytes", heap,
+                 bytes - freed);
+  }
+
+  return freed;
+}
+
+vk::DeviceSize MemoryGovernor::softLimit(uint32_t heap) const {
+  return static_cast<vk::DeviceSize>(
+      static_cast<double>(budgets.at(heap).budget) * settings.softLimit);
+}
+} // namespace orphee
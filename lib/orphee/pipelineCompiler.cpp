@@ -0,0 +1,331 @@
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include <orphee/pipelineCompiler.hpp>
+#include <orphee/trace.hpp>
+
+namespace orphee {
+namespace {
+// create infos point into the build, which therefore never moves
+struct ComputeBuild {
+  ComputeBuild(const vk::raii::Device &d, const ComputePipelineDesc &desc)
+      : module{d.createShaderModule({{}, desc.code})},
+        info{{},
+             {{},
+              vk::ShaderStageFlagBits::eCompute,
+              *module,
+              desc.entryPoint.c_str(),
+              {}},
+             desc.layout,
+             {},
+             {}} {}
+
+  ComputeBuild(const ComputeBuild &) = delete;
+
+  ComputeBuild &operator=(const ComputeBuild &) = delete;
+
+  vk::raii::ShaderModule module;
+  vk::ComputePipelineCreateInfo info;
+};
+
+struct GraphicsBuild {
+  GraphicsBuild(const vk::raii::Device &d, const GraphicsPipelineDesc &desc)
+      : vertex{d.createShaderModule({{}, desc.vertexCode})},
+        fragment{d.createShaderModule({{}, desc.fragmentCode})} {
+    stages = {
+        vk::PipelineShaderStageCreateInfo{
+            {}, vk::ShaderStageFlagBits::eVertex, *vertex, "main", {}},
+        vk::PipelineShaderStageCreateInfo{
+            {}, vk::ShaderStageFlagBits::eFragment, *fragment, "main", {}},
+    };
+    vertexInput = {{}, desc.vertexBindings, desc.vertexAttributes};
+    inputAssembly = {{}, desc.topology, vk::False};
+    rasterization = {{},
+                     vk::False,
+                     vk::False,
+                     vk::PolygonMode::eFill,
+                     desc.cullMode,
+                     desc.frontFace,
+                     vk::False,
+                     0.0F,
+                     0.0F,
+                     0.0F,
+                     1.0F};
+    depthStencil = {{}, vk::True, vk::True, vk::CompareOp::eLess};
+    blendAttachments.resize(
+        desc.colorFormats.size(),
+        vk::PipelineColorBlendAttachmentState{
+            vk::False, vk::BlendFactor::eOne, vk::BlendFactor::eZero,
+            vk::BlendOp::eAdd, vk::BlendFactor::eOne, vk::BlendFactor::eZero,
+            vk::BlendOp::eAdd,
+            vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+                vk::ColorComponentFlagBits::eB |
+                vk::ColorComponentFlagBits::eA});
+    colorBlend = {{}, vk::False, vk::LogicOp::eCopy, blendAttachments, {}};
+    dynamicState = {{}, dynamicStates};
+    rendering = {{}, desc.colorFormats, desc.depthFormat, {}};
+
+    info = vk::GraphicsPipelineCreateInfo{
+        {},
+        stages,
+        &vertexInput,
+        &inputAssembly,
+        {},
+        &viewport,
+        &rasterization,
+        &multisample,
+        desc.depthFormat != vk::Format::eUndefined ? &depthStencil : nullptr,
+        &colorBlend,
+        &dynamicState,
+        desc.layout,
+        {},
+        {},
+        {},
+        {},
+        &rendering};
+  }
+
+  GraphicsBuild(const GraphicsBuild &) = delete;
+
+  GraphicsBuild &operator=(const GraphicsBuild &) = delete;
+
+  vk::raii::ShaderModule vertex;
+  vk::raii::ShaderModule fragment;
+  std::array<vk::PipelineShaderStageCreateInfo, 2> stages;
+  vk::PipelineVertexInputStateCreateInfo vertexInput;
+  vk::PipelineInputAssemblyStateCreateInfo inputAssembly;
+  vk::PipelineViewportStateCreateInfo viewport{{}, 1, {}, 1, {}};
+  vk::PipelineRasterizationStateCreateInfo rasterization;
+  vk::PipelineMultisampleStateCreateInfo multisample{
+      {}, vk::SampleCountFlagBits::e1, vk::False, 1.0F, {}, {}, {}};
+  vk::PipelineDepthStencilStateCreateInfo depthStencil;
+  std::vector<vk::PipelineColorBlendAttachmentState> blendAttachments;
+  vk::PipelineColorBlendStateCreateInfo colorBlend;
+  std::array<vk::DynamicState, 2> dynamicStates{vk::DynamicState::eViewport,
+                                                vk::DynamicState::eScissor};
+  vk::PipelineDynamicStateCreateInfo dynamicState;
+  vk::PipelineRenderingCreateInfo rendering;
+  vk::GraphicsPipelineCreateInfo info;
+};
+} // namespace
+
+bool PipelineHandle::ready() const {
+  return state && state->ready.load(std::memory_order_acquire);
+}
+
+bool PipelineHandle::failed() const {
+  // the error is not modified once ready
+  return ready() && state->error != nullptr;
+}
+
+vk::Pipeline PipelineHandle::get() const {
+  if (!state) {
+    return {};
+  }
+  // the pipeline is not modified once ready
+  if (state->ready.load(std::memory_order_acquire) && !state->error) {
+    return *state->pipeline;
+  }
+
+  return state->placeholder;
+}
+
+vk::Pipeline PipelineHandle::wait() const {
+  if (!state) {
+    throw std::runtime_error("Waiting on an empty pipeline handle");
+  }
+
+  std::unique_lock lock{state->mutex};
+  state->done.wait(lock, [this] { return state->ready.load(); });
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+
+  return *state->pipeline;
+}
+
+PipelineCompiler::PipelineCompiler(const Device &device,
+                                   PipelineCompilerSettings s)
+    : settings{std::move(s)}, device{&device} {
+  std::vector<char> data;
+  if (!settings.cacheFile.empty() &&
+      std::filesystem::exists(settings.cacheFile)) {
+    std::ifstream file{settings.cacheFile, std::ios::binary};
+    data.assign(std::istreambuf_iterator<char>{file}, {});
+  }
+  // drivers ignore data from other devices or driver versions
+  cache = device.h.createPipelineCache({{}, data.size(), data.data()});
+
+  if (settings.threads == 0) {
+    settings.threads = std::max(1U, std::thread::hardware_concurrency());
+  }
+  settings.batchSize = std::max(1U, settings.batchSize);
+
+  spdlog::info("Pipeline compiler: {} threads, {} bytes of cache data",
+               settings.threads, data.size());
+
+  workers.reserve(settings.threads);
+  for (uint32_t i = 0; i < settings.threads; ++i) {
+    workers.emplace_back([this] { work(); });
+  }
+}
+
+PipelineCompiler::~PipelineCompiler() {
+  std::deque<Job> abandoned;
+  {
+    std::lock_guard lock{mutex};
+    stop = true;
+    abandoned.swap(jobs);
+  }
+  wake.notify_all();
+
+  for (auto &w : workers) {
+    w.join();
+  }
+
+  for (auto &j : abandoned) {
+    finish(*j.state, nullptr,
+           std::make_exception_ptr(
+               std::runtime_error("Pipeline compilation abandoned")));
+  }
+
+  if (settings.cacheFile.empty()) {
+    return;
+  }
+
+  try {
+    const auto data = cache.getData();
+    const auto tmp = settings.cacheFile.string() + ".tmp";
+    {
+      std::ofstream file{tmp, std::ios::binary};
+      file.write(reinterpret_cast<const char *>(data.data()),
+                 static_cast<std::streamsize>(data.size()));
+    }
+    std::filesystem::rename(tmp, settings.cacheFile);
+  } catch (const std::exception &e) {
+    spdlog::warn("Failed to save the pipeline cache: {}", e.what());
+  }
+}
+
+PipelineHandle PipelineCompiler::compile(ComputePipelineDesc desc,
+                                         vk::Pipeline placeholder) {
+  return enqueue(std::move(desc), placeholder);
+}
+
+PipelineHandle PipelineCompiler::compile(GraphicsPipelineDesc desc,
+                                         vk::Pipeline placeholder) {
+  return enqueue(std::move(desc), placeholder);
+}
+
+void PipelineCompiler::wait() {
+  std::unique_lock lock{mutex};
+  idle.wait(lock, [this] { return jobs.empty() && busy == 0; });
+}
+
+PipelineHandle PipelineCompiler::enqueue(Desc desc, vk::Pipeline placeholder) {
+  auto state = std::make_shared<PipelineHandle::State>();
+  state->placeholder = placeholder;
+  {
+    std::lock_guard lock{mutex};
+    jobs.push_back({std::move(desc), state});
+  }
+  wake.notify_one();
+
+  return PipelineHandle{std::move(state)};
+}
+
+void PipelineCompiler::work() {
+  ORPHEE_TRACE_THREAD("pipeline compiler");
+  while (true) {
+    std::vector<Job> batch;
+    {
+      std::unique_lock lock{mutex};
+      wake.wait(lock, [this] { return stop || !jobs.empty(); });
+      if (stop) {
+        return;
+      }
+      // spread the queue over the workers before filling batches
+      const auto size = std::min<size_t>(
+          settings.batchSize,
+          (jobs.size() + settings.threads - 1) / settings.threads);
+      const auto kind = jobs.front().desc.index();
+      while (!jobs.empty() && batch.size() < size &&
+             jobs.front().desc.index() == kind) {
+        batch.push_back(std::move(jobs.front()));
+        jobs.pop_front();
+      }
+      ++busy;
+    }
+    // more work might be left for the other workers
+    wake.notify_one();
+
+    build(batch);
+
+    {
+      std::lock_guard lock{mutex};
+      --busy;
+    }
+    idle.notify_all();
+  }
+}
+
+void PipelineCompiler::build(std::vector<Job> &batch) {
+  ORPHEE_ZONE("PipelineCompiler::build");
+  std::vector<vk::raii::Pipeline> pipelines;
+  try {
+    if (std::holds_alternative<ComputePipelineDesc>(batch.front().desc)) {
+      std::vector<std::unique_ptr<ComputeBuild>> builds;
+      std::vector<vk::ComputePipelineCreateInfo> infos;
+      for (const auto &j : batch) {
+        builds.push_back(std::make_unique<ComputeBuild>(
+            device->h, std::get<ComputePipelineDesc>(j.desc)));
+        infos.push_back(builds.back()->info);
+      }
+      pipelines = device->h.createComputePipelines(cache, infos);
+    } else {
+      std::vector<std::unique_ptr<GraphicsBuild>> builds;
+      std::vector<vk::GraphicsPipelineCreateInfo> infos;
+      for (const auto &j : batch) {
+        builds.push_back(std::make_unique<GraphicsBuild>(
+            device->h, std::get<GraphicsPipelineDesc>(j.desc)));
+        infos.push_back(builds.back()->info);
+      }
+      pipelines = device->h.createGraphicsPipelines(cache, infos);
+    }
+  } catch (const std::exception &e) {
+    if (batch.size() == 1) {
+      spdlog::error("Failed to compile pipeline: {}", e.what());
+      finish(*batch.front().state, nullptr, std::current_exception());
+      return;
+    }
+    // one create call fails as a whole, retry alone to isolate the culprit
+    for (auto &j : batch) {
+      std::vector<Job> single;
+      single.push_back(std::move(j));
+      build(single);
+    }
+    return;
+  }
+
+  for (size_t i = 0; i < batch.size(); ++i) {
+    finish(*batch[i].state, std::move(pipelines[i]));
+  }
+}
+
+void PipelineCompiler::finish(PipelineHandle::State &state,
+                              vk::raii::Pipeline pipeline,
+                              std::exception_ptr error) {
+  {
+    std::lock_guard lock{state.mutex};
+    state.pipeline = std::move(pipeline);
+    state.error = std::move(error);
+    state.ready.store(true, std::memory_order_release);
+  }
+  state.done.notify_all();
+}
+} // namespace orphee
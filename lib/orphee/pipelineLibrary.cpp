@@ -0,0 +1,271 @@
+#include <chrono>
+#include <stdexcept>
+
+#include <spdlog/spdlog.h>
+
+#include <orphee/pipelineLibrary.hpp>
+#include <orphee/trace.hpp>
+
+namespace orphee {
+namespace {
+// FNV-1a over the state a part is built from
+struct Hash {
+  Hash &bytes(const void *data, size_t size) {
+    const auto *b = static_cast<const uint8_t *>(data);
+    for (size_t i = 0; i < size; ++i) {
+      value = (value ^ b[i]) * 1099511628211ULL;
+    }
+    return *this;
+  }
+
+  template <typename T> Hash &add(const T &v) { return bytes(&v, sizeof(v)); }
+
+  template <typename T> Hash &add(const std::vector<T> &v) {
+    add(v.size());
+    return bytes(v.data(), v.size() * sizeof(T));
+  }
+
+  uint64_t value = 14695981039346656037ULL;
+};
+
+enum Part : uint32_t {
+  eVertexInput,
+  ePreRasterization,
+  eFragmentShader,
+  eFragmentOutput,
+};
+
+std::array<uint64_t, 4> keys(const GraphicsPipelineDesc &desc) {
+  return {
+      Hash{}
+          .add(eVertexInput)
+          .add(desc.vertexBindings)
+          .add(desc.vertexAttributes)
+          .add(desc.topology)
+          .value,
+      Hash{}
+          .add(ePreRasterization)
+          .add(desc.vertexCode)
+          .add(desc.layout)
+          .add(desc.cullMode)
+          .add(desc.frontFace)
+          .value,
+      Hash{}
+          .add(eFragmentShader)
+          .add(desc.fragmentCode)
+          .add(desc.layout)
+          .add(desc.depthFormat != vk::Format::eUndefined)
+          .value,
+      Hash{}
+          .add(eFragmentOutput)
+          .add(desc.colorFormats)
+          .add(desc.depthFormat)
+          .value,
+  };
+}
+
+vk::raii::Pipeline createPart(const vk::raii::Device &d,
+                              const vk::raii::PipelineCache &cache,
+                              vk::GraphicsPipelineLibraryFlagsEXT kind,
+                              vk::GraphicsPipelineCreateInfo info) {
+  // the optimized link needs what the parts were compiled from
+  vk::GraphicsPipelineLibraryCreateInfoEXT libraryInfo{kind, info.pNext};
+  info.flags |= vk::PipelineCreateFlagBits::eLibraryKHR |
+                vk::PipelineCreateFlagBits::eRetainLinkTimeOptimizationInfoEXT;
+  info.pNext = &libraryInfo;
+
+  return d.createGraphicsPipeline(cache, info);
+}
+
+vk::raii::Pipeline vertexInput(const vk::raii::Device &d,
+                               const vk::raii::PipelineCache &cache,
+                               const GraphicsPipelineDesc &desc) {
+  const vk::PipelineVertexInputStateCreateInfo vertexInputState{
+      {}, desc.vertexBindings, desc.vertexAttributes};
+  const vk::PipelineInputAssemblyStateCreateInfo inputAssembly{
+      {}, desc.topology, vk::False};
+
+  vk::GraphicsPipelineCreateInfo info{};
+  info.pVertexInputState = &vertexInputState;
+  info.pInputAssemblyState = &inputAssembly;
+
+  return createPart(
+      d, cache,
+      vk::GraphicsPipelineLibraryFlagBitsEXT::eVertexInputInterface, info);
+}
+
+vk::raii::Pipeline preRasterization(const vk::raii::Device &d,
+                                    const vk::raii::PipelineCache &cache,
+                                    const GraphicsPipelineDesc &desc) {
+  const auto module = d.createShaderModule({{}, desc.vertexCode});
+  const vk::PipelineShaderStageCreateInfo stage{
+      {}, vk::ShaderStageFlagBits::eVertex, *module, "main", {}};
+  const vk::PipelineViewportStateCreateInfo viewport{{}, 1, {}, 1, {}};
+  const vk::PipelineRasterizationStateCreateInfo rasterization{
+      {},
+      vk::False,
+      vk::False,
+      vk::PolygonMode::eFill,
+      desc.cullMode,
+      desc.frontFace,
+      vk::False,
+      0.0F,
+      0.0F,
+      0.0F,
+      1.0F};
+  const std::array<vk::DynamicState, 2> dynamicStates{
+      vk::DynamicState::eViewport, vk::DynamicState::eScissor};
+  const vk::PipelineDynamicStateCreateInfo dynamicState{{}, dynamicStates};
+
+  vk::GraphicsPipelineCreateInfo info{};
+  info.setStages(stage);
+  info.pViewportState = &viewport;
+  info.pRasterizationState = &rasterization;
+  info.pDynamicState = &dynamicState;
+  info.layout = desc.layout;
+
+  return createPart(
+      d, cache,
+      vk::GraphicsPipelineLibraryFlagBitsEXT::ePreRasterizationShaders, info);
+}
+
+const vk::PipelineMultisampleStateCreateInfo multisample{
+    {}, vk::SampleCountFlagBits::e1, vk::False, 1.0F, {}, {}, {}};
+
+vk::raii::Pipeline fragmentShader(const vk::raii::Device &d,
+                                  const vk::raii::PipelineCache &cache,
+                                  const GraphicsPipelineDesc &desc) {
+  const auto module = d.createShaderModule({{}, desc.fragmentCode});
+  const vk::PipelineShaderStageCreateInfo stage{
+      {}, vk::ShaderStageFlagBits::eFragment, *module, "main", {}};
+  const auto depth = desc.depthFormat != vk::Format::eUndefined;
+  const vk::PipelineDepthStencilStateCreateInfo depthStencil{
+      {}, depth, depth, vk::CompareOp::eLess};
+
+  vk::GraphicsPipelineCreateInfo info{};
+  info.setStages(stage);
+  info.pMultisampleState = &multisample;
+  info.pDepthStencilState = &depthStencil;
+  info.layout = desc.layout;
+
+  return createPart(d, cache,
+                    vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentShader,
+                    info);
+}
+
+vk::raii::Pipeline fragmentOutput(const vk::raii::Device &d,
+                                  const vk::raii::PipelineCache &cache,
+                                  const GraphicsPipelineDesc &desc) {
+  const std::vector<vk::PipelineColorBlendAttachmentState> blendAttachments(
+      desc.colorFormats.size(),
+      vk::PipelineColorBlendAttachmentState{
+          vk::False, vk::BlendFactor::eOne, vk::BlendFactor::eZero,
+          vk::BlendOp::eAdd, vk::BlendFactor::eOne, vk::BlendFactor::eZero,
+          vk::BlendOp::eAdd,
+          vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+              vk::ColorComponentFlagBits::eB |
+              vk::ColorComponentFlagBits::eA});
+  const vk::PipelineColorBlendStateCreateInfo colorBlend{
+      {}, vk::False, vk::LogicOp::eCopy, blendAttachments, {}};
+  const vk::PipelineRenderingCreateInfo rendering{
+      {}, desc.colorFormats, desc.depthFormat, {}};
+
+  vk::GraphicsPipelineCreateInfo info{};
+  info.pNext = &rendering;
+  info.pMultisampleState = &multisample;
+  info.pColorBlendState = &colorBlend;
+
+  return createPart(
+      d, cache,
+      vk::GraphicsPipelineLibraryFlagBitsEXT::eFragmentOutputInterface, info);
+}
+} // namespace
+
+GraphicsPipelineLibrary::GraphicsPipelineLibrary(const Device &device)
+    : device{&device}, cache{device.h.createPipelineCache({})} {
+  if (!device.capabilities.pipelineLibraries) {
+    throw std::runtime_error("Graphics pipeline libraries are not enabled");
+  }
+}
+
+GraphicsPipelineLibrary::Handle
+GraphicsPipelineLibrary::prepare(const GraphicsPipelineDesc &desc) {
+  ORPHEE_ZONE("GraphicsPipelineLibrary::prepare");
+  const auto partKeys = keys(desc);
+  const auto key = Hash{}.add(partKeys).value;
+
+  if (!pipelines.contains(key)) {
+    const auto &d = device->h;
+    const Parts parts{
+        part(partKeys[eVertexInput],
+             [&] { return vertexInput(d, cache, desc); }),
+        part(partKeys[ePreRasterization],
+             [&] { return preRasterization(d, cache, desc); }),
+        part(partKeys[eFragmentShader],
+             [&] { return fragmentShader(d, cache, desc); }),
+        part(partKeys[eFragmentOutput],
+             [&] { return fragmentOutput(d, cache, desc); }),
+    };
+
+    Linked linked;
+    linked.fast = link(parts, desc.layout, false);
+    linked.optimizing =
+        std::async(std::launch::async, [this, parts, layout = desc.layout] {
+          return link(parts, layout, true);
+        });
+    pipelines.emplace(key, std::move(linked));
+
+    spdlog::debug("Pipeline library: linked {:016x}, {} parts", key,
+                  libraries.size());
+  }
+
+  return key;
+}
+
+vk::Pipeline GraphicsPipelineLibrary::get(Handle handle) {
+  const auto it = pipelines.find(handle);
+  if (it == pipelines.end()) {
+    throw std::runtime_error("Unknown pipeline library handle");
+  }
+
+  auto &linked = it->second;
+  if (linked.optimizing.valid() &&
+      linked.optimizing.wait_for(std::chrono::seconds{0}) ==
+          std::future_status::ready) {
+    try {
+      linked.optimized = linked.optimizing.get();
+    } catch (const std::exception &e) {
+      spdlog::warn("Pipeline library: optimized link failed, keeping the "
+                   "fast-linked pipeline: {}",
+                   e.what());
+    }
+  }
+
+  return *linked.optimized ? *linked.optimized : *linked.fast;
+}
+
+vk::Pipeline GraphicsPipelineLibrary::part(
+    uint64_t key, const std::function<vk::raii::Pipeline()> &build) {
+  auto it = libraries.find(key);
+  if (it == libraries.end()) {
+    it = libraries.emplace(key, build()).first;
+  }
+
+  return *it->second;
+}
+
+vk::raii::Pipeline GraphicsPipelineLibrary::link(const Parts &parts,
+                                                 vk::PipelineLayout layout,
+                                                 bool optimize) const {
+  const vk::PipelineLibraryCreateInfoKHR libraryInfo{parts};
+
+  vk::GraphicsPipelineCreateInfo info{};
+  info.pNext = &libraryInfo;
+  info.layout = layout;
+  if (optimize) {
+    info.flags = vk::PipelineCreateFlagBits::eLinkTimeOptimizationEXT;
+  }
+
+  return device->h.createGraphicsPipeline(cache, info);
+}
+} // namespace orphee
@@ -0,0 +1,238 @@
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+#include <spdlog/spdlog.h>
+
+#include <orphee/probe.hpp>
+#include <orphee/trace.hpp>
+
+namespace orphee {
+namespace {
+constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+// variables changing what the loader finds
+constexpr std::array<const char *, 8> LOADER_VARIABLES{
+    "VK_ICD_FILENAMES",
+    "VK_DRIVER_FILES",
+    "VK_ADD_DRIVER_FILES",
+    "VK_LAYER_PATH",
+    "VK_ADD_LAYER_PATH",
+    "VK_INSTANCE_LAYERS",
+    "VK_LOADER_LAYERS_ENABLE",
+    "VK_LOADER_LAYERS_DISABLE",
+};
+
+uint64_t fnv1a(uint64_t h, std::string_view data) {
+  for (const auto c : data) {
+    h ^= static_cast<uint8_t>(c);
+    h *= FNV_PRIME;
+  }
+  // separates consecutive fields
+  h ^= 0xFFU;
+  h *= FNV_PRIME;
+
+  return h;
+}
+
+const char *name(const vk::LayerProperties &p) { return p.layerName.data(); }
+
+const char *name(const vk::ExtensionProperties &p) {
+  return p.extensionName.data();
+}
+
+template <typename T> void sortByName(std::vector<T> &v) {
+  std::sort(v.begin(), v.end(), [](const T &a, const T &b) {
+    return std::strcmp(name(a), name(b)) < 0;
+  });
+}
+
+template <typename T>
+bool containsName(const std::vector<T> &v, const char *n) {
+  const auto it =
+      std::lower_bound(v.begin(), v.end(), n, [](const T &a, const char *b) {
+        return std::strcmp(name(a), b) < 0;
+      });
+  return it != v.end() && std::strcmp(name(*it), n) == 0;
+}
+
+template <size_t N>
+void copyName(vk::ArrayWrapper1D<char, N> &target, const std::string &n) {
+  const auto size = std::min(n.size(), N - 1);
+  std::copy_n(n.begin(), size, target.begin());
+  target[size] = '\0';
+}
+
+std::string deviceKey(const vk::raii::PhysicalDevice &device) {
+  const auto properties =
+      device.getProperties2<vk::PhysicalDeviceProperties2,
+                            vk::PhysicalDeviceIDProperties>();
+  const auto &p = properties.get<vk::PhysicalDeviceProperties2>().properties;
+
+  std::string key;
+  for (const auto b :
+       properties.get<vk::PhysicalDeviceIDProperties>().deviceUUID) {
+    key += fmt::format("{:02x}", b);
+  }
+
+  return fmt::format("{}-{:x}-{:x}", key, p.driverVersion, p.apiVersion);
+}
+} // namespace
+
+bool InstanceProbe::hasLayer(const char *n) const {
+  return containsName(layers, n);
+}
+
+bool InstanceProbe::hasExtension(const char *n) const {
+  return containsName(extensions, n);
+}
+
+bool DeviceProbe::hasExtension(const char *n) const {
+  return containsName(extensions, n);
+}
+
+ProbeCache::ProbeCache(std::filesystem::path f) : file{std::move(f)} {
+  load();
+}
+
+const InstanceProbe &ProbeCache::instance(const vk::raii::Context &context) {
+  auto h = FNV_OFFSET;
+  for (const auto *v : LOADER_VARIABLES) {
+    const auto *value = std::getenv(v);
+    h = fnv1a(h, value != nullptr ? value : "");
+  }
+  const auto key =
+      fmt::format("{:x}-{:016x}", context.enumerateInstanceVersion(), h);
+
+  if (instanceProbe && instanceKey == key) {
+    return *instanceProbe;
+  }
+
+  ORPHEE_ZONE("ProbeCache::instance");
+  InstanceProbe probe;
+  probe.layers = context.enumerateInstanceLayerProperties();
+  probe.extensions = context.enumerateInstanceExtensionProperties();
+  sortByName(probe.layers);
+  sortByName(probe.extensions);
+  spdlog::debug("Probed {} instance layers and {} instance extensions",
+                probe.layers.size(), probe.extensions.size());
+
+  instanceKey = key;
+  instanceProbe = std::move(probe);
+  dirty = true;
+
+  return *instanceProbe;
+}
+
+const DeviceProbe &
+ProbeCache::device(const vk::raii::PhysicalDevice &physical) {
+  const auto key = deviceKey(physical);
+  probed.insert(key);
+  if (const auto it = devices.find(key); it != devices.end()) {
+    return it->second;
+  }
+
+  ORPHEE_ZONE("ProbeCache::device");
+  DeviceProbe probe;
+  probe.extensions = physical.enumerateDeviceExtensionProperties();
+  probe.families = physical.getQueueFamilyProperties();
+  sortByName(probe.extensions);
+  spdlog::debug("Probed {} device extensions and {} queue families",
+                probe.extensions.size(), probe.families.size());
+
+  dirty = true;
+
+  return devices.insert({key, std::move(probe)}).first->second;
+}
+
+void ProbeCache::save() {
+  if (file.empty() || !dirty) {
+    return;
+  }
+
+  std::ofstream out{file, std::ios::trunc};
+  // one header line per probe followed by its entries
+  if (instanceProbe) {
+    out << "instance " << instanceKey << "\n";
+    for (const auto &l : instanceProbe->layers) {
+      out << "layer " << name(l) << " " << l.specVersion << " "
+          << l.implementationVersion << "\n";
+    }
+    for (const auto &x : instanceProbe->extensions) {
+      out << "extension " << name(x) << " " << x.specVersion << "\n";
+    }
+  }
+  for (const auto &key : probed) {
+    const auto &probe = devices.at(key);
+    out << "device " << key << "\n";
+    for (const auto &x : probe.extensions) {
+      out << "extension " << name(x) << " " << x.specVersion << "\n";
+    }
+    for (const auto &f : probe.families) {
+      out << "family " << static_cast<uint32_t>(f.queueFlags) << " "
+          << f.queueCount << " " << f.timestampValidBits << "\n";
+    }
+  }
+
+  if (!out) {
+    spdlog::warn("Failed to save the probe cache to {}", file.string());
+    return;
+  }
+  dirty = false;
+}
+
+void ProbeCache::load() {
+  if (file.empty()) {
+    return;
+  }
+
+  std::ifstream in{file};
+  InstanceProbe *instanceTarget = nullptr;
+  DeviceProbe *deviceTarget = nullptr;
+  std::string kind;
+  std::string n;
+  for (std::string line; std::getline(in, line);) {
+    std::istringstream fields{line};
+    kind.clear();
+    fields >> kind;
+
+    if (kind == "instance") {
+      fields >> instanceKey;
+      instanceTarget = &instanceProbe.emplace();
+      deviceTarget = nullptr;
+    } else if (kind == "device") {
+      fields >> n;
+      deviceTarget = &devices[n];
+      instanceTarget = nullptr;
+    } else if (kind == "layer" && instanceTarget != nullptr) {
+      vk::LayerProperties l{};
+      fields >> n >> l.specVersion >> l.implementationVersion;
+      copyName(l.layerName, n);
+      instanceTarget->layers.push_back(l);
+    } else if (kind == "extension") {
+      vk::ExtensionProperties x{};
+      fields >> n >> x.specVersion;
+      copyName(x.extensionName, n);
+      if (instanceTarget != nullptr) {
+        instanceTarget->extensions.push_back(x);
+      } else if (deviceTarget != nullptr) {
+        deviceTarget->extensions.push_back(x);
+      }
+    } else if (kind == "family" && deviceTarget != nullptr) {
+      uint32_t flags{};
+      vk::QueueFamilyProperties f{};
+      fields >> flags >> f.queueCount >> f.timestampValidBits;
+      f.queueFlags = vk::QueueFlags{flags};
+      deviceTarget->families.push_back(f);
+    }
+  }
+
+  spdlog::debug("Probe cache {} holds {} devices", file.string(),
+                devices.size());
+}
+} // namespace orphee
@@ -0,0 +1,503 @@
+#include <algorithm>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <spdlog/spdlog.h>
+
+#include <orphee/reflection.hpp>
+
+namespace orphee {
+namespace {
+// SPIR-V 1.6 specification values, only those the reflection needs
+namespace spv {
+constexpr uint32_t MAGIC = 0x07230203;
+
+constexpr uint32_t OP_NAME = 5;
+constexpr uint32_t OP_MEMBER_NAME = 6;
+constexpr uint32_t OP_ENTRY_POINT = 15;
+constexpr uint32_t OP_EXECUTION_MODE = 16;
+constexpr uint32_t OP_TYPE_BOOL = 20;
+constexpr uint32_t OP_TYPE_INT = 21;
+constexpr uint32_t OP_TYPE_FLOAT = 22;
+constexpr uint32_t OP_TYPE_VECTOR = 23;
+constexpr uint32_t OP_TYPE_MATRIX = 24;
+constexpr uint32_t OP_TYPE_IMAGE = 25;
+constexpr uint32_t OP_TYPE_SAMPLER = 26;
+constexpr uint32_t OP_TYPE_SAMPLED_IMAGE = 27;
+constexpr uint32_t OP_TYPE_ARRAY = 28;
+constexpr uint32_t OP_TYPE_RUNTIME_ARRAY = 29;
+constexpr uint32_t OP_TYPE_STRUCT = 30;
+constexpr uint32_t OP_TYPE_POINTER = 32;
+constexpr uint32_t OP_CONSTANT_TRUE = 41;
+constexpr uint32_t OP_CONSTANT_FALSE = 42;
+constexpr uint32_t OP_CONSTANT = 43;
+constexpr uint32_t OP_SPEC_CONSTANT_TRUE = 48;
+constexpr uint32_t OP_SPEC_CONSTANT_FALSE = 49;
+constexpr uint32_t OP_SPEC_CONSTANT = 50;
+constexpr uint32_t OP_VARIABLE = 59;
+constexpr uint32_t OP_DECORATE = 71;
+constexpr uint32_t OP_MEMBER_DECORATE = 72;
+constexpr uint32_t OP_EXECUTION_MODE_ID = 331;
+constexpr uint32_t OP_TYPE_ACCELERATION_STRUCTURE = 5341;
+
+constexpr uint32_t DECORATION_SPEC_ID = 1;
+constexpr uint32_t DECORATION_BUFFER_BLOCK = 3;
+constexpr uint32_t DECORATION_ARRAY_STRIDE = 6;
+constexpr uint32_t DECORATION_MATRIX_STRIDE = 7;
+constexpr uint32_t DECORATION_BINDING = 33;
+constexpr uint32_t DECORATION_DESCRIPTOR_SET = 34;
+constexpr uint32_t DECORATION_OFFSET = 35;
+
+constexpr uint32_t EXECUTION_MODE_LOCAL_SIZE = 17;
+constexpr uint32_t EXECUTION_MODE_LOCAL_SIZE_ID = 38;
+
+constexpr uint32_t STORAGE_UNIFORM_CONSTANT = 0;
+constexpr uint32_t STORAGE_UNIFORM = 2;
+constexpr uint32_t STORAGE_PUSH_CONSTANT = 9;
+constexpr uint32_t STORAGE_STORAGE_BUFFER = 12;
+
+constexpr uint32_t DIM_BUFFER = 5;
+constexpr uint32_t DIM_SUBPASS_DATA = 6;
+} // namespace spv
+
+struct Instruction {
+  uint32_t opcode;
+  std::span<const uint32_t> operands;
+};
+
+struct Id {
+  uint32_t opcode{};
+  std::vector<uint32_t> operands;
+  std::string name;
+  std::vector<std::string> memberNames;
+  std::unordered_map<uint32_t, uint32_t> decorations;
+  std::unordered_map<uint32_t, std::unordered_map<uint32_t, uint32_t>>
+      memberDecorations;
+};
+
+std::string literalString(std::span<const uint32_t> words) {
+  std::string s;
+  for (const auto w : words) {
+    for (uint32_t b = 0; b < 4; ++b) {
+      const auto c = static_cast<char>((w >> (8U * b)) & 0xFFU);
+      if (c == '\0') {
+        return s;
+      }
+      s.push_back(c);
+    }
+  }
+
+  return s;
+}
+
+vk::ShaderStageFlagBits stageOf(uint32_t executionModel) {
+  switch (executionModel) {
+  case 0:
+    return vk::ShaderStageFlagBits::eVertex;
+  case 1:
+    return vk::ShaderStageFlagBits::eTessellationControl;
+  case 2:
+    return vk::ShaderStageFlagBits::eTessellationEvaluation;
+  case 3:
+    return vk::ShaderStageFlagBits::eGeometry;
+  case 4:
+    return vk::ShaderStageFlagBits::eFragment;
+  case 5:
+    return vk::ShaderStageFlagBits::eCompute;
+  default:
+    throw std::runtime_error("Unsupported SPIR-V execution model");
+  }
+}
+
+class Module {
+public:
+  explicit Module(std::span<const uint32_t> code) {
+    if (code.size() < 5 || code[0] != spv::MAGIC) {
+      throw std::runtime_error("Invalid SPIR-V module");
+    }
+
+    ids.resize(code[3]);
+    for (size_t i = 5; i < code.size();) {
+      const auto count = code[i] >> 16U;
+      if (count == 0 || i + count > code.size()) {
+        throw std::runtime_error("Truncated SPIR-V module");
+      }
+      instructions.push_back(
+          {code[i] & 0xFFFFU, code.subspan(i + 1, count - 1)});
+      i += count;
+    }
+  }
+
+  Id &id(uint32_t i) {
+    if (i >= ids.size()) {
+      throw std::runtime_error("SPIR-V id out of bounds");
+    }
+    return ids[i];
+  }
+
+  // value of an integer constant or the default of a spec constant
+  uint32_t constant(uint32_t i) {
+    const auto &c = id(i);
+    if (c.opcode != spv::OP_CONSTANT && c.opcode != spv::OP_SPEC_CONSTANT) {
+      throw std::runtime_error("SPIR-V id is not an integer constant");
+    }
+    return c.operands.at(2);
+  }
+
+  uint32_t sizeOf(uint32_t type) {
+    const auto &t = id(type);
+    switch (t.opcode) {
+    case spv::OP_TYPE_BOOL:
+      return 4;
+    case spv::OP_TYPE_INT:
+    case spv::OP_TYPE_FLOAT:
+      return t.operands.at(1) / 8;
+    case spv::OP_TYPE_VECTOR:
+      return sizeOf(t.operands.at(1)) * t.operands.at(2);
+    case spv::OP_TYPE_MATRIX:
+      return sizeOf(t.operands.at(1)) * t.operands.at(2);
+    case spv::OP_TYPE_ARRAY: {
+      const auto stride = t.decorations.find(spv::DECORATION_ARRAY_STRIDE);
+      const auto element = stride != t.decorations.end()
+                               ? stride->second
+                               : sizeOf(t.operands.at(1));
+      return element * constant(t.operands.at(2));
+    }
+    case spv::OP_TYPE_RUNTIME_ARRAY:
+      return 0;
+    case spv::OP_TYPE_POINTER:
+      // physical storage buffer pointers
+      return 8;
+    case spv::OP_TYPE_STRUCT: {
+      uint32_t size = 0;
+      for (uint32_t m = 0; m + 1 < t.operands.size(); ++m) {
+        size = std::max(size, memberOffset(type, m) +
+                                  memberSize(type, m, t.operands[m + 1]));
+      }
+      return size;
+    }
+    default:
+      throw std::runtime_error("Unsupported SPIR-V type in block");
+    }
+  }
+
+  uint32_t memberOffset(uint32_t structType, uint32_t member) {
+    const auto &d = id(structType).memberDecorations;
+    const auto m = d.find(member);
+    if (m == d.end() || !m->second.contains(spv::DECORATION_OFFSET)) {
+      throw std::runtime_error("SPIR-V block member without offset");
+    }
+    return m->second.at(spv::DECORATION_OFFSET);
+  }
+
+  uint32_t memberSize(uint32_t structType, uint32_t member, uint32_t type) {
+    const auto &t = id(type);
+    const auto &d = id(structType).memberDecorations;
+    const auto m = d.find(member);
+    if (t.opcode == spv::OP_TYPE_MATRIX && m != d.end() &&
+        m->second.contains(spv::DECORATION_MATRIX_STRIDE)) {
+      return m->second.at(spv::DECORATION_MATRIX_STRIDE) * t.operands.at(2);
+    }
+    return sizeOf(type);
+  }
+
+  std::string typeName(uint32_t type) {
+    const auto &t = id(type);
+    switch (t.opcode) {
+    case spv::OP_TYPE_BOOL:
+      return "bool";
+    case spv::OP_TYPE_INT:
+      return (t.operands.at(2) != 0 ? "int" : "uint") +
+             std::to_string(t.operands.at(1));
+    case spv::OP_TYPE_FLOAT:
+      return "float" + std::to_string(t.operands.at(1));
+    case spv::OP_TYPE_VECTOR:
+      return "vec" + std::to_string(t.operands.at(2)) + "<" +
+             typeName(t.operands.at(1)) + ">";
+    case spv::OP_TYPE_MATRIX:
+      return "mat" + std::to_string(t.operands.at(2)) + "<" +
+             typeName(t.operands.at(1)) + ">";
+    case spv::OP_TYPE_ARRAY:
+      return typeName(t.operands.at(1)) + "[" +
+             std::to_string(constant(t.operands.at(2))) + "]";
+    case spv::OP_TYPE_RUNTIME_ARRAY:
+      return typeName(t.operands.at(1)) + "[]";
+    case spv::OP_TYPE_POINTER:
+      return "ptr";
+    case spv::OP_TYPE_STRUCT:
+      return "struct " + t.name;
+    default:
+      return "unknown";
+    }
+  }
+
+  std::vector<Instruction> instructions;
+
+private:
+  std::vector<Id> ids;
+};
+
+vk::DescriptorType descriptorType(Module &m, uint32_t storageClass,
+                                  uint32_t type) {
+  const auto &t = m.id(type);
+  switch (storageClass) {
+  case spv::STORAGE_UNIFORM:
+    return t.decorations.contains(spv::DECORATION_BUFFER_BLOCK)
+               ? vk::DescriptorType::eStorageBuffer
+               : vk::DescriptorType::eUniformBuffer;
+  case spv::STORAGE_STORAGE_BUFFER:
+    return vk::DescriptorType::eStorageBuffer;
+  case spv::STORAGE_UNIFORM_CONSTANT:
+    break;
+  default:
+    throw std::runtime_error("Unsupported SPIR-V resource storage class");
+  }
+
+  switch (t.opcode) {
+  case spv::OP_TYPE_SAMPLER:
+    return vk::DescriptorType::eSampler;
+  case spv::OP_TYPE_SAMPLED_IMAGE:
+    return vk::DescriptorType::eCombinedImageSampler;
+  case spv::OP_TYPE_ACCELERATION_STRUCTURE:
+    return vk::DescriptorType::eAccelerationStructureKHR;
+  case spv::OP_TYPE_IMAGE: {
+    const auto dim = t.operands.at(2);
+    const auto storage = t.operands.at(6) == 2;
+    if (dim == spv::DIM_BUFFER) {
+      return storage ? vk::DescriptorType::eStorageTexelBuffer
+                     : vk::DescriptorType::eUniformTexelBuffer;
+    }
+    if (dim == spv::DIM_SUBPASS_DATA) {
+      return vk::DescriptorType::eInputAttachment;
+    }
+    return storage ? vk::DescriptorType::eStorageImage
+                   : vk::DescriptorType::eSampledImage;
+  }
+  default:
+    throw std::runtime_error("Unsupported SPIR-V resource type");
+  }
+}
+} // namespace
+
+ShaderReflection reflect(std::span<const uint32_t> code) {
+  Module m{code};
+  ShaderReflection r{};
+
+  std::vector<uint32_t> variables;
+  /* names, decorations, types */
+  for (const auto &[opcode, o] : m.instructions) {
+    switch (opcode) {
+    case spv::OP_NAME:
+      m.id(o[0]).name = literalString(o.subspan(1));
+      break;
+    case spv::OP_MEMBER_NAME: {
+      auto &names = m.id(o[0]).memberNames;
+      names.resize(std::max<size_t>(names.size(), o[1] + 1));
+      names[o[1]] = literalString(o.subspan(2));
+      break;
+    }
+    case spv::OP_ENTRY_POINT:
+      // a single entry point per module
+      if (r.entryPoint.empty()) {
+        r.stage = stageOf(o[0]);
+        r.entryPoint = literalString(o.subspan(2));
+      }
+      break;
+    case spv::OP_EXECUTION_MODE:
+      if (o[1] == spv::EXECUTION_MODE_LOCAL_SIZE) {
+        r.localSize = {o[2], o[3], o[4]};
+      }
+      break;
+    case spv::OP_EXECUTION_MODE_ID:
+      if (o[1] == spv::EXECUTION_MODE_LOCAL_SIZE_ID) {
+        r.localSizeIds = {o[2], o[3], o[4]};
+      }
+      break;
+    case spv::OP_DECORATE:
+      m.id(o[0]).decorations[o[1]] = o.size() > 2 ? o[2] : 0;
+      break;
+    case spv::OP_MEMBER_DECORATE:
+      m.id(o[0]).memberDecorations[o[1]][o[2]] = o.size() > 3 ? o[3] : 0;
+      break;
+    default: {
+      // types define their result id first, constants and variables second
+      const auto type =
+          (opcode >= spv::OP_TYPE_BOOL && opcode <= spv::OP_TYPE_POINTER) ||
+          opcode == spv::OP_TYPE_ACCELERATION_STRUCTURE;
+      const auto value = (opcode >= spv::OP_CONSTANT_TRUE &&
+                          opcode <= spv::OP_SPEC_CONSTANT) ||
+                         opcode == spv::OP_VARIABLE;
+      if (!type && !value) {
+        break;
+      }
+
+      auto &id = m.id(o[type ? 0 : 1]);
+      id.opcode = opcode;
+      id.operands.assign(o.begin(), o.end());
+      if (opcode == spv::OP_VARIABLE) {
+        variables.push_back(o[1]);
+      }
+      break;
+    }
+    }
+  }
+  /* workgroup size from spec constants */
+  for (uint32_t i = 0; i < 3; ++i) {
+    if (r.localSizeIds[i]) {
+      const auto id = *r.localSizeIds[i];
+      r.localSize[i] = m.constant(id);
+      const auto &d = m.id(id).decorations;
+      const auto specId = d.find(spv::DECORATION_SPEC_ID);
+      r.localSizeIds[i] = specId != d.end() ? std::optional{specId->second}
+                                            : std::nullopt;
+    }
+  }
+  /* specialization constants */
+  for (const auto &[opcode, o] : m.instructions) {
+    if (opcode != spv::OP_SPEC_CONSTANT &&
+        opcode != spv::OP_SPEC_CONSTANT_TRUE &&
+        opcode != spv::OP_SPEC_CONSTANT_FALSE) {
+      continue;
+    }
+
+    const auto &c = m.id(o[1]);
+    const auto specId = c.decorations.find(spv::DECORATION_SPEC_ID);
+    if (specId == c.decorations.end()) {
+      continue;
+    }
+    // booleans are VkBool32
+    const auto size =
+        opcode == spv::OP_SPEC_CONSTANT ? m.sizeOf(o[0]) : sizeof(vk::Bool32);
+    r.specializationConstants.push_back(
+        {specId->second, static_cast<uint32_t>(size), c.name});
+  }
+  /* resources */
+  for (const auto v : variables) {
+    const auto &var = m.id(v);
+    const auto storageClass = var.operands.at(2);
+    auto type = m.id(var.operands.at(0)).operands.at(2);
+
+    if (storageClass == spv::STORAGE_PUSH_CONSTANT) {
+      const auto &block = m.id(type);
+      ReflectedPushConstants pc{block.name, m.sizeOf(type), {}};
+      for (uint32_t i = 0; i + 1 < block.operands.size(); ++i) {
+        const auto memberType = block.operands[i + 1];
+        pc.members.push_back(
+            {i < block.memberNames.size() ? block.memberNames[i] : "",
+             m.memberOffset(type, i), m.memberSize(type, i, memberType),
+             m.typeName(memberType)});
+      }
+      r.pushConstants = std::move(pc);
+      continue;
+    }
+
+    if (!var.decorations.contains(spv::DECORATION_BINDING)) {
+      continue;
+    }
+
+    uint32_t count = 1;
+    while (m.id(type).opcode == spv::OP_TYPE_ARRAY ||
+           m.id(type).opcode == spv::OP_TYPE_RUNTIME_ARRAY) {
+      const auto &array = m.id(type);
+      count = array.opcode == spv::OP_TYPE_ARRAY
+                  ? count * m.constant(array.operands.at(2))
+                  : 0;
+      type = array.operands.at(1);
+    }
+
+    const auto set = var.decorations.find(spv::DECORATION_DESCRIPTOR_SET);
+    r.bindings.push_back(
+        {set != var.decorations.end() ? set->second : 0,
+         var.decorations.at(spv::DECORATION_BINDING),
+         descriptorType(m, storageClass, type), count,
+         var.name.empty() ? m.id(type).name : var.name});
+  }
+
+  return r;
+}
+
+ReflectedLayout
+reflectPipelineLayout(const Device &device,
+                      std::span<const ShaderReflection> stages) {
+  struct Binding {
+    vk::DescriptorSetLayoutBinding binding;
+    std::string name;
+  };
+
+  std::map<uint32_t, std::map<uint32_t, Binding>> sets;
+  std::vector<vk::PushConstantRange> ranges;
+  const ShaderReflection *pushConstants = nullptr;
+
+  for (const auto &s : stages) {
+    for (const auto &b : s.bindings) {
+      if (b.count == 0) {
+        throw std::runtime_error("Runtime array " + b.name +
+                                 " needs an explicit layout");
+      }
+
+      auto [it, inserted] = sets[b.set].try_emplace(
+          b.binding, Binding{{b.binding, b.type, b.count, s.stage}, b.name});
+      auto &existing = it->second.binding;
+      if (!inserted) {
+        if (existing.descriptorType != b.type ||
+            existing.descriptorCount != b.count) {
+          throw std::runtime_error(
+              "Binding " + std::to_string(b.set) + "." +
+              std::to_string(b.binding) + " differs between stages");
+        }
+        existing.stageFlags |= s.stage;
+      }
+    }
+
+    if (!s.pushConstants) {
+      continue;
+    }
+    // members at the same offset must have the same type in every stage
+    if (pushConstants != nullptr) {
+      for (const auto &a : pushConstants->pushConstants->members) {
+        for (const auto &b : s.pushConstants->members) {
+          if (a.offset == b.offset && a.type != b.type) {
+            throw std::runtime_error("Push constant " + b.name + " is " +
+                                     b.type + " in one stage and " + a.type +
+                                     " in another");
+          }
+        }
+      }
+    } else {
+      pushConstants = &s;
+    }
+    ranges.emplace_back(s.stage, 0, s.pushConstants->size);
+  }
+
+  ReflectedLayout r{};
+  for (uint32_t i = 0; !sets.empty() && i <= sets.rbegin()->first; ++i) {
+    std::vector<vk::DescriptorSetLayoutBinding> bindings;
+    if (const auto it = sets.find(i); it != sets.end()) {
+      for (const auto &[n, b] : it->second) {
+        bindings.push_back(b.binding);
+      }
+    }
+    r.setLayouts.push_back(device.descriptorSetLayout({{}, bindings}));
+  }
+  r.layout = device.pipelineLayout({{}, r.setLayouts, ranges});
+
+  return r;
+}
+
+void checkPushConstants(const ShaderReflection &stage, size_t size,
+                        size_t alignment) {
+  const auto expected =
+      stage.pushConstants ? stage.pushConstants->size : uint32_t{0};
+  const auto padded = (expected + alignment - 1) / alignment * alignment;
+  if (size != padded) {
+    spdlog::error("Push constants of {} are {} bytes, the C++ block is {}",
+                  stage.entryPoint, expected, size);
+    if (stage.pushConstants) {
+      for (const auto &m : stage.pushConstants->members) {
+        spdlog::error("  {} {} at offset {}", m.type, m.name, m.offset);
+      }
+    }
+    throw std::runtime_error("Push constant size mismatch");
+  }
+}
+} // namespace orphee
@@ -0,0 +1,370 @@
+#include <cstring>
+#include <fstream>
+#include <optional>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+#include <glslang/Public/ResourceLimits.h>
+#include <glslang/Public/ShaderLang.h>
+#include <glslang/SPIRV/GlslangToSpv.h>
+#include <spdlog/spdlog.h>
+
+#include <orphee/shaderCompiler.hpp>
+#include <orphee/trace.hpp>
+
+namespace orphee {
+namespace {
+constexpr uint64_t FNV_OFFSET = 0xcbf29ce484222325ULL;
+constexpr uint64_t FNV_PRIME = 0x100000001b3ULL;
+
+uint64_t fnv1a(uint64_t h, std::string_view data) {
+  for (const auto c : data) {
+    h ^= static_cast<uint8_t>(c);
+    h *= FNV_PRIME;
+  }
+  // separates consecutive fields
+  h ^= 0xFFU;
+  h *= FNV_PRIME;
+
+  return h;
+}
+
+std::string readFile(const std::filesystem::path &path) {
+  std::ifstream file{path, std::ios::binary};
+  if (!file) {
+    throw std::runtime_error("Failed to read " + path.string());
+  }
+
+  std::ostringstream s;
+  s << file.rdbuf();
+  return s.str();
+}
+
+std::optional<std::filesystem::path>
+resolve(const std::string &name, const std::filesystem::path &from,
+        const std::vector<std::filesystem::path> &includeDirs) {
+  if (!from.empty() && std::filesystem::exists(from / name)) {
+    return from / name;
+  }
+  for (const auto &dir : includeDirs) {
+    if (std::filesystem::exists(dir / name)) {
+      return dir / name;
+    }
+  }
+
+  return {};
+}
+
+// names of the #include directives of a source
+std::vector<std::string> includes(const std::string &text) {
+  std::vector<std::string> names;
+  std::istringstream lines{text};
+  for (std::string line; std::getline(lines, line);) {
+    const auto start = line.find_first_not_of(" \t");
+    if (start == std::string::npos || line.compare(start, 8, "#include") != 0) {
+      continue;
+    }
+    const auto open = line.find_first_of("\"<", start + 8);
+    const auto close = line.find_first_of("\">", open + 1);
+    if (open != std::string::npos && close != std::string::npos) {
+      names.push_back(line.substr(open + 1, close - open - 1));
+    }
+  }
+
+  return names;
+}
+
+EShLanguage stageOf(const std::filesystem::path &file) {
+  // name.stage.glsl
+  const auto stage = file.stem().extension().string();
+  if (stage == ".vert") {
+    return EShLangVertex;
+  }
+  if (stage == ".tesc") {
+    return EShLangTessControl;
+  }
+  if (stage == ".tese") {
+    return EShLangTessEvaluation;
+  }
+  if (stage == ".geom") {
+    return EShLangGeometry;
+  }
+  if (stage == ".frag") {
+    return EShLangFragment;
+  }
+  if (stage == ".comp") {
+    return EShLangCompute;
+  }
+  throw std::runtime_error("Unknown shader stage for " + file.string());
+}
+
+std::string compilerVersion() {
+  const auto v = glslang::GetVersion();
+  return "glslang " + std::to_string(v.major) + "." + std::to_string(v.minor) +
+         "." + std::to_string(v.patch) + v.flavor;
+}
+
+class Includer : public glslang::TShader::Includer {
+public:
+  explicit Includer(const std::vector<std::filesystem::path> &includeDirs)
+      : includeDirs{includeDirs} {}
+
+  IncludeResult *includeLocal(const char *headerName,
+                              const char *includerName,
+                              size_t /*depth*/) override {
+    return include(headerName,
+                   std::filesystem::path{includerName}.parent_path());
+  }
+
+  IncludeResult *includeSystem(const char *headerName,
+                               const char * /*includerName*/,
+                               size_t /*depth*/) override {
+    return include(headerName, {});
+  }
+
+  void releaseInclude(IncludeResult *result) override {
+    if (result != nullptr) {
+      delete static_cast<std::string *>(result->userData);
+      delete result;
+    }
+  }
+
+private:
+  IncludeResult *include(const char *name, const std::filesystem::path &from) {
+    const auto path = resolve(name, from, includeDirs);
+    if (!path) {
+      return nullptr;
+    }
+
+    auto *text = new std::string{readFile(*path)};
+    return new IncludeResult{path->string(), text->data(), text->size(), text};
+  }
+
+  const std::vector<std::filesystem::path> &includeDirs;
+};
+} // namespace
+
+ShaderCompiler::ShaderCompiler(ShaderCompilerSettings s)
+    : settings{std::move(s)} {
+  glslang::InitializeProcess();
+  std::filesystem::create_directories(settings.cacheDir);
+  spdlog::info("Shader compiler: {}, cache in {}", compilerVersion(),
+               settings.cacheDir.string());
+
+  watcher = std::thread{[this] { run(); }};
+}
+
+ShaderCompiler::~ShaderCompiler() {
+  {
+    std::lock_guard lock{mutex};
+    stop = true;
+  }
+  wake.notify_all();
+  watcher.join();
+
+  glslang::FinalizeProcess();
+}
+
+std::vector<uint32_t> ShaderCompiler::compile(const std::filesystem::path &file,
+                                              const ShaderDefines &defines) {
+  return build(file, defines, nullptr);
+}
+
+ShaderCompiler::Handle ShaderCompiler::watch(const std::filesystem::path &file,
+                                             ShaderDefines defines,
+                                             ReloadCallback onReload) {
+  const auto source = read(settings.sourceDir / file);
+
+  std::lock_guard lock{mutex};
+  const auto h = next++;
+  watched.insert({h, Watched{file, std::move(defines), std::move(onReload),
+                             lastWrite(source.files), source.files}});
+
+  return h;
+}
+
+void ShaderCompiler::unwatch(Handle h) {
+  std::lock_guard lock{mutex};
+  watched.erase(h);
+}
+
+void ShaderCompiler::poll() {
+  ORPHEE_ZONE("ShaderCompiler::poll");
+  std::vector<std::pair<ReloadCallback, std::vector<uint32_t>>> reloads;
+  {
+    std::lock_guard lock{mutex};
+    for (auto &[h, code] : ready) {
+      const auto it = watched.find(h);
+      if (it != watched.end()) {
+        reloads.emplace_back(it->second.onReload, std::move(code));
+      }
+    }
+    ready.clear();
+  }
+
+  // a failed reload keeps what the previous one installed
+  for (const auto &[onReload, code] : reloads) {
+    try {
+      onReload(code);
+    } catch (const std::exception &e) {
+      spdlog::error("Shader reload failed: {}", e.what());
+    }
+  }
+}
+
+ShaderCompiler::Source
+ShaderCompiler::read(const std::filesystem::path &file) const {
+  Source s{readFile(file), {file}, FNV_OFFSET};
+  s.hash = fnv1a(s.hash, s.text);
+
+  std::unordered_set<std::string> visited{file.string()};
+  for (size_t i = 0; i < s.files.size(); ++i) {
+    const auto text = i == 0 ? s.text : readFile(s.files[i]);
+    if (i > 0) {
+      s.hash = fnv1a(s.hash, text);
+    }
+
+    for (const auto &name : includes(text)) {
+      const auto path =
+          resolve(name, s.files[i].parent_path(), settings.includeDirs);
+      // missing includes are reported by glslang
+      if (path && visited.insert(path->string()).second) {
+        s.files.push_back(*path);
+      }
+    }
+  }
+
+  return s;
+}
+
+std::filesystem::file_time_type
+ShaderCompiler::lastWrite(const std::vector<std::filesystem::path> &files) {
+  auto t = std::filesystem::file_time_type::min();
+  for (const auto &f : files) {
+    std::error_code ec;
+    // editors may remove the file while saving
+    const auto w = std::filesystem::last_write_time(f, ec);
+    if (!ec) {
+      t = std::max(t, w);
+    }
+  }
+
+  return t;
+}
+
+std::vector<uint32_t>
+ShaderCompiler::build(const std::filesystem::path &file,
+                      const ShaderDefines &defines,
+                      std::vector<std::filesystem::path> *files) {
+  ORPHEE_ZONE("ShaderCompiler::build");
+  const auto path = settings.sourceDir / file;
+  const auto stage = stageOf(path);
+  const auto source = read(path);
+  if (files != nullptr) {
+    *files = source.files;
+  }
+
+  std::string preamble;
+  for (const auto &[name, value] : defines) {
+    preamble += "#define " + name + " " + value + "\n";
+  }
+
+  auto h = fnv1a(source.hash, compilerVersion());
+  h = fnv1a(h, path.stem().extension().string());
+  h = fnv1a(h, preamble);
+  /* cache */
+  const auto cached =
+      settings.cacheDir / (file.stem().stem().string() + "-" +
+                           fmt::format("{:016x}", h) + ".spv");
+  if (std::filesystem::exists(cached)) {
+    const auto bytes = readFile(cached);
+    std::vector<uint32_t> code(bytes.size() / sizeof(uint32_t));
+    std::memcpy(code.data(), bytes.data(), code.size() * sizeof(uint32_t));
+
+    return code;
+  }
+  /* compile */
+  std::lock_guard lock{compileMutex};
+  spdlog::info("Compiling {}", path.string());
+
+  glslang::TShader shader{stage};
+  const auto *text = source.text.c_str();
+  const auto name = path.string();
+  const auto *names = name.c_str();
+  shader.setStringsWithLengthsAndNames(&text, nullptr, &names, 1);
+  shader.setPreamble(preamble.c_str());
+  shader.setEnvInput(glslang::EShSourceGlsl, stage, glslang::EShClientVulkan,
+                     100);
+  shader.setEnvClient(glslang::EShClientVulkan, glslang::EShTargetVulkan_1_3);
+  shader.setEnvTarget(glslang::EShTargetSpv, glslang::EShTargetSpv_1_6);
+
+  const auto messages =
+      static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+  Includer includer{settings.includeDirs};
+  if (!shader.parse(GetDefaultResources(), 460, false, messages, includer)) {
+    throw std::runtime_error("Failed to compile " + name + "\n" +
+                             shader.getInfoLog());
+  }
+
+  glslang::TProgram program;
+  program.addShader(&shader);
+  if (!program.link(messages)) {
+    throw std::runtime_error("Failed to link " + name + "\n" +
+                             program.getInfoLog());
+  }
+
+  std::vector<uint32_t> code;
+  glslang::GlslangToSpv(*program.getIntermediate(stage), code);
+  /* store, renamed so readers never see a partial file */
+  const auto tmp = cached.string() + ".tmp";
+  {
+    std::ofstream out{tmp, std::ios::binary};
+    out.write(reinterpret_cast<const char *>(code.data()),
+              static_cast<std::streamsize>(code.size() * sizeof(uint32_t)));
+  }
+  std::filesystem::rename(tmp, cached);
+
+  return code;
+}
+
+void ShaderCompiler::run() {
+  ORPHEE_TRACE_THREAD("shader compiler");
+  while (true) {
+    std::vector<std::pair<Handle, Watched>> changed;
+    {
+      std::unique_lock lock{mutex};
+      wake.wait_for(lock, settings.pollInterval,
+                    [this] { return stop.load(); });
+      if (stop) {
+        return;
+      }
+
+      for (auto &[h, w] : watched) {
+        const auto t = lastWrite(w.files);
+        if (t > w.lastWrite) {
+          w.lastWrite = t;
+          changed.emplace_back(h, w);
+        }
+      }
+    }
+
+    for (auto &[h, w] : changed) {
+      try {
+        std::vector<std::filesystem::path> files;
+        auto code = build(w.file, w.defines, &files);
+
+        std::lock_guard lock{mutex};
+        if (const auto it = watched.find(h); it != watched.end()) {
+          // includes might have been added or removed
+          it->second.files = std::move(files);
+          ready.emplace_back(h, std::move(code));
+        }
+      } catch (const std::exception &e) {
+        // the previous pipeline stays in use until the shader is fixed
+        spdlog::error("{}", e.what());
+      }
+    }
+  }
+}
+} // namespace orphee
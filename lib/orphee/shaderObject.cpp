@@ -0,0 +1,117 @@
+#include <array>
+
+#include <orphee/shaderObject.hpp>
+
+namespace orphee {
+GraphicsShaders::GraphicsShaders(
+    const Device &device, std::span<const uint32_t> vertexCode,
+    std::span<const uint32_t> fragmentCode,
+    std::span<const vk::DescriptorSetLayout> setLayouts,
+    std::span<const vk::PushConstantRange> pushConstants)
+    : meshStages{device.capabilities.meshShaders} {
+  const auto layoutCount = static_cast<uint32_t>(setLayouts.size());
+  const auto rangeCount = static_cast<uint32_t>(pushConstants.size());
+  // linked stages allow cross stage optimizations
+  const std::array<vk::ShaderCreateInfoEXT, 2> infos{
+      vk::ShaderCreateInfoEXT{vk::ShaderCreateFlagBitsEXT::eLinkStage,
+                              vk::ShaderStageFlagBits::eVertex,
+                              vk::ShaderStageFlagBits::eFragment,
+                              vk::ShaderCodeTypeEXT::eSpirv,
+                              vertexCode.size_bytes(),
+                              vertexCode.data(),
+                              "main",
+                              layoutCount,
+                              setLayouts.data(),
+                              rangeCount,
+                              pushConstants.data(),
+                              {}},
+      vk::ShaderCreateInfoEXT{vk::ShaderCreateFlagBitsEXT::eLinkStage,
+                              vk::ShaderStageFlagBits::eFragment,
+                              {},
+                              vk::ShaderCodeTypeEXT::eSpirv,
+                              fragmentCode.size_bytes(),
+                              fragmentCode.data(),
+                              "main",
+                              layoutCount,
+                              setLayouts.data(),
+                              rangeCount,
+                              pushConstants.data(),
+                              {}},
+  };
+
+  shaders = device.h.createShadersEXT(infos);
+}
+
+void GraphicsShaders::bind(const vk::raii::CommandBuffer &cmd) const {
+  const std::array<vk::ShaderStageFlagBits, 2> stages{
+      vk::ShaderStageFlagBits::eVertex, vk::ShaderStageFlagBits::eFragment};
+  const std::array<vk::ShaderEXT, 2> handles{*shaders.at(0), *shaders.at(1)};
+  cmd.bindShadersEXT(stages, handles);
+
+  // every enabled stage needs a binding, null ones for a vertex draw
+  if (meshStages) {
+    const std::array<vk::ShaderStageFlagBits, 2> meshStageBits{
+        vk::ShaderStageFlagBits::eTaskEXT, vk::ShaderStageFlagBits::eMeshEXT};
+    const std::array<vk::ShaderEXT, 2> none{};
+    cmd.bindShadersEXT(meshStageBits, none);
+  }
+}
+
+void setRenderState(const vk::raii::CommandBuffer &cmd,
+                    const RenderState &state, vk::Extent2D extent) {
+  /* viewport */
+  const vk::Viewport viewport{0.0F,
+                              0.0F,
+                              static_cast<float>(extent.width),
+                              static_cast<float>(extent.height),
+                              0.0F,
+                              1.0F};
+  cmd.setViewportWithCount(viewport);
+  cmd.setScissorWithCount(vk::Rect2D{{0, 0}, extent});
+  /* vertex input and assembly */
+  cmd.setVertexInputEXT(state.vertexBindings, state.vertexAttributes);
+  cmd.setPrimitiveTopology(state.topology);
+  cmd.setPrimitiveRestartEnable(vk::False);
+  /* rasterization */
+  cmd.setRasterizerDiscardEnable(vk::False);
+  cmd.setPolygonModeEXT(state.polygonMode);
+  cmd.setCullMode(state.cullMode);
+  cmd.setFrontFace(state.frontFace);
+  cmd.setDepthBiasEnable(vk::False);
+  /* sampling */
+  const vk::SampleMask sampleMask = ~0U;
+  cmd.setRasterizationSamplesEXT(vk::SampleCountFlagBits::e1);
+  cmd.setSampleMaskEXT(vk::SampleCountFlagBits::e1, sampleMask);
+  cmd.setAlphaToCoverageEnableEXT(vk::False);
+  /* depth and stencil */
+  cmd.setDepthTestEnable(static_cast<vk::Bool32>(state.depthTest));
+  cmd.setDepthWriteEnable(static_cast<vk::Bool32>(state.depthWrite));
+  cmd.setDepthCompareOp(state.depthCompare);
+  cmd.setDepthBoundsTestEnable(vk::False);
+  cmd.setStencilTestEnable(vk::False);
+  /* color blending */
+  if (state.colorAttachments == 0) {
+    return;
+  }
+
+  const std::vector<vk::Bool32> blendEnables(
+      state.colorAttachments, static_cast<vk::Bool32>(state.blend));
+  cmd.setColorBlendEnableEXT(0, blendEnables);
+
+  const std::vector<vk::ColorComponentFlags> writeMasks(
+      state.colorAttachments,
+      vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
+          vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA);
+  cmd.setColorWriteMaskEXT(0, writeMasks);
+
+  if (state.blend) {
+    const std::vector<vk::ColorBlendEquationEXT> equations(
+        state.colorAttachments,
+        vk::ColorBlendEquationEXT{
+            vk::BlendFactor::eSrcAlpha, vk::BlendFactor::eOneMinusSrcAlpha,
+            vk::BlendOp::eAdd, vk::BlendFactor::eOne, vk::BlendFactor::eZero,
+            vk::BlendOp::eAdd});
+    cmd.setColorBlendEquationEXT(0, equations);
+  }
+}
+} // namespace orphee
@@ -0,0 +1,166 @@
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <spdlog/spdlog.h>
+
+#include <orphee/gpuProfiler.hpp>
+#include <orphee/trace.hpp>
+
+namespace orphee::trace {
+namespace {
+// events kept per thread, a power of two
+constexpr uint64_t CAPACITY = 1 << 16;
+
+struct Event {
+  // nullptr ends the innermost zone
+  const char *name;
+  int64_t ns;
+};
+
+struct Buffer {
+  std::array<Event, CAPACITY> events;
+  // written by the owning thread only
+  std::atomic<uint64_t> head{0};
+  uint32_t tid{};
+  // guarded by the registry mutex
+  std::string name;
+};
+
+struct Registry {
+  std::mutex mutex;
+  // kept after their thread exits
+  std::vector<std::shared_ptr<Buffer>> buffers;
+};
+
+Registry &registry() {
+  static Registry r;
+  return r;
+}
+
+Buffer &local() {
+  thread_local const auto buffer = [] {
+    auto b = std::make_shared<Buffer>();
+    auto &r = registry();
+    std::lock_guard lock{r.mutex};
+    b->tid = static_cast<uint32_t>(r.buffers.size()) + 1;
+    b->name = "thread " + std::to_string(b->tid);
+    r.buffers.push_back(b);
+    return b;
+  }();
+
+  return *buffer;
+}
+
+void push(const char *name) {
+  auto &b = local();
+  const auto h = b.head.load(std::memory_order_relaxed);
+  b.events[h % CAPACITY] = {
+      name, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch())
+                .count()};
+  b.head.store(h + 1, std::memory_order_release);
+}
+
+std::string escape(std::string_view s) {
+  std::string escaped;
+  for (const auto c : s) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+
+  return escaped;
+}
+
+std::string complete(std::string_view name, uint32_t pid, uint32_t tid,
+                     int64_t begin, int64_t end) {
+  return fmt::format("{{\"name\": \"{}\", \"ph\": \"X\", \"pid\": {}, "
+                     "\"tid\": {}, \"ts\": {:.3f}, \"dur\": {:.3f}}}",
+                     escape(name), pid, tid,
+                     static_cast<double>(begin) * 1e-3,
+                     static_cast<double>(end - begin) * 1e-3);
+}
+
+std::string metadata(std::string_view kind, uint32_t pid, uint32_t tid,
+                     std::string_view name) {
+  return fmt::format("{{\"name\": \"{}\", \"ph\": \"M\", \"pid\": {}, "
+                     "\"tid\": {}, \"args\": {{\"name\": \"{}\"}}}}",
+                     kind, pid, tid, escape(name));
+}
+} // namespace
+
+void begin(const char *name) { push(name); }
+
+void end() { push(nullptr); }
+
+void threadName(const char *name) {
+  auto &b = local();
+  auto &r = registry();
+  std::lock_guard lock{r.mutex};
+  b.name = name;
+}
+
+void save(const std::filesystem::path &file, const GpuProfiler *gpu) {
+  std::vector<std::shared_ptr<Buffer>> buffers;
+  std::vector<std::string> threadNames;
+  {
+    auto &r = registry();
+    std::lock_guard lock{r.mutex};
+    buffers = r.buffers;
+    for (const auto &b : buffers) {
+      threadNames.push_back(b->name);
+    }
+  }
+
+  std::ofstream out{file, std::ios::trunc};
+  out << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+  auto first = true;
+  const auto emit = [&](const std::string &event) {
+    out << (first ? "  " : ",\n  ") << event;
+    first = false;
+  };
+
+  emit(metadata("process_name", 1, 0, "CPU"));
+  for (size_t t = 0; t < buffers.size(); ++t) {
+    const auto &b = *buffers[t];
+    emit(metadata("thread_name", 1, b.tid, threadNames[t]));
+
+    // zones are paired back up, those cut by the ring are dropped
+    const auto head = b.head.load(std::memory_order_acquire);
+    std::vector<Event> open;
+    for (auto i = head - std::min(head, CAPACITY); i < head; ++i) {
+      const auto e = b.events[i % CAPACITY];
+      if (e.name != nullptr) {
+        open.push_back(e);
+      } else if (!open.empty()) {
+        emit(complete(open.back().name, 1, b.tid, open.back().ns, e.ns));
+        open.pop_back();
+      }
+    }
+  }
+
+  if (gpu != nullptr) {
+    emit(metadata("process_name", 2, 0, "GPU"));
+    for (const auto &e : gpu->events()) {
+      emit(complete(gpu->passes()[e.pass].name, 2, e.depth + 1, e.begin,
+                    e.end));
+    }
+  }
+
+  out << "\n]}\n";
+
+  if (!out) {
+    spdlog::warn("Failed to save the trace to {}", file.string());
+  } else {
+    spdlog::info("Trace saved to {}", file.string());
+  }
+}
+} // namespace orphee::trace
@@ -0,0 +1,139 @@
+#include <algorithm>
+#include <cfloat>
+
+#include <imgui.h>
+
+#include <orphee/ui/gpuProfiler.hpp>
+
+namespace orphee::ui {
+namespace {
+float sample(void *data, int idx) {
+  const auto &pass = *static_cast<const GpuPass *>(data);
+  return static_cast<float>(pass.samples[static_cast<size_t>(idx)]);
+}
+
+void history(const GpuPass &pass) {
+  // oldest first once the ring is full
+  const auto offset = pass.samples.size() == pass.next ? 0 : pass.next;
+  ImGui::PlotLines("##history", sample, const_cast<GpuPass *>(&pass),
+                   static_cast<int>(pass.samples.size()),
+                   static_cast<int>(offset), nullptr, 0.0F, FLT_MAX,
+                   {0.0F, 60.0F});
+}
+
+void timeline(const GpuProfiler &profiler) {
+  const auto &passes = profiler.passes();
+  const auto total = profiler.frame().last;
+  const auto width = ImGui::GetContentRegionAvail().x;
+  const auto scale = total > 0.0 ? width / static_cast<float>(total) : 0.0F;
+  const auto rowHeight = ImGui::GetTextLineHeightWithSpacing();
+  const auto origin = ImGui::GetCursorScreenPos();
+  auto *draw = ImGui::GetWindowDrawList();
+
+  uint32_t rows = 1;
+  for (size_t i = 0; i < passes.size(); ++i) {
+    const auto &pass = passes[i];
+    if (pass.frame != profiler.resolved()) {
+      continue;
+    }
+
+    const ImVec2 min{origin.x + static_cast<float>(pass.start) * scale,
+                     origin.y + static_cast<float>(pass.depth) * rowHeight};
+    const ImVec2 max{
+        min.x + std::max(1.0F, static_cast<float>(pass.last) * scale),
+        min.y + rowHeight - 1.0F};
+    const ImU32 color =
+        ImColor::HSV(static_cast<float>(i) * 0.13F, 0.6F, 0.7F);
+    draw->AddRectFilled(min, max, color);
+    draw->PushClipRect(min, max, true);
+    draw->AddText({min.x + 2.0F, min.y}, IM_COL32_WHITE, pass.name.c_str());
+    draw->PopClipRect();
+
+    if (ImGui::IsMouseHoveringRect(min, max)) {
+      ImGui::SetTooltip("%s: %.3f ms", pass.name.c_str(), pass.last);
+    }
+    rows = std::max(rows, pass.depth + 1);
+  }
+
+  ImGui::Dummy({width, static_cast<float>(rows) * rowHeight});
+}
+
+void table(const GpuProfiler &profiler) {
+  constexpr auto flags = ImGuiTableFlags_RowBg |
+                         ImGuiTableFlags_BordersInnerV |
+                         ImGuiTableFlags_ScrollX;
+  const auto &counters = profiler.counters();
+  if (!ImGui::BeginTable("passes", 5 + static_cast<int>(counters.size()),
+                         flags)) {
+    return;
+  }
+
+  ImGui::TableSetupColumn("Pass");
+  ImGui::TableSetupColumn("Last ms");
+  ImGui::TableSetupColumn("p50");
+  ImGui::TableSetupColumn("p95");
+  ImGui::TableSetupColumn("p99");
+  for (const auto c : counters) {
+    ImGui::TableSetupColumn(vk::to_string(c).c_str());
+  }
+  ImGui::TableHeadersRow();
+
+  for (const auto &pass : profiler.passes()) {
+    ImGui::TableNextRow();
+    ImGui::TableNextColumn();
+    ImGui::Indent(static_cast<float>(pass.depth) * 8.0F + 1.0F);
+    ImGui::TextUnformatted(pass.name.c_str());
+    ImGui::Unindent(static_cast<float>(pass.depth) * 8.0F + 1.0F);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.3f", pass.last);
+    ImGui::TableNextColumn();
+    ImGui::Text("%.3f", pass.percentile(0.5));
+    ImGui::TableNextColumn();
+    ImGui::Text("%.3f", pass.percentile(0.95));
+    ImGui::TableNextColumn();
+    ImGui::Text("%.3f", pass.percentile(0.99));
+    for (size_t c = 0; c < counters.size(); ++c) {
+      ImGui::TableNextColumn();
+      if (c < pass.counters.size()) {
+        ImGui::Text("%llu",
+                    static_cast<unsigned long long>(pass.counters[c]));
+      }
+    }
+  }
+
+  ImGui::EndTable();
+}
+} // namespace
+
+void gpuProfilerWindow(const GpuProfiler &profiler, bool *open) {
+  if (!ImGui::Begin("GPU profiler", open)) {
+    ImGui::End();
+    return;
+  }
+
+  if (!profiler.enabled()) {
+    ImGui::TextUnformatted("The queue does not support timestamps");
+    ImGui::End();
+    return;
+  }
+
+  const auto &frame = profiler.frame();
+  ImGui::Text("Frame %.3f ms, p50 %.3f, p95 %.3f, p99 %.3f", frame.last,
+              frame.percentile(0.5), frame.percentile(0.95),
+              frame.percentile(0.99));
+  history(frame);
+  ImGui::Separator();
+  timeline(profiler);
+  ImGui::Separator();
+  table(profiler);
+  if (ImGui::Button("Save CSV")) {
+    profiler.save("gpuProfile.csv");
+  }
+  ImGui::SameLine();
+  if (ImGui::Button("Save JSON")) {
+    profiler.save("gpuProfile.json");
+  }
+
+  ImGui::End();
+}
+} // namespace orphee::ui
@@ -1,150 +1,550 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
-#include <unordered_set>
+#include <string_view>
+#include <utility>
 #include <unordered_map>
 
 #include <spdlog/spdlog.h>
 
 #include <orphee/orphee.hpp>
+#include <orphee/trace.hpp>
 #include <orphee/vkManager.hpp>
 
 namespace orphee {
+namespace {
+constexpr std::array<std::pair<std::string_view, InstanceProfile>, 4> PROFILES{{
+    {"release", InstanceProfile::eRelease},
+    {"debug", InstanceProfile::eDebug},
+    {"gpu", InstanceProfile::eGpuAssisted},
+    {"sync", InstanceProfile::eSynchronization},
+}};
+
+std::string_view profileName(InstanceProfile profile) {
+  for (const auto &[name, p] : PROFILES) {
+    if (p == profile) {
+      return name;
+    }
+  }
+
+  return "unknown";
+}
+
+Settings withEnvironment(Settings s) {
+  if (const auto *value = std::getenv("ORPHEE_VK_PROFILE")) {
+    const std::string_view v{value};
+    const auto it =
+        std::find_if(PROFILES.begin(), PROFILES.end(),
+                     [v](const auto &p) { return p.first == v; });
+    if (it == PROFILES.end()) {
+      spdlog::warn("Unknown ORPHEE_VK_PROFILE {}, expected release, debug, "
+                   "gpu or sync",
+                   v);
+    } else {
+      s.profile = it->second;
+    }
+  }
+
+  if (const auto *value = std::getenv("ORPHEE_VK_DEVICE")) {
+    const std::string v{value};
+    const auto hex = std::all_of(v.begin(), v.end(), [](char c) {
+      return std::isxdigit(static_cast<unsigned char>(c)) != 0;
+    });
+    const auto digits = std::all_of(v.begin(), v.end(), [](char c) {
+      return std::isdigit(static_cast<unsigned char>(c)) != 0;
+    });
+
+    s.device = {};
+    if (v.size() == 32 && hex) {
+      s.device.uuid = v;
+      std::transform(v.begin(), v.end(), s.device.uuid.begin(), [](char c) {
+        return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+      });
+    } else if (!v.empty() && digits) {
+      s.device.index = static_cast<uint32_t>(std::stoul(v));
+    } else {
+      s.device.name = v;
+    }
+  }
+
+  return s;
+}
+
+struct Candidate {
+  uint32_t index;
+  std::string name;
+  std::string uuid;
+  vk::PhysicalDeviceType type;
+  // largest device local heap
+  vk::DeviceSize localMemory{};
+  uint32_t subgroupSize{};
+  // optional extensions available, settings included
+  uint32_t optional{};
+  uint32_t score{};
+  std::optional<uint32_t> family;
+  // why the device does not meet the requirements, empty when it does
+  std::string rejected;
+};
+
+// the device type dominates, an integrated GPU never outranks a discrete one
+uint32_t score(const Candidate &c, const vk::PhysicalDeviceLimits &limits) {
+  uint32_t s = 0;
+  switch (c.type) {
+  case vk::PhysicalDeviceType::eDiscreteGpu:
+    s += 4000;
+    break;
+  case vk::PhysicalDeviceType::eIntegratedGpu:
+    s += 2000;
+    break;
+  case vk::PhysicalDeviceType::eVirtualGpu:
+    s += 1000;
+    break;
+  default:
+    break;
+  }
+
+  // 100 per GiB, up to 10 GiB
+  const auto gib = std::min<vk::DeviceSize>(c.localMemory >> 30, 10);
+  s += static_cast<uint32_t>(gib) * 100;
+  s += c.subgroupSize;
+  s += limits.maxComputeSharedMemorySize >> 10;
+  s += limits.maxComputeWorkGroupInvocations >> 6;
+  s += c.optional * 50;
+
+  return s;
+}
+
+bool matches(const Candidate &c, const DeviceSelection &selection) {
+  return (selection.name.empty() ||
+          c.name.find(selection.name) != std::string::npos) &&
+         (selection.uuid.empty() || c.uuid == selection.uuid) &&
+         (!selection.index || c.index == *selection.index);
+}
+
+std::optional<size_t> select(const std::vector<Candidate> &candidates,
+                             const DeviceSelection &selection) {
+  if (selection.pinned()) {
+    const auto it = std::find_if(
+        candidates.begin(), candidates.end(),
+        [&selection](const Candidate &c) { return matches(c, selection); });
+    if (it == candidates.end()) {
+      spdlog::error("No physical device matches the selection");
+      return {};
+    }
+    if (!it->rejected.empty()) {
+      spdlog::error("Selected physical device {} is not suitable: {}",
+                    it->name, it->rejected);
+      return {};
+    }
+
+    return static_cast<size_t>(it - candidates.begin());
+  }
+
+  std::optional<size_t> best;
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    const auto &c = candidates[i];
+    if (c.rejected.empty() && (!best || c.score > candidates[*best].score)) {
+      best = i;
+    }
+  }
+
+  return best;
+}
+
+void logDecision(const std::vector<Candidate> &candidates,
+                 std::optional<size_t> chosen, bool pinned) {
+  spdlog::info("{:>2} {:<32} {:<14} {:>8} {:>8} {:>8} {:>6}", "#", "Device",
+               "Type", "VRAM MiB", "Subgroup", "Optional", "Score");
+  for (size_t i = 0; i < candidates.size(); ++i) {
+    const auto &c = candidates[i];
+    std::string decision = c.rejected;
+    if (chosen == i) {
+      decision = pinned ? "selected (pinned)" : "selected";
+    }
+    spdlog::info("{:>2} {:<32} {:<14} {:>8} {:>8} {:>8} {:>6} {}", c.index,
+                 c.name, vk::to_string(c.type), c.localMemory >> 20,
+                 c.subgroupSize, c.optional, c.score, decision);
+  }
+}
+
+bool contains(const std::vector<const char *> &names, const char *name) {
+  return std::any_of(names.begin(), names.end(), [name](const char *n) {
+    return std::strcmp(n, name) == 0;
+  });
+}
+
+VKAPI_ATTR VkBool32 VKAPI_CALL
+debugCallback(VkDebugUtilsMessageSeverityFlagBitsEXT severity,
+              VkDebugUtilsMessageTypeFlagsEXT /*types*/,
+              const VkDebugUtilsMessengerCallbackDataEXT *data,
+              void * /*user*/) {
+  const auto *id = data->pMessageIdName != nullptr ? data->pMessageIdName : "";
+  if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT) {
+    spdlog::error("Vulkan {}: {}", id, data->pMessage);
+  } else if (severity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT) {
+    spdlog::warn("Vulkan {}: {}", id, data->pMessage);
+  } else {
+    spdlog::debug("Vulkan {}: {}", id, data->pMessage);
+  }
+
+  return VK_FALSE;
+}
+
+vk::DebugUtilsMessengerCreateInfoEXT messengerInfo() {
+  return {{},
+          vk::DebugUtilsMessageSeverityFlagBitsEXT::eInfo |
+              vk::DebugUtilsMessageSeverityFlagBitsEXT::eWarning |
+              vk::DebugUtilsMessageSeverityFlagBitsEXT::eError,
+          vk::DebugUtilsMessageTypeFlagBitsEXT::eGeneral |
+              vk::DebugUtilsMessageTypeFlagBitsEXT::eValidation |
+              vk::DebugUtilsMessageTypeFlagBitsEXT::ePerformance,
+          debugCallback};
+}
+} // namespace
+
 vkManager::vkManager(Settings s, Meta m)
-    : settings{s}, meta{std::move(m)}, instance{createInstance()} {}
+    : settings{withEnvironment(s)}, meta{std::move(m)},
+      probes{std::make_unique<ProbeCache>(settings.probeCache)},
+      instance{createInstance()} {
+  if (settings.profile != InstanceProfile::eRelease) {
+    messenger = instance.createDebugUtilsMessengerEXT(messengerInfo());
+  }
+}
 
 vkManager::~vkManager() { spdlog::info("Destroying Vulkan manager..."); }
 
 std::optional<Device>
 vkManager::createDevice(const QueueFamilyRequirements &reqs) const {
-  for (auto &physicalDevice : instance.enumeratePhysicalDevices()) {
-    if (reqs.surface.has_value() && !settings.windowing) {
-      spdlog::error("Windowing is required");
-      return {};
+  ORPHEE_ZONE("vkManager::createDevice");
+  if (reqs.surface.has_value() && !settings.windowing) {
+    spdlog::error("Windowing is required");
+    return {};
+  }
+
+  std::vector<const char *> extensions;
+  if (reqs.surface.has_value()) {
+    for (const auto &x : ORPHEE_REQUIRED_VK_DEVICE_WINDOWING_EXTENSIONS) {
+      extensions.push_back(x);
     }
+  }
+
+  for (const auto &x : ORPHEE_REQUIRED_VK_DEVICE_EXTENSIONS) {
+    extensions.push_back(x);
+  }
+
+  // counted in the scores
+  std::vector<const char *> requested(
+      ORPHEE_OPTIONAL_VK_DEVICE_EXTENSIONS.begin(),
+      ORPHEE_OPTIONAL_VK_DEVICE_EXTENSIONS.end());
+  if (settings.descriptors == DescriptorBackend::eBuffer) {
+    requested.push_back(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+  }
+  if (settings.shaderObjects) {
+    requested.push_back(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+  }
+  if (settings.pipelineLibraries) {
+    requested.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+    requested.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+  }
 
-    std::vector<const char *> extensions;
-    if (reqs.surface.has_value()) {
-      for (const auto &x : ORPHEE_REQUIRED_VK_DEVICE_WINDOWING_EXTENSIONS) {
-        extensions.push_back(x);
+  auto physicalDevices = instance.enumeratePhysicalDevices();
+  std::vector<Candidate> candidates;
+  for (uint32_t i = 0; i < physicalDevices.size(); ++i) {
+    const auto &physical = physicalDevices[i];
+    const auto properties =
+        physical.getProperties2<vk::PhysicalDeviceProperties2,
+                                vk::PhysicalDeviceIDProperties,
+                                vk::PhysicalDeviceSubgroupProperties>();
+    const auto &p = properties.get<vk::PhysicalDeviceProperties2>().properties;
+
+    Candidate c{.index = i, .name = p.deviceName.data(), .type = p.deviceType};
+    for (const auto b :
+         properties.get<vk::PhysicalDeviceIDProperties>().deviceUUID) {
+      c.uuid += fmt::format("{:02x}", b);
+    }
+    c.subgroupSize =
+        properties.get<vk::PhysicalDeviceSubgroupProperties>().subgroupSize;
+    const auto memory = physical.getMemoryProperties();
+    for (uint32_t h = 0; h < memory.memoryHeapCount; ++h) {
+      const auto &heap = memory.memoryHeaps[h];
+      if (heap.flags & vk::MemoryHeapFlagBits::eDeviceLocal) {
+        c.localMemory = std::max(c.localMemory, heap.size);
       }
     }
+    const auto &probe = probes->device(physical);
+    c.optional = static_cast<uint32_t>(
+        obtainOptionalExtensions(probe, requested).size());
+    c.score = score(c, p.limits);
+
+    if (!checkPhysicalDeviceExtensions(probe, extensions)) {
+      c.rejected = "missing required extensions";
+    } else if (const auto f = obtainQueueFamilies(physical, probe, reqs)) {
+      c.family = *f;
+    } else {
+      c.rejected = "no matching queue family";
+    }
 
-    for (const auto &x : ORPHEE_REQUIRED_VK_DEVICE_EXTENSIONS) {
-      extensions.push_back(x);
+    candidates.push_back(std::move(c));
+  }
+  probes->save();
+
+  const auto chosen = select(candidates, settings.device);
+  logDecision(candidates, chosen, settings.device.pinned());
+  if (!chosen) {
+    return {};
+  }
+
+  auto &physicalDevice = physicalDevices[*chosen];
+  const auto &probe = probes->device(physicalDevice);
+  const auto fIdx = *candidates[*chosen].family;
+
+  for (const auto &x :
+       obtainOptionalExtensions(probe, ORPHEE_OPTIONAL_VK_DEVICE_EXTENSIONS)) {
+    extensions.push_back(x);
+  }
+
+  auto descriptorBackend = DescriptorBackend::ePool;
+  if (settings.descriptors == DescriptorBackend::eBuffer) {
+    const std::array<const char *, 1> descriptorBuffer{
+        VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME};
+    if (obtainOptionalExtensions(probe, descriptorBuffer).empty()) {
+      spdlog::warn("Descriptor buffers are not available, falling back to "
+                   "descriptor pools");
+    } else {
+      extensions.push_back(VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME);
+      descriptorBackend = DescriptorBackend::eBuffer;
     }
+  }
 
-    // check extensions
-    const auto cx = checkPhysicalDeviceExtensions(physicalDevice, extensions);
-    if (!cx) {
-      continue;
+  auto shaderObjects = false;
+  if (settings.shaderObjects) {
+    const std::array<const char *, 1> shaderObject{
+        VK_EXT_SHADER_OBJECT_EXTENSION_NAME};
+    if (obtainOptionalExtensions(probe, shaderObject).empty()) {
+      spdlog::warn("Shader objects are not available, falling back to "
+                   "pipelines");
+    } else {
+      extensions.push_back(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+      shaderObjects = true;
     }
+  }
 
-    auto qfR = obtainQueueFamilies(physicalDevice, reqs);
-    if (!qfR) {
-      continue;
+  auto pipelineLibraries = false;
+  if (settings.pipelineLibraries) {
+    const std::array<const char *, 2> pipelineLibrary{
+        VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+        VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME};
+    if (obtainOptionalExtensions(probe, pipelineLibrary).size() !=
+        pipelineLibrary.size()) {
+      spdlog::warn("Graphics pipeline libraries are not available, falling "
+                   "back to monolithic pipelines");
+    } else {
+      extensions.insert(extensions.end(), pipelineLibrary.begin(),
+                        pipelineLibrary.end());
+      pipelineLibraries = true;
     }
-    const auto fIdx = *qfR;
+  }
+
+  std::vector<float> queuePriorities;
+  for (uint32_t i = 0; i < reqs.count; ++i) {
+    queuePriorities.emplace_back(1.0F);
+  }
 
-    std::vector<float> queuePriorities;
-    for (uint32_t i = 0; i < reqs.count; ++i) {
-      queuePriorities.emplace_back(1.0F);
+  vk::DeviceQueueCreateInfo queueInfo{{}, fIdx, queuePriorities};
+
+  auto features = ORPHEE_REQUIRED_VK_DEVICE_FEATURES;
+  auto &features2 = features.get<vk::PhysicalDeviceFeatures2>();
+  auto &features11 = features.get<vk::PhysicalDeviceVulkan11Features>();
+  auto &features12 = features.get<vk::PhysicalDeviceVulkan12Features>();
+  // optional features are enabled as supported, see Device::capabilities
+  const auto supported =
+      physicalDevice.getFeatures2<vk::PhysicalDeviceFeatures2,
+                                  vk::PhysicalDeviceVulkan11Features,
+                                  vk::PhysicalDeviceVulkan12Features>();
+  const auto &core = supported.get<vk::PhysicalDeviceFeatures2>().features;
+  const auto &supported11 = supported.get<vk::PhysicalDeviceVulkan11Features>();
+  const auto &supported12 = supported.get<vk::PhysicalDeviceVulkan12Features>();
+  features2.features.pipelineStatisticsQuery = core.pipelineStatisticsQuery;
+  features2.features.shaderFloat64 = core.shaderFloat64;
+  features2.features.shaderInt64 = core.shaderInt64;
+  features2.features.shaderInt16 = core.shaderInt16;
+  features11.storageBuffer16BitAccess = supported11.storageBuffer16BitAccess;
+  features12.shaderFloat16 = supported12.shaderFloat16;
+  features12.shaderInt8 = supported12.shaderInt8;
+  features12.storageBuffer8BitAccess = supported12.storageBuffer8BitAccess;
+  vk::PhysicalDeviceDescriptorBufferFeaturesEXT descriptorBufferFeatures{
+      vk::True};
+  if (descriptorBackend == DescriptorBackend::eBuffer) {
+    descriptorBufferFeatures.pNext = features2.pNext;
+    features2.pNext = &descriptorBufferFeatures;
+  }
+  vk::PhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures{vk::True};
+  if (shaderObjects) {
+    shaderObjectFeatures.pNext = features2.pNext;
+    features2.pNext = &shaderObjectFeatures;
+  }
+  vk::PhysicalDeviceGraphicsPipelineLibraryFeaturesEXT
+      pipelineLibraryFeatures{vk::True};
+  if (pipelineLibraries) {
+    pipelineLibraryFeatures.pNext = features2.pNext;
+    features2.pNext = &pipelineLibraryFeatures;
+  }
+  vk::PhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+  if (contains(extensions, VK_EXT_MESH_SHADER_EXTENSION_NAME)) {
+    const auto mesh =
+        physicalDevice
+            .getFeatures2<vk::PhysicalDeviceFeatures2,
+                          vk::PhysicalDeviceMeshShaderFeaturesEXT>()
+            .get<vk::PhysicalDeviceMeshShaderFeaturesEXT>();
+    // both or none, shader objects then bind null to both stages
+    if (mesh.taskShader == vk::True && mesh.meshShader == vk::True) {
+      meshShaderFeatures.taskShader = vk::True;
+      meshShaderFeatures.meshShader = vk::True;
+      meshShaderFeatures.pNext = features2.pNext;
+      features2.pNext = &meshShaderFeatures;
     }
+  }
 
-    vk::DeviceQueueCreateInfo queueInfo{{}, fIdx, queuePriorities};
+  vk::DeviceCreateInfo deviceInfo{
+      {}, queueInfo, {}, extensions, {}, &features2};
 
-    vk::DeviceCreateInfo deviceInfo{
-        {},
-        queueInfo,
-        {},
-        extensions,
-        {},
-        &ORPHEE_REQUIRED_VK_DEVICE_FEATURES.get<vk::PhysicalDeviceFeatures2>()};
+  auto d = physicalDevice.createDevice(deviceInfo);
 
-    auto d = physicalDevice.createDevice(deviceInfo);
+  std::unordered_map<std::string, std::unique_ptr<QueueFamily>> qfs;
+  std::unordered_map<std::string, std::unique_ptr<Queue>> qs;
 
-    std::unordered_map<std::string, std::unique_ptr<QueueFamily>> qfs;
-    std::unordered_map<std::string, std::unique_ptr<Queue>> qs;
+  auto qf = std::make_unique<QueueFamily>();
+  qf->capabilities = reqs.capabilities;
+  qf->present = reqs.surface.has_value();
 
-    auto qf = std::make_unique<QueueFamily>();
-    qf->capabilities = reqs.capabilities;
-    qf->present = reqs.surface.has_value();
+  for (uint32_t i = 0; i < reqs.count; ++i) {
+    auto q = std::make_unique<Queue>();
+    q->h = d.getQueue(fIdx, i);
+    q->fIdx = fIdx;
+    q->queueFamily = qf.get();
+    qf->queues.push_back(q.get());
+    qs.insert({reqs.tag + std::to_string(i), std::move(q)});
+  }
 
-    for (uint32_t i = 0; i < reqs.count; ++i) {
-      auto q = std::make_unique<Queue>();
-      q->h = d.getQueue(fIdx, i);
-      q->fIdx = fIdx;
-      q->queueFamily = qf.get();
-      qf->queues.push_back(q.get());
-      qs.insert({reqs.tag + std::to_string(i), std::move(q)});
-    }
+  qfs.insert({reqs.tag, std::move(qf)});
+
+  VmaVulkanFunctions vulkanFunctions{};
+  vulkanFunctions.vkGetInstanceProcAddr =
+      instance.getDispatcher()->vkGetInstanceProcAddr;
+  vulkanFunctions.vkGetDeviceProcAddr = d.getDispatcher()->vkGetDeviceProcAddr;
+  vulkanFunctions.vkGetPhysicalDeviceProperties =
+      physicalDevice.getDispatcher()->vkGetPhysicalDeviceProperties;
+  vulkanFunctions.vkGetPhysicalDeviceMemoryProperties =
+      physicalDevice.getDispatcher()->vkGetPhysicalDeviceMemoryProperties;
+  vulkanFunctions.vkAllocateMemory = d.getDispatcher()->vkAllocateMemory;
+  vulkanFunctions.vkFreeMemory = d.getDispatcher()->vkFreeMemory;
+  vulkanFunctions.vkMapMemory = d.getDispatcher()->vkMapMemory;
+  vulkanFunctions.vkUnmapMemory = d.getDispatcher()->vkUnmapMemory;
+  vulkanFunctions.vkFlushMappedMemoryRanges =
+      d.getDispatcher()->vkFlushMappedMemoryRanges;
+  vulkanFunctions.vkInvalidateMappedMemoryRanges =
+      d.getDispatcher()->vkInvalidateMappedMemoryRanges;
+  vulkanFunctions.vkBindBufferMemory = d.getDispatcher()->vkBindBufferMemory;
+  vulkanFunctions.vkBindImageMemory = d.getDispatcher()->vkBindImageMemory;
+  vulkanFunctions.vkGetBufferMemoryRequirements =
+      d.getDispatcher()->vkGetBufferMemoryRequirements;
+  vulkanFunctions.vkGetImageMemoryRequirements =
+      d.getDispatcher()->vkGetImageMemoryRequirements;
+  vulkanFunctions.vkCreateBuffer = d.getDispatcher()->vkCreateBuffer;
+  vulkanFunctions.vkDestroyBuffer = d.getDispatcher()->vkDestroyBuffer;
+  vulkanFunctions.vkCreateImage = d.getDispatcher()->vkCreateImage;
+  vulkanFunctions.vkDestroyImage = d.getDispatcher()->vkDestroyImage;
+  vulkanFunctions.vkCmdCopyBuffer = d.getDispatcher()->vkCmdCopyBuffer;
+  vulkanFunctions.vkGetBufferMemoryRequirements2KHR =
+      d.getDispatcher()->vkGetBufferMemoryRequirements2KHR;
+  vulkanFunctions.vkGetImageMemoryRequirements2KHR =
+      d.getDispatcher()->vkGetImageMemoryRequirements2KHR;
+  vulkanFunctions.vkBindBufferMemory2KHR =
+      d.getDispatcher()->vkBindBufferMemory2KHR;
+  vulkanFunctions.vkBindImageMemory2KHR =
+      d.getDispatcher()->vkBindImageMemory2KHR;
+  vulkanFunctions.vkGetPhysicalDeviceMemoryProperties2KHR =
+      physicalDevice.getDispatcher()->vkGetPhysicalDeviceMemoryProperties2KHR;
+  vulkanFunctions.vkGetDeviceBufferMemoryRequirements =
+      d.getDispatcher()->vkGetDeviceBufferMemoryRequirements;
+  vulkanFunctions.vkGetDeviceImageMemoryRequirements =
+      d.getDispatcher()->vkGetDeviceImageMemoryRequirements;
+
+  VmaAllocatorCreateInfo allocatorInfo{};
+  allocatorInfo.flags = VMA_ALLOCATOR_CREATE_KHR_DEDICATED_ALLOCATION_BIT |
+                        VMA_ALLOCATOR_CREATE_KHR_BIND_MEMORY2_BIT |
+                        VMA_ALLOCATOR_CREATE_KHR_MAINTENANCE4_BIT |
+                        VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT |
+                        VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT |
+                        VMA_ALLOCATOR_CREATE_EXT_MEMORY_PRIORITY_BIT;
+  allocatorInfo.physicalDevice = *physicalDevice;
+  allocatorInfo.device = *d;
+  allocatorInfo.pVulkanFunctions = &vulkanFunctions;
+  allocatorInfo.instance = *instance;
+  allocatorInfo.vulkanApiVersion = ORPHEE_VK_VERSION;
+
+  VmaAllocator allocator{};
+  vmaCreateAllocator(&allocatorInfo, &allocator);
+
+  const auto subgroup =
+      physicalDevice
+          .getProperties2<vk::PhysicalDeviceProperties2,
+                          vk::PhysicalDeviceSubgroupProperties>()
+          .get<vk::PhysicalDeviceSubgroupProperties>();
+
+  Capabilities capabilities;
+  capabilities.pipelineStatisticsQuery =
+      features2.features.pipelineStatisticsQuery == vk::True;
+  capabilities.shaderFloat64 = features2.features.shaderFloat64 == vk::True;
+  capabilities.shaderInt64 = features2.features.shaderInt64 == vk::True;
+  capabilities.shaderInt16 = features2.features.shaderInt16 == vk::True;
+  capabilities.shaderFloat16 = features12.shaderFloat16 == vk::True;
+  capabilities.shaderInt8 = features12.shaderInt8 == vk::True;
+  capabilities.storageBuffer16BitAccess =
+      features11.storageBuffer16BitAccess == vk::True;
+  capabilities.storageBuffer8BitAccess =
+      features12.storageBuffer8BitAccess == vk::True;
+  if (subgroup.supportedStages & vk::ShaderStageFlagBits::eCompute) {
+    capabilities.subgroupOperations = subgroup.supportedOperations;
+  }
+  capabilities.subgroupSize = subgroup.subgroupSize;
+  capabilities.pushDescriptors =
+      contains(extensions, VK_KHR_PUSH_DESCRIPTOR_EXTENSION_NAME);
+  capabilities.descriptorBuffer =
+      descriptorBackend == DescriptorBackend::eBuffer;
+  capabilities.shaderObjects = shaderObjects;
+  capabilities.pipelineLibraries = pipelineLibraries;
+  capabilities.meshShaders = meshShaderFeatures.taskShader == vk::True &&
+                             meshShaderFeatures.meshShader == vk::True;
+
+  Device device{physicalDevice, d, qfs, qs, allocator};
+  device.extensions.assign(extensions.begin(), extensions.end());
+  device.capabilities = capabilities;
+  device.descriptorBackend = descriptorBackend;
+
+  spdlog::info("{} ready {:.1f} ms after the Vulkan manager was created",
+               candidates[*chosen].name,
+               std::chrono::duration<double, std::milli>(
+                   std::chrono::steady_clock::now() - started)
+                   .count());
+
+  return device;
+}
 
-    qfs.insert({reqs.tag, std::move(qf)});
-
-    VmaVulkanFunctions vulkanFunctions{};
-    vulkanFunctions.vkGetInstanceProcAddr =
-        instance.getDispatcher()->vkGetInstanceProcAddr;
-    vulkanFunctions.vkGetDeviceProcAddr =
-        d.getDispatcher()->vkGetDeviceProcAddr;
-    vulkanFunctions.vkGetPhysicalDeviceProperties =
-        physicalDevice.getDispatcher()->vkGetPhysicalDeviceProperties;
-    vulkanFunctions.vkGetPhysicalDeviceMemoryProperties =
-        physicalDevice.getDispatcher()->vkGetPhysicalDeviceMemoryProperties;
-    vulkanFunctions.vkAllocateMemory = d.getDispatcher()->vkAllocateMemory;
-    vulkanFunctions.vkFreeMemory = d.getDispatcher()->vkFreeMemory;
-    vulkanFunctions.vkMapMemory = d.getDispatcher()->vkMapMemory;
-    vulkanFunctions.vkUnmapMemory = d.getDispatcher()->vkUnmapMemory;
-    vulkanFunctions.vkFlushMappedMemoryRanges =
-        d.getDispatcher()->vkFlushMappedMemoryRanges;
-    vulkanFunctions.vkInvalidateMappedMemoryRanges =
-        d.getDispatcher()->vkInvalidateMappedMemoryRanges;
-    vulkanFunctions.vkBindBufferMemory = d.getDispatcher()->vkBindBufferMemory;
-    vulkanFunctions.vkBindImageMemory = d.getDispatcher()->vkBindImageMemory;
-    vulkanFunctions.vkGetBufferMemoryRequirements =
-        d.getDispatcher()->vkGetBufferMemoryRequirements;
-    vulkanFunctions.vkGetImageMemoryRequirements =
-        d.getDispatcher()->vkGetImageMemoryRequirements;
-    vulkanFunctions.vkCreateBuffer = d.getDispatcher()->vkCreateBuffer;
-    vulkanFunctions.vkDestroyBuffer = d.getDispatcher()->vkDestroyBuffer;
-    vulkanFunctions.vkCreateImage = d.getDispatcher()->vkCreateImage;
-    vulkanFunctions.vkDestroyImage = d.getDispatcher()->vkDestroyImage;
-    vulkanFunctions.vkCmdCopyBuffer = d.getDispatcher()->vkCmdCopyBuffer;
-    vulkanFunctions.vkGetBufferMemoryRequirements2KHR =
-        d.getDispatcher()->vkGetBufferMemoryRequirements2KHR;
-    vulkanFunctions.vkGetImageMemoryRequirements2KHR =
-        d.getDispatcher()->vkGetImageMemoryRequirements2KHR;
-    vulkanFunctions.vkBindBufferMemory2KHR =
-        d.getDispatcher()->vkBindBufferMemory2KHR;
-    vulkanFunctions.vkBindImageMemory2KHR =
-        d.getDispatcher()->vkBindImageMemory2KHR;
-    vulkanFunctions.vkGetPhysicalDeviceMemoryProperties2KHR =
-        physicalDevice.getDispatcher()->vkGetPhysicalDeviceMemoryProperties2KHR;
-    vulkanFunctions.vkGetDeviceBufferMemoryRequirements =
-        d.getDispatcher()->vkGetDeviceBufferMemoryRequirements;
-    vulkanFunctions.vkGetDeviceImageMemoryRequirements =
-        d.getDispatcher()->vkGetDeviceImageMemoryRequirements;
-
-    VmaAllocatorCreateInfo allocatorInfo{};
-    allocatorInfo.flags = VMA_ALLOCATOR_CREATE_KHR_DEDICATED_ALLOCATION_BIT |
-                          VMA_ALLOCATOR_CREATE_KHR_BIND_MEMORY2_BIT |
-                          VMA_ALLOCATOR_CREATE_KHR_MAINTENANCE4_BIT |
-                          VMA_ALLOCATOR_CREATE_EXT_MEMORY_BUDGET_BIT |
-                          VMA_ALLOCATOR_CREATE_BUFFER_DEVICE_ADDRESS_BIT |
-                          VMA_ALLOCATOR_CREATE_EXT_MEMORY_PRIORITY_BIT;
-    allocatorInfo.physicalDevice = *physicalDevice;
-    allocatorInfo.device = *d;
-    allocatorInfo.pVulkanFunctions = &vulkanFunctions;
-    allocatorInfo.instance = *instance;
-    allocatorInfo.vulkanApiVersion = ORPHEE_VK_VERSION;
-
-    VmaAllocator allocator{};
-    vmaCreateAllocator(&allocatorInfo, &allocator);
-
-    return Device{physicalDevice, d, qfs, qs, allocator};
+vk::raii::SurfaceKHR vkManager::createHeadlessSurface() const {
+  if (!settings.windowing || !settings.headless) {
+    throw std::runtime_error("Headless windowing is required");
   }
 
-  return {};
+  return instance.createHeadlessSurfaceEXT({});
 }
 
 vk::raii::Instance vkManager::createInstance() {
+  ORPHEE_ZONE("vkManager::createInstance");
   const auto vc = checkInstanceVersion(ORPHEE_VK_VERSION,
                                        context.enumerateInstanceVersion());
 
@@ -171,6 +571,19 @@ vk::raii::Instance vkManager::createInstance() {
     for (const auto &x : ORPHEE_REQUIRED_VK_INSTANCE_WINDOWING_EXTENSIONS) {
       extensions.push_back(x);
     }
+
+    if (settings.headless) {
+      extensions.push_back(VK_EXT_HEADLESS_SURFACE_EXTENSION_NAME);
+    } else {
+      if (settings.surfaceExtensions.empty()) {
+        spdlog::warn("Windowing without platform surface extensions");
+      }
+      for (const auto &x : settings.surfaceExtensions) {
+        if (!contains(extensions, x.c_str())) {
+          extensions.push_back(x.c_str());
+        }
+      }
+    }
   }
 
   const auto ec = checkInstanceExtensions(extensions);
@@ -178,6 +591,38 @@ vk::raii::Instance vkManager::createInstance() {
     throw std::runtime_error("Vulkan extensions mismatch");
   }
 
+  // validation features come with the layer, debug utils with the loader
+  std::vector<vk::ValidationFeatureEnableEXT> validation;
+  if (settings.profile != InstanceProfile::eRelease) {
+    const auto &probe = probes->instance(context);
+    const auto hasLayer = probe.hasLayer(ORPHEE_VK_VALIDATION_LAYER);
+    const auto hasDebugUtils =
+        probe.hasExtension(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+
+    if (!hasLayer || !hasDebugUtils) {
+      spdlog::warn("{} or {} is not available, falling back to the release "
+                   "profile",
+                   ORPHEE_VK_VALIDATION_LAYER,
+                   VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+      settings.profile = InstanceProfile::eRelease;
+    } else {
+      layers.push_back(ORPHEE_VK_VALIDATION_LAYER);
+      extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    }
+
+    if (settings.profile == InstanceProfile::eGpuAssisted) {
+      validation = {vk::ValidationFeatureEnableEXT::eGpuAssisted,
+                    vk::ValidationFeatureEnableEXT::
+                        eGpuAssistedReserveBindingSlot};
+    } else if (settings.profile == InstanceProfile::eSynchronization) {
+      validation = {vk::ValidationFeatureEnableEXT::eSynchronizationValidation};
+    }
+    if (!validation.empty()) {
+      extensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+    }
+  }
+  spdlog::info("Instance profile {}", profileName(settings.profile));
+
   vk::ApplicationInfo appInfo{
       meta.appName.c_str(),
       VK_MAKE_API_VERSION(0, meta.appVersionMajor, meta.appVersionMinor, 0),
@@ -185,17 +630,23 @@ vk::raii::Instance vkManager::createInstance() {
       VK_MAKE_API_VERSION(0, ORPHEE_VERSION_MAJOR, ORPHEE_VERSION_MINOR, 0),
       ORPHEE_VK_VERSION};
 
-  return context.createInstance({
-      {},
-      &appInfo,
-      layers,
-      extensions,
-  });
+  vk::InstanceCreateInfo instanceInfo{{}, &appInfo, layers, extensions};
+  // also reports instance creation and destruction
+  auto debugInfo = messengerInfo();
+  vk::ValidationFeaturesEXT validationFeatures{validation, {}};
+  if (settings.profile != InstanceProfile::eRelease) {
+    instanceInfo.pNext = &debugInfo;
+    if (!validation.empty()) {
+      debugInfo.pNext = &validationFeatures;
+    }
+  }
+
+  probes->save();
+
+  return context.createInstance(instanceInfo);
 }
 
 bool vkManager::checkInstanceVersion(uint32_t target, uint32_t instance) {
-  spdlog::info("Checking Vulkan version...");
-
   const auto targetMajor = VK_VERSION_MAJOR(target);
   const auto instanceMajor = VK_VERSION_MAJOR(instance);
 
@@ -211,29 +662,22 @@ bool vkManager::checkInstanceVersion(uint32_t target, uint32_t instance) {
     return false;
   }
 
-  spdlog::info("Intance vk {}.{} is compatible with requested vk {}.{}",
-               instanceMajor, instanceMinor, targetMajor, targetMinor);
+  spdlog::debug("Intance vk {}.{} is compatible with requested vk {}.{}",
+                instanceMajor, instanceMinor, targetMajor, targetMinor);
   return true;
 }
 
 bool vkManager::checkInstanceLayers(std::span<const char *> layers) const {
-  spdlog::info("Checking instance layers...");
-
-  const auto availableLayers = context.enumerateInstanceLayerProperties();
-  spdlog::info("Found {} available layers", availableLayers.size());
-
-  std::unordered_set<std::string> availableSet;
-  for (const auto &l : availableLayers) {
-    availableSet.insert(l.layerName);
-  }
+  const auto &probe = probes->instance(context);
+  spdlog::debug("Found {} available layers", probe.layers.size());
 
   bool foundAll = true;
   for (const auto &l : layers) {
-    if (availableSet.find(l) == availableSet.end()) {
+    if (!probe.hasLayer(l)) {
       spdlog::error("Layer {} is not available", l);
       foundAll = false;
     } else {
-      spdlog::info("Requested {} instance layer found", l);
+      spdlog::debug("Requested {} instance layer found", l);
     }
   }
 
@@ -242,24 +686,16 @@ bool vkManager::checkInstanceLayers(std::span<const char *> layers) const {
 
 bool vkManager::checkInstanceExtensions(
     std::span<const char *> extensions) const {
-  spdlog::info("Checking instance extensions...");
-
-  const auto availableExtensions =
-      context.enumerateInstanceExtensionProperties();
-  spdlog::info("Found {} available extensions", availableExtensions.size());
-
-  std::unordered_set<std::string> availableSet;
-  for (const auto &x : availableExtensions) {
-    availableSet.insert(x.extensionName);
-  }
+  const auto &probe = probes->instance(context);
+  spdlog::debug("Found {} available extensions", probe.extensions.size());
 
   bool foundAll = true;
   for (const auto &x : extensions) {
-    if (availableSet.find(x) == availableSet.end()) {
+    if (!probe.hasExtension(x)) {
       spdlog::error("Extension {} is not available", x);
       foundAll = false;
     } else {
-      spdlog::info("Requested {} instance extension found", x);
+      spdlog::debug("Requested {} instance extension found", x);
     }
   }
 
@@ -267,40 +703,42 @@ bool vkManager::checkInstanceExtensions(
 }
 
 bool vkManager::checkPhysicalDeviceExtensions(
-    const vk::PhysicalDevice &device, std::span<const char *> extensions) {
-  spdlog::info("Checking physical device extensions...");
-
-  const auto availableExtensions = device.enumerateDeviceExtensionProperties();
-  spdlog::info("Found {} available extensions", availableExtensions.size());
-
-  std::unordered_set<std::string> names;
-  for (const auto &ex : availableExtensions) {
-    names.insert(ex.extensionName);
-  }
-
+    const DeviceProbe &probe, std::span<const char *> extensions) {
   bool foundAll = true;
   for (const auto &x : extensions) {
-    if (names.find(x) == names.end()) {
-      spdlog::error("Extension {} is not available", x);
+    if (!probe.hasExtension(x)) {
+      // the decision table tells which devices miss some
+      spdlog::debug("Extension {} is not available", x);
       foundAll = false;
-    } else {
-      spdlog::info("Requested {} device extension found", x);
     }
   }
 
   return foundAll;
 }
 
+std::vector<const char *>
+vkManager::obtainOptionalExtensions(const DeviceProbe &probe,
+                                    std::span<const char *const> extensions) {
+  std::vector<const char *> supported;
+  for (const auto &x : extensions) {
+    if (probe.hasExtension(x)) {
+      spdlog::debug("Optional {} device extension available", x);
+      supported.push_back(x);
+    } else {
+      spdlog::debug("Optional {} device extension is not available", x);
+    }
+  }
+
+  return supported;
+}
+
 std::optional<uint32_t>
 vkManager::obtainQueueFamilies(const vk::PhysicalDevice &device,
+                               const DeviceProbe &probe,
                                const QueueFamilyRequirements &r) {
-  spdlog::info("Obtaining queue families...");
-
-  const auto availableQueueFamilies = device.getQueueFamilyProperties();
-  spdlog::info("Found {} queue families", availableQueueFamilies.size());
-
-  for (uint32_t i = 0; const auto &q : availableQueueFamilies) {
-    spdlog::info("Queue family {} queue count {}", i, q.queueCount);
+  for (uint32_t i = 0; i < probe.families.size(); ++i) {
+    const auto &q = probe.families[i];
+    spdlog::debug("Queue family {} queue count {}", i, q.queueCount);
 
     // check queue count
     if (r.count > q.queueCount) {
@@ -320,8 +758,6 @@ vkManager::obtainQueueFamilies(const vk::PhysicalDevice &device,
     }
 
     return i;
-
-    ++i;
   }
 
   return {};
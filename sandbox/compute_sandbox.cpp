@@ -1,11 +1,11 @@
 #include <iostream>
+#include <string>
 
 #include <ImfArray.h>
 #include <ImfRgbaFile.h>
 
 #include <orphee/orphee.hpp>
-
-#include "shader/util.hpp"
+#include <orphee/shaders.hpp>
 
 class ComputeSandbox {
 public:
@@ -35,34 +35,11 @@ public:
     vk::SemaphoreTypeCreateInfo semaphoreTypeInfo{vk::SemaphoreType::eTimeline,
                                                   0};
     timelineSemaphore = D.h.createSemaphore({{}, &semaphoreTypeInfo});
-    // Compute pipeline
-    /** CODE **/
-    auto code = shader::load("compute.spv");
-    auto computeModule = D.h.createShaderModule({{}, code});
-    vk::PipelineShaderStageCreateInfo computeStageInfo{
-        {}, vk::ShaderStageFlagBits::eCompute, computeModule, "main", {}};
-    /** CODE **/
-    /** args - inputs/outputs **/
-    /* descriptor set & push constants <-> IO */
-    vk::DescriptorSetLayoutBinding imageBinding{
-        0, vk::DescriptorType::eStorageImage, 1,
-        vk::ShaderStageFlagBits::eCompute};
-
-    auto computeDescriptorLayout =
-        D.h.createDescriptorSetLayout({{}, imageBinding});
-
-    computeLayout =
-        D.h.createPipelineLayout({{}, *computeDescriptorLayout, {}});
-    /** args - inputs/outputs **/
-    computePipeline = D.h.createComputePipeline(
-        nullptr, {{}, computeStageInfo, computeLayout, {}, {}});
-
-    vk::DescriptorPoolSize imageDescriptorPool{
-        vk::DescriptorType::eStorageImage, 1};
-
-    descriptorPool = D.h.createDescriptorPool(
-        {vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, 1,
-         imageDescriptorPool});
+    // Compute pipeline, its layout is reflected from the module
+    auto code = orphee::shaders::get("simple");
+    compute = orphee::ComputeKernel{D, code};
+
+    DA = std::make_unique<orphee::DescriptorAllocator>(D);
     /** RT **/
     vk::ImageCreateInfo imgInfo{{},
                                 vk::ImageType::e2D,
@@ -81,10 +58,7 @@ public:
                                 {},
                                 vk::ImageLayout::eUndefined};
 
-    VmaAllocationCreateInfo imageAllocCreateInfo{};
-    imageAllocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-
-    img = D.createImage(imgInfo, imageAllocCreateInfo);
+    img = D.createImage(imgInfo, orphee::ResourceClass::eRenderTarget);
 
     VmaAllocationCreateInfo bufferAllocCreateInfo{};
     bufferAllocCreateInfo.flags =
@@ -107,9 +81,7 @@ public:
                              {},
                              {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}});
 
-    computeDescriptorSet = std::move(
-        D.h.allocateDescriptorSets({descriptorPool, *computeDescriptorLayout})
-            .front());
+    computeDescriptorSet = DA->allocate(compute.setLayouts.at(0));
 
     vk::DescriptorImageInfo imageInfo{{}, imgView, vk::ImageLayout::eGeneral};
     vk::WriteDescriptorSet writeDescriptor{computeDescriptorSet,
@@ -120,6 +92,39 @@ public:
                                            {},
                                            {}};
     D.h.updateDescriptorSets(writeDescriptor, {});
+    /* autotuning, variants share the reflected layout */
+    orphee::Autotuner tuner{D, *Q};
+    const auto spec = tuner.tune(
+        "compute-" + std::to_string(imageWidth) + "x" +
+            std::to_string(imageHeight),
+        orphee::localSizeCandidates(D, compute.reflection, 2),
+        [&](const orphee::Specialization &s) {
+          return orphee::ComputeKernel{D, code, s};
+        },
+        [this](const vk::raii::CommandBuffer &cmd,
+               const orphee::ComputeKernel &kernel) {
+          vk::ImageMemoryBarrier2 toGeneral{
+              vk::PipelineStageFlagBits2::eNone,
+              vk::AccessFlagBits2::eNone,
+              vk::PipelineStageFlagBits2::eComputeShader,
+              vk::AccessFlagBits2::eShaderStorageWrite,
+              vk::ImageLayout::eUndefined,
+              vk::ImageLayout::eGeneral,
+              Q->fIdx,
+              Q->fIdx,
+              img.h,
+              vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0,
+                                        vk::RemainingMipLevels, 0,
+                                        vk::RemainingArrayLayers}};
+          cmd.pipelineBarrier2({{}, {}, {}, toGeneral});
+
+          cmd.bindPipeline(vk::PipelineBindPoint::eCompute, *kernel.pipeline);
+          cmd.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                 kernel.layout, 0, computeDescriptorSet, {});
+          const auto g = kernel.groups(img.extent.width, img.extent.height);
+          cmd.dispatch(g[0], g[1], g[2]);
+        });
+    compute = orphee::ComputeKernel{D, code, spec};
   }
 
   ~ComputeSandbox() { D.h.waitIdle(); }
@@ -127,9 +132,9 @@ public:
   void run() {
     CMD.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
 
-    CMD.bindPipeline(vk::PipelineBindPoint::eCompute, *computePipeline);
-    CMD.bindDescriptorSets(vk::PipelineBindPoint::eCompute, computeLayout, 0,
-                           *computeDescriptorSet, {});
+    CMD.bindPipeline(vk::PipelineBindPoint::eCompute, *compute.pipeline);
+    CMD.bindDescriptorSets(vk::PipelineBindPoint::eCompute, compute.layout, 0,
+                           computeDescriptorSet, {});
 
     vk::ImageMemoryBarrier2 toComputeBarrier{
         vk::PipelineStageFlagBits2::eNone,
@@ -146,8 +151,8 @@ public:
                                   vk::RemainingArrayLayers}};
     vk::DependencyInfo toComputeInfo{{}, {}, {}, toComputeBarrier};
     CMD.pipelineBarrier2(toComputeInfo);
-    CMD.dispatch(std::ceil(img.extent.width / 16.0),
-                 std::ceil(img.extent.height / 16.0), 1);
+    const auto groups = compute.groups(img.extent.width, img.extent.height);
+    CMD.dispatch(groups[0], groups[1], groups[2]);
 
     vk::ImageMemoryBarrier2 toCopyBarrierSrc{
         vk::PipelineStageFlagBits2::eComputeShader,
@@ -225,11 +230,10 @@ private:
   /* SYNC */
   vk::raii::Semaphore timelineSemaphore{nullptr};
   /* Compute */
-  vk::raii::PipelineLayout computeLayout{nullptr};
-  vk::raii::Pipeline computePipeline{nullptr};
+  orphee::ComputeKernel compute{nullptr};
   /* CMD STATE */
-  vk::raii::DescriptorPool descriptorPool{nullptr};
-  vk::raii::DescriptorSet computeDescriptorSet{nullptr};
+  std::unique_ptr<orphee::DescriptorAllocator> DA;
+  vk::DescriptorSet computeDescriptorSet{};
   /* Compute RT */
   orphee::vmaImage img{nullptr};
   vk::raii::ImageView imgView{nullptr};
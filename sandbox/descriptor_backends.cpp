@@ -0,0 +1,271 @@
+#include <array>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <orphee/orphee.hpp>
+#include <orphee/shaders.hpp>
+
+constexpr uint32_t GROUP_SIZE = 64;
+
+struct Result {
+  std::string backend;
+  double frameMicroseconds;
+  double setMicroseconds;
+};
+
+// Writes and binds one storage buffer set per dispatch, through a single
+// descriptor pool, the growable descriptor allocator and
+// VK_EXT_descriptor_buffer, and reports the CPU time spent writing
+// descriptors and recording.
+class DescriptorBackends {
+public:
+  DescriptorBackends(uint32_t sets, uint32_t iterations)
+      : mSets{sets}, mIterations{iterations} {
+    // Vulkan
+    VK = orphee::vkManager{{
+        .windowing = false,
+        .descriptors = orphee::DescriptorBackend::eBuffer,
+    }};
+
+    auto dR = VK.createDevice({
+        .tag = "main",
+        .count = 1,
+        .capabilities = {vk::QueueFlagBits::eCompute},
+    });
+    if (!dR) {
+      throw std::runtime_error("Failed to create device");
+    }
+    D = std::move(*dR);
+
+    Q = D.queues.at("main0").get();
+    // CMD
+    CP = D.h.createCommandPool(
+        {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, Q->fIdx});
+
+    CMD = std::move(
+        D.h.allocateCommandBuffers({CP, vk::CommandBufferLevel::ePrimary, 1})
+            .front());
+    // SYNC
+    vk::SemaphoreTypeCreateInfo semaphoreTypeInfo{vk::SemaphoreType::eTimeline,
+                                                  0};
+    timelineSemaphore = D.h.createSemaphore({{}, &semaphoreTypeInfo});
+    // counters
+    vk::BufferCreateInfo countersInfo{
+        {},
+        mSets * GROUP_SIZE * sizeof(uint32_t),
+        vk::BufferUsageFlagBits::eStorageBuffer |
+            vk::BufferUsageFlagBits::eShaderDeviceAddress,
+        vk::SharingMode::eExclusive,
+        {}};
+    counters =
+        D.createBuffer(countersInfo, orphee::ResourceClass::eStreaming);
+
+    const auto code = orphee::shaders::get("descriptorBench");
+    const auto module = D.h.createShaderModule({{}, code});
+    vk::PipelineShaderStageCreateInfo stageInfo{
+        {}, vk::ShaderStageFlagBits::eCompute, *module, "main", {}};
+
+    vk::DescriptorSetLayoutBinding countersBinding{
+        0, vk::DescriptorType::eStorageBuffer, 1,
+        vk::ShaderStageFlagBits::eCompute};
+    /* pool backend */
+    poolSetLayout = D.descriptorSetLayout({{}, countersBinding});
+    poolLayout = D.pipelineLayout({{}, poolSetLayout});
+    poolPipeline = D.h.createComputePipeline(
+        nullptr, {{}, stageInfo, poolLayout, {}, {}});
+
+    vk::DescriptorPoolSize poolSize{vk::DescriptorType::eStorageBuffer, mSets};
+    DP = D.h.createDescriptorPool({{}, mSets, poolSize});
+    /* allocator backend, starts small and grows */
+    DA = std::make_unique<orphee::DescriptorAllocator>(
+        D, orphee::DescriptorAllocatorSettings{
+               .setsPerPool = 16,
+               .ratios = {{vk::DescriptorType::eStorageBuffer, 1.0F}}});
+    /* buffer backend */
+    if (D.descriptorBackend == orphee::DescriptorBackend::eBuffer) {
+      bufferSetLayout = D.descriptorSetLayout(
+          {vk::DescriptorSetLayoutCreateFlagBits::eDescriptorBufferEXT,
+           countersBinding});
+      bufferLayout = D.pipelineLayout({{}, bufferSetLayout});
+      bufferPipeline = D.h.createComputePipeline(
+          nullptr, {vk::PipelineCreateFlagBits::eDescriptorBufferEXT,
+                    stageInfo, bufferLayout, {}, {}});
+
+      DB = orphee::DescriptorBuffer{D, bufferSetLayout, 1, mSets};
+    }
+  }
+
+  ~DescriptorBackends() { D.h.waitIdle(); }
+
+  [[nodiscard]] bool hasDescriptorBuffer() const {
+    return D.descriptorBackend == orphee::DescriptorBackend::eBuffer;
+  }
+
+  Result runPool() {
+    const vk::DeviceSize slice = GROUP_SIZE * sizeof(uint32_t);
+    const std::vector<vk::DescriptorSetLayout> layouts(mSets, poolSetLayout);
+    std::vector<vk::DescriptorBufferInfo> bufferInfos(mSets);
+    std::vector<vk::WriteDescriptorSet> writes(mSets);
+    std::vector<vk::DescriptorSet> sets;
+    sets.reserve(mSets);
+
+    return measure("pool", [&] {
+      DP.reset();
+      // the pool reset frees the sets
+      sets.clear();
+      for (auto &s : D.h.allocateDescriptorSets({*DP, layouts})) {
+        sets.push_back(s.release());
+      }
+
+      for (uint32_t i = 0; i < mSets; ++i) {
+        bufferInfos[i] = vk::DescriptorBufferInfo{counters.h, i * slice, slice};
+        writes[i] = vk::WriteDescriptorSet{
+            sets[i], 0, 0, vk::DescriptorType::eStorageBuffer, {},
+            bufferInfos[i]};
+      }
+      D.h.updateDescriptorSets(writes, {});
+
+      CMD.bindPipeline(vk::PipelineBindPoint::eCompute, *poolPipeline);
+      for (uint32_t i = 0; i < mSets; ++i) {
+        CMD.bindDescriptorSets(vk::PipelineBindPoint::eCompute, poolLayout, 0,
+                               sets[i], {});
+        CMD.dispatch(1, 1, 1);
+      }
+    });
+  }
+
+  Result runAllocator() {
+    const vk::DeviceSize slice = GROUP_SIZE * sizeof(uint32_t);
+    std::vector<vk::DescriptorBufferInfo> bufferInfos(mSets);
+    std::vector<vk::WriteDescriptorSet> writes(mSets);
+    std::vector<vk::DescriptorSet> sets(mSets);
+
+    return measure("allocator", [&] {
+      DA->reset();
+      for (uint32_t i = 0; i < mSets; ++i) {
+        sets[i] = DA->allocate(poolSetLayout);
+        bufferInfos[i] = vk::DescriptorBufferInfo{counters.h, i * slice, slice};
+        writes[i] = vk::WriteDescriptorSet{
+            sets[i], 0, 0, vk::DescriptorType::eStorageBuffer, {},
+            bufferInfos[i]};
+      }
+      D.h.updateDescriptorSets(writes, {});
+
+      CMD.bindPipeline(vk::PipelineBindPoint::eCompute, *poolPipeline);
+      for (uint32_t i = 0; i < mSets; ++i) {
+        CMD.bindDescriptorSets(vk::PipelineBindPoint::eCompute, poolLayout, 0,
+                               sets[i], {});
+        CMD.dispatch(1, 1, 1);
+      }
+    });
+  }
+
+  Result runBuffer() {
+    const vk::DeviceSize slice = GROUP_SIZE * sizeof(uint32_t);
+
+    return measure("buffer", [&] {
+      DB.reset();
+      for (uint32_t i = 0; i < mSets; ++i) {
+        const auto set = DB.allocate();
+        DB.writeStorageBuffer(set, 0, counters.address + i * slice, slice);
+      }
+
+      CMD.bindPipeline(vk::PipelineBindPoint::eCompute, *bufferPipeline);
+      DB.bindBuffer(CMD);
+      for (uint32_t i = 0; i < mSets; ++i) {
+        DB.bind(CMD, vk::PipelineBindPoint::eCompute, bufferLayout, 0, i);
+        CMD.dispatch(1, 1, 1);
+      }
+    });
+  }
+
+private:
+  template <typename Record> Result measure(std::string name, Record record) {
+    double seconds = 0.0;
+    for (uint32_t it = 0; it < mIterations; ++it) {
+      CMD.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+      const auto start = std::chrono::steady_clock::now();
+      record();
+      const auto end = std::chrono::steady_clock::now();
+      seconds += std::chrono::duration<double>(end - start).count();
+
+      CMD.end();
+
+      vk::CommandBufferSubmitInfo cmdSubmit{*CMD};
+      vk::SemaphoreSubmitInfo signalSemaphore{timelineSemaphore, ++timeline,
+                                              {}, {}};
+      vk::SubmitInfo2 info{{}, {}, cmdSubmit, signalSemaphore};
+      Q->h.submit2(info);
+
+      std::array<uint64_t, 1> waitValue{timeline};
+      const auto wR =
+          D.h.waitSemaphores({{}, *timelineSemaphore, waitValue}, UINT64_MAX);
+      if (wR != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to wait for semaphore");
+      }
+    }
+
+    const auto frame = seconds / mIterations * 1e6;
+    return {std::move(name), frame, frame / mSets};
+  }
+
+  uint32_t mSets;
+  uint32_t mIterations;
+  // Vulkan
+  orphee::vkManager VK;
+  orphee::Device D;
+  orphee::Queue *Q;
+  /* CMD */
+  vk::raii::CommandPool CP{nullptr};
+  vk::raii::CommandBuffer CMD{nullptr};
+  /* SYNC */
+  vk::raii::Semaphore timelineSemaphore{nullptr};
+  uint64_t timeline = 0;
+  /* counters */
+  orphee::vmaBuffer counters{nullptr};
+  /* pool backend */
+  vk::DescriptorSetLayout poolSetLayout{};
+  vk::PipelineLayout poolLayout{};
+  vk::raii::Pipeline poolPipeline{nullptr};
+  vk::raii::DescriptorPool DP{nullptr};
+  /* allocator backend */
+  std::unique_ptr<orphee::DescriptorAllocator> DA;
+  /* buffer backend */
+  vk::DescriptorSetLayout bufferSetLayout{};
+  vk::PipelineLayout bufferLayout{};
+  vk::raii::Pipeline bufferPipeline{nullptr};
+  orphee::DescriptorBuffer DB{nullptr};
+};
+
+int main(int argc, char **argv) {
+  if (argc > 3) {
+    std::cerr << "Usage: " << argv[0] << " [sets] [iterations]\n";
+    return 1;
+  }
+
+  const uint32_t sets = argc > 1 ? std::stoul(argv[1]) : 1024;
+  const uint32_t iterations = argc > 2 ? std::stoul(argv[2]) : 64;
+
+  try {
+    DescriptorBackends bench{sets, iterations};
+
+    std::vector<Result> results{bench.runPool(), bench.runAllocator()};
+    if (bench.hasDescriptorBuffer()) {
+      results.push_back(bench.runBuffer());
+    } else {
+      std::cout << "VK_EXT_descriptor_buffer is not available\n";
+    }
+
+    for (const auto &r : results) {
+      std::cout << r.backend << ": " << r.frameMicroseconds << " us per frame, "
+                << r.setMicroseconds << " us per set (" << sets << " sets)\n";
+    }
+  } catch (const std::exception &e) {
+    std::cout << e.what() << std::endl;
+  }
+
+  return 0;
+}
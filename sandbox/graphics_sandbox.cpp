@@ -1,35 +1,31 @@
-#include <filesystem>
 #include <iostream>
 
 #include <SDL.h>
-#include <SDL_vulkan.h>
 
 #include <orphee/orphee.hpp>
+#include <orphee/shaders.hpp>
 
-#include "shader/util.hpp"
+#include "presentation.hpp"
 
 class GraphicsSandbox {
 public:
-  GraphicsSandbox(uint32_t iWidth, uint32_t iHeight) {
+  GraphicsSandbox(const presentation::Options &options, uint32_t iWidth,
+                  uint32_t iHeight)
+      : mOptions{options} {
     // SDL
-    SDL_Init(SDL_INIT_VIDEO);
-    mWindow = SDL_CreateWindow(mName.c_str(), SDL_WINDOWPOS_UNDEFINED,
-                               SDL_WINDOWPOS_UNDEFINED, iWidth, iHeight,
-                               SDL_WINDOW_VULKAN | SDL_WINDOW_ALLOW_HIGHDPI |
-                                   SDL_WINDOW_SHOWN);
+    mWindow = presentation::createWindow(mOptions, mName, iWidth, iHeight);
 
     // Vulkan
-    VK = orphee::vkManager{{.windowing = true}};
+    VK = orphee::vkManager{
+        presentation::settings(mWindow, {.shaderObjects = true})};
 
-    VkSurfaceKHR surface{};
-    SDL_Vulkan_CreateSurface(mWindow, *VK.instance, &surface);
-    S = vk::raii::SurfaceKHR{VK.instance, surface};
+    S = presentation::createSurface(VK, mWindow);
 
     auto dR = VK.createDevice({
         .tag = "main",
         .count = 1,
         .capabilities = {vk::QueueFlagBits::eGraphics},
-        .surface = surface,
+        .surface = *S,
     });
     if (!dR) {
       throw std::runtime_error("Failed to create device");
@@ -39,11 +35,8 @@ public:
     Q = D.queues.at("main0").get();
 
     uint32_t minInageCount = 2;
-    int dw{};
-    int dh{};
-    SDL_Vulkan_GetDrawableSize(mWindow, &dw, &dh);
-    vk::Extent2D swapchainExtent{static_cast<uint32_t>(dw),
-                                 static_cast<uint32_t>(dh)};
+    const auto swapchainExtent =
+        presentation::extent(mWindow, iWidth, iHeight);
     vk::Format swapchainFormat{vk::Format::eB8G8R8A8Unorm};
     vk::SwapchainCreateInfoKHR swapchainInfo{
         {},
@@ -83,86 +76,26 @@ public:
                            swapchainFormat, swapchainExtent};
 
     /** Graphics **/
-    /* vertex shader */
-    auto vertexCode = shader::load(std::filesystem::path{"vertex.spv"});
-    auto vertexModule = D.h.createShaderModule({{}, vertexCode});
-    /* fragment shader */
-    auto fragmentCode = shader::load(std::filesystem::path{"fragment.spv"});
-    auto fragmentModule = D.h.createShaderModule({{}, fragmentCode});
-    /* shader modules */
-    std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages{
-        vk::PipelineShaderStageCreateInfo{
-            {}, vk::ShaderStageFlagBits::eVertex, vertexModule, "main", {}},
-        vk::PipelineShaderStageCreateInfo{
-            {}, vk::ShaderStageFlagBits::eFragment, fragmentModule, "main", {}},
-    };
-    /* vertex input */
-    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{{}, {}, {}};
-    /* input assembly */
-    vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo{
-        {}, vk::PrimitiveTopology::eTriangleList, VK_FALSE};
-    /* viewport */
-    vk::PipelineViewportStateCreateInfo viewportInfo{{}, 1, {}, 1, {}};
-    /* rasterization  */
-    vk::PipelineRasterizationStateCreateInfo rasterizationInfo{
-        {},
-        vk::False,
-        vk::False,
-        vk::PolygonMode::eFill,
-        vk::CullModeFlagBits::eBack,
-        vk::FrontFace::eClockwise,
-        vk::False,
-        0.0F,
-        0.0F,
-        0.0F,
-        1.0F};
-    /* sampling */
-    vk::PipelineMultisampleStateCreateInfo multisampleInfo{
-        {}, vk::SampleCountFlagBits::e1, vk::False, 1.0F, {}, {}, {}};
-    /* color blending */
-    vk::PipelineColorBlendAttachmentState colorBlendAttachment{
-        vk::False,
-        vk::BlendFactor::eOne,
-        vk::BlendFactor::eZero,
-        vk::BlendOp::eAdd,
-        vk::BlendFactor::eOne,
-        vk::BlendFactor::eZero,
-        vk::BlendOp::eAdd,
-        vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-            vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA};
-
-    vk::PipelineColorBlendStateCreateInfo colorBlendInfo{
-        {}, vk::False, vk::LogicOp::eCopy, colorBlendAttachment, {}};
-    /* dynamic state */
-    std::array<vk::DynamicState, 2> dynamicStates{vk::DynamicState::eViewport,
-                                                  vk::DynamicState::eScissor};
-    vk::PipelineDynamicStateCreateInfo dynamicStateInfo{{}, dynamicStates};
     /* pipeline layout */
     vk::PipelineLayoutCreateInfo pipelineLayoutInfo{{}, {}, {}};
-    graphicsLayout = D.h.createPipelineLayout(pipelineLayoutInfo);
-    /* dynamic rendering */
-    vk::Format colorFormat{vk::Format::eB8G8R8A8Unorm};
-    vk::PipelineRenderingCreateInfo renderingInfo{{}, colorFormat, {}, {}};
-    /* graphics pipeline creation */
-    vk::GraphicsPipelineCreateInfo graphicsInfo{{},
-                                                shaderStages,
-                                                &vertexInputInfo,
-                                                &inputAssemblyInfo,
-                                                {},
-                                                &viewportInfo,
-                                                &rasterizationInfo,
-                                                &multisampleInfo,
-                                                {},
-                                                &colorBlendInfo,
-                                                &dynamicStateInfo,
-                                                graphicsLayout,
-                                                {},
-                                                {},
-                                                {},
-                                                {},
-                                                &renderingInfo};
-
-    graphicsPipeline = D.h.createGraphicsPipeline(nullptr, graphicsInfo);
+    graphicsLayout = D.pipelineLayout(pipelineLayoutInfo);
+    const auto vertexCode = orphee::shaders::get("simpleVertex");
+    const auto fragmentCode = orphee::shaders::get("simpleFragment");
+    shaderObjects = D.capabilities.shaderObjects;
+    if (shaderObjects) {
+      /* shader objects */
+      triangleShaders = orphee::GraphicsShaders{D, vertexCode, fragmentCode};
+    } else {
+      /* graphics pipeline */
+      PC = std::make_unique<orphee::PipelineCompiler>(D);
+      graphicsPipeline = PC->compile(orphee::GraphicsPipelineDesc{
+          .vertexCode = {vertexCode.begin(), vertexCode.end()},
+          .fragmentCode = {fragmentCode.begin(), fragmentCode.end()},
+          .layout = graphicsLayout,
+          .frontFace = vk::FrontFace::eClockwise,
+          .colorFormats = {vk::Format::eB8G8R8A8Unorm},
+      });
+    }
 
     CP = D.h.createCommandPool(
         {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, Q->fIdx});
@@ -179,11 +112,11 @@ public:
   ~GraphicsSandbox() {
     D.h.waitIdle();
     // SDL
-    SDL_DestroyWindow(mWindow);
-    SDL_Quit();
+    presentation::destroyWindow(mWindow);
   }
 
   void run() {
+    presentation::FrameClock clock{.frames = mOptions.frames};
     bool isRunning = true;
     while (isRunning) {
       SDL_Event event;
@@ -193,6 +126,11 @@ public:
         }
       }
 
+      // rethrows the compilation error instead of drawing empty frames
+      if (graphicsPipeline.failed()) {
+        graphicsPipeline.wait();
+      }
+
       const auto wfR = D.h.waitForFences(*DrawFence, vk::True, UINT64_MAX);
       if (wfR != vk::Result::eSuccess) {
         throw std::runtime_error("Failed to wait for fence");
@@ -243,18 +181,31 @@ public:
           {},
           {}};
       CMD.beginRendering(renderInfo);
-      CMD.bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
-      vk::Viewport viewport{0.0F,
-                            0.0F,
-                            static_cast<float>(SC.extent.width),
-                            static_cast<float>(SC.extent.height),
-                            0.0F,
-                            1.0F};
-      CMD.setViewport(0, viewport);
-
-      vk::Rect2D scissor{{0, 0}, SC.extent};
-      CMD.setScissor(0, scissor);
-      CMD.draw(3, 1, 0, 0);
+      bool drawable = true;
+      if (shaderObjects) {
+        triangleShaders.bind(CMD);
+        orphee::setRenderState(CMD, triangleState, SC.extent);
+      } else {
+        // the triangle is not drawn until its pipeline is compiled
+        const auto pipeline = graphicsPipeline.get();
+        drawable = static_cast<bool>(pipeline);
+        if (drawable) {
+          CMD.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+        }
+        vk::Viewport viewport{0.0F,
+                              0.0F,
+                              static_cast<float>(SC.extent.width),
+                              static_cast<float>(SC.extent.height),
+                              0.0F,
+                              1.0F};
+        CMD.setViewport(0, viewport);
+
+        vk::Rect2D scissor{{0, 0}, SC.extent};
+        CMD.setScissor(0, scissor);
+      }
+      if (drawable) {
+        CMD.draw(3, 1, 0, 0);
+      }
       CMD.endRendering();
 
       vk::ImageMemoryBarrier2 toPresentBarrier{
@@ -289,12 +240,18 @@ public:
       if (pR != vk::Result::eSuccess) {
         throw std::runtime_error("Failed to present image");
       }
+
+      if (clock.tick()) {
+        isRunning = false;
+      }
     }
+    clock.report();
   }
 
 private:
   // App
   std::string mName{"Graphics Sandbox"};
+  presentation::Options mOptions;
   // SDL
   SDL_Window *mWindow;
   // Vulkan
@@ -304,8 +261,12 @@ private:
   orphee::Swapchain SC;
   orphee::Queue *Q;
   // Graphics
-  vk::raii::PipelineLayout graphicsLayout{nullptr};
-  vk::raii::Pipeline graphicsPipeline{nullptr};
+  vk::PipelineLayout graphicsLayout{};
+  std::unique_ptr<orphee::PipelineCompiler> PC;
+  orphee::PipelineHandle graphicsPipeline{nullptr};
+  bool shaderObjects = false;
+  orphee::GraphicsShaders triangleShaders{nullptr};
+  orphee::RenderState triangleState{.frontFace = vk::FrontFace::eClockwise};
   // CMD
   vk::raii::CommandPool CP{nullptr};
   vk::raii::CommandBuffer CMD{nullptr};
@@ -317,7 +278,7 @@ private:
 
 int main(int argc, char **argv) {
   try {
-    GraphicsSandbox sandbox{1080U, 720U};
+    GraphicsSandbox sandbox{presentation::parse(argc, argv), 1080U, 720U};
     sandbox.run();
   } catch (const std::exception &e) {
     std::cout << e.what() << std::endl;
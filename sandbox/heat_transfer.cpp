@@ -1,49 +1,121 @@
 #include <array>
+#include <chrono>
+#include <future>
 #include <iostream>
+#include <optional>
 #include <random>
+#include <span>
+#include <string>
+#include <vector>
 
 #include <SDL.h>
-#include <SDL_vulkan.h>
 
 #include <backends/imgui_impl_sdl2.h>
 #include <backends/imgui_impl_vulkan.h>
 
 #include <orphee/orphee.hpp>
+#include <orphee/shaders.hpp>
+#include <orphee/ui/gpuProfiler.hpp>
 
-#include "shader/util.hpp"
+#include "presentation.hpp"
 
+// rows per invocation specialization constant of heatTransfer.comp
+constexpr uint32_t HT_ROWS = 2;
+
+// mirrors the push constants of heatTransfer and colorMapping
 struct TInfo {
   uint32_t width;
   uint32_t height;
-  float max_temp;
   float min_temp;
+  float max_temp;
+};
+
+struct HTArgs {
+  vk::DeviceAddress current;
+  vk::DeviceAddress target;
+  TInfo info;
+};
+
+struct CMArgs {
+  vk::DeviceAddress temperatures;
+  TInfo info;
+  orphee::BindlessHeap::Index image;
 };
 
+#ifdef ORPHEE_SHADER_COMPILER
+// Kernel rebuilt from reloaded code on a worker thread, the frame thread only
+// swaps it in once created and checked against Args. Failed rebuilds keep
+// the running kernel.
+template <typename Args> struct KernelReload {
+  KernelReload(const orphee::Device &d, const orphee::BindlessHeap &h,
+               const orphee::Specialization &s)
+      : device{&d}, heap{&h}, specialization{&s} {}
+
+  void start(std::span<const uint32_t> code) {
+    // the latest code is built once the current rebuild is done
+    if (pending.valid()) {
+      queued.emplace(code.begin(), code.end());
+      return;
+    }
+
+    pending = std::async(
+        std::launch::async,
+        [d = device, h = heap, s = *specialization,
+         spirv = std::vector<uint32_t>(code.begin(), code.end())] {
+          orphee::ComputeKernel kernel{*d, spirv, *h, s};
+          kernel.checkArgs<Args>();
+          return kernel;
+        });
+  }
+
+  // once no submitted work uses kernel
+  void swap(orphee::ComputeKernel &kernel) {
+    if (!pending.valid() || pending.wait_for(std::chrono::seconds{0}) !=
+                                std::future_status::ready) {
+      return;
+    }
+
+    try {
+      kernel = pending.get();
+    } catch (const std::exception &e) {
+      std::cout << "Kept the previous kernel: " << e.what() << std::endl;
+    }
+
+    if (queued) {
+      const auto code = std::move(*queued);
+      queued.reset();
+      start(code);
+    }
+  }
+
+  const orphee::Device *device;
+  const orphee::BindlessHeap *heap;
+  const orphee::Specialization *specialization;
+  std::future<orphee::ComputeKernel> pending;
+  std::optional<std::vector<uint32_t>> queued;
+};
+#endif
+
 class App {
 public:
-  App(uint32_t iWidth, uint32_t iHeight) {
+  App(const presentation::Options &options, uint32_t iWidth, uint32_t iHeight)
+      : mOptions{options} {
     // SDL
-    SDL_Init(SDL_INIT_VIDEO);
-    mWindow = SDL_CreateWindow(mName.c_str(), SDL_WINDOWPOS_UNDEFINED,
-                               SDL_WINDOWPOS_UNDEFINED, iWidth, iHeight,
-                               SDL_WINDOW_VULKAN | SDL_WINDOW_ALLOW_HIGHDPI |
-                                   SDL_WINDOW_SHOWN);
+    mWindow = presentation::createWindow(mOptions, mName, iWidth, iHeight);
 
     tInfo.width = iWidth;
     tInfo.height = iHeight;
 
     // Vulkan
-    VK = orphee::vkManager{{.windowing = true}};
+    VK = orphee::vkManager{presentation::settings(mWindow)};
 
-    VkSurfaceKHR surface{};
-    SDL_Vulkan_CreateSurface(mWindow, *VK.instance, &surface);
-    S = vk::raii::SurfaceKHR{VK.instance, surface};
+    S = presentation::createSurface(VK, mWindow);
 
     auto dR = VK.createDevice({
         .tag = "main",
         .count = 1,
         .capabilities = {vk::QueueFlagBits::eGraphics},
-        .surface = surface,
+        .surface = *S,
     });
     if (!dR) {
       throw std::runtime_error("Failed to create device");
@@ -53,11 +125,8 @@ public:
     Q = D.queues.at("main0").get();
 
     uint32_t minInageCount = 2;
-    int dw{};
-    int dh{};
-    SDL_Vulkan_GetDrawableSize(mWindow, &dw, &dh);
-    vk::Extent2D swapchainExtent{static_cast<uint32_t>(dw),
-                                 static_cast<uint32_t>(dh)};
+    const auto swapchainExtent =
+        presentation::extent(mWindow, iWidth, iHeight);
     vk::Format swapchainFormat{vk::Format::eR8G8B8A8Unorm};
     vk::SwapchainCreateInfoKHR swapchainInfo{
         {},
@@ -102,7 +171,13 @@ public:
     ImGuiIO &io = ImGui::GetIO();
     io.ConfigFlags |= ImGuiConfigFlags_NavEnableKeyboard;
 
-    ImGui_ImplSDL2_InitForVulkan(mWindow);
+    if (mWindow != nullptr) {
+      ImGui_ImplSDL2_InitForVulkan(mWindow);
+    } else {
+      // no platform backend, the UI is still built and rendered
+      io.DisplaySize = ImVec2{static_cast<float>(swapchainExtent.width),
+                              static_cast<float>(swapchainExtent.height)};
+    }
     ImGui::StyleColorsDark();
 
     vk::DescriptorPoolSize poolSize{vk::DescriptorType::eCombinedImageSampler,
@@ -137,70 +212,36 @@ public:
     DrawFence = D.h.createFence({vk::FenceCreateFlagBits::eSignaled});
     ImageAvailable = D.h.createSemaphore({});
     RenderFinished = D.h.createSemaphore({});
+    GP = std::make_unique<orphee::GpuProfiler>(D, *Q);
+    /* bindless heap */
+    BH = orphee::BindlessHeap{D};
+#ifdef ORPHEE_SHADER_COMPILER
+    SCC = std::make_unique<orphee::ShaderCompiler>(
+        orphee::ShaderCompilerSettings{.sourceDir = ORPHEE_SHADER_DIR});
+    /* heat transfer */
+    auto code = SCC->compile("heatTransfer.comp.glsl");
+    heatTransfer = orphee::ComputeKernel{D, code, BH};
+    heatTransfer.checkArgs<HTArgs>();
+    htReload = std::make_unique<KernelReload<HTArgs>>(D, BH, htSpec);
+    SCC->watch("heatTransfer.comp.glsl", {},
+               [this](std::span<const uint32_t> c) { htReload->start(c); });
+    /* color mapping  */
+    auto cmCode = SCC->compile("colorMapping.comp.glsl");
+    colorMapping = orphee::ComputeKernel{D, cmCode, BH};
+    colorMapping.checkArgs<CMArgs>();
+    cmReload = std::make_unique<KernelReload<CMArgs>>(D, BH, cmSpec);
+    SCC->watch("colorMapping.comp.glsl", {},
+               [this](std::span<const uint32_t> c) { cmReload->start(c); });
+#else
     /* heat transfer */
-    /* code */
-    auto code = shader::load("heatTransfer.spv");
-    auto computeModule = D.h.createShaderModule({{}, code});
-    vk::PipelineShaderStageCreateInfo htComputeStageInfo{
-        {}, vk::ShaderStageFlagBits::eCompute, computeModule, "main", {}};
-    /* args */
-    vk::DescriptorSetLayoutBinding htBufferCurrent{
-        0, vk::DescriptorType::eStorageBuffer, 1,
-        vk::ShaderStageFlagBits::eCompute};
-    vk::DescriptorSetLayoutBinding htBufferTarget{
-        1, vk::DescriptorType::eStorageBuffer, 1,
-        vk::ShaderStageFlagBits::eCompute};
-
-    std::array<vk::DescriptorSetLayoutBinding, 2> htBindings{htBufferCurrent,
-                                                             htBufferTarget};
-
-    htArgsLayout = D.h.createDescriptorSetLayout({{}, htBindings});
-
-    vk::PushConstantRange htPC{vk::ShaderStageFlagBits::eCompute, 0,
-                               sizeof(TInfo)};
-
-    htLayout = D.h.createPipelineLayout({{}, *htArgsLayout, htPC});
-    /****/
-    heatTransfer = D.h.createComputePipeline(
-        nullptr, {{}, htComputeStageInfo, htLayout, {}, {}});
+    auto code = orphee::shaders::get("heatTransfer");
+    heatTransfer = orphee::ComputeKernel{D, code, BH};
+    heatTransfer.checkArgs<HTArgs>();
     /* color mapping  */
-    /* code */
-    auto cmCode = shader::load("colorMapping.spv");
-    auto cmModule = D.h.createShaderModule({{}, cmCode});
-    vk::PipelineShaderStageCreateInfo cmComputeStageInfo{
-        {}, vk::ShaderStageFlagBits::eCompute, cmModule, "main", {}};
-    /* args */
-    vk::DescriptorSetLayoutBinding cmBufferBinding{
-        0, vk::DescriptorType::eStorageBuffer, 1,
-        vk::ShaderStageFlagBits::eCompute};
-
-    vk::DescriptorSetLayoutBinding cmImageBinding{
-        1, vk::DescriptorType::eStorageImage, 1,
-        vk::ShaderStageFlagBits::eCompute};
-
-    std::vector<vk::DescriptorSetLayoutBinding> cmBindings{cmBufferBinding,
-                                                           cmImageBinding};
-
-    cmArgsLayout = D.h.createDescriptorSetLayout({{}, cmBindings});
-
-    vk::PushConstantRange cmPC{vk::ShaderStageFlagBits::eCompute, 0,
-                               sizeof(TInfo)};
-
-    cmLayout = D.h.createPipelineLayout({{}, *cmArgsLayout, cmPC});
-    /****/
-    colorMapping = D.h.createComputePipeline(
-        nullptr, {{}, cmComputeStageInfo, cmLayout, {}, {}});
-    /* descriptor pool */
-    std::vector<vk::DescriptorPoolSize> poolSizes{
-        {vk::DescriptorType::eStorageBuffer, 3},
-        {vk::DescriptorType::eStorageImage, 1}};
-    DP = D.h.createDescriptorPool(
-        {vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, 2, poolSizes});
-    /* descriptor set allocation */
-    htArgs =
-        std::move(D.h.allocateDescriptorSets({*DP, *htArgsLayout}).front());
-    cmArgs =
-        std::move(D.h.allocateDescriptorSets({*DP, *cmArgsLayout}).front());
+    auto cmCode = orphee::shaders::get("colorMapping");
+    colorMapping = orphee::ComputeKernel{D, cmCode, BH};
+    colorMapping.checkArgs<CMArgs>();
+#endif
     /* RT*/
     vk::BufferCreateInfo TReferenceBufferInfo{
         {},
@@ -211,10 +252,10 @@ public:
         vk::SharingMode::eExclusive,
         {}};
 
-    VmaAllocationCreateInfo TReferenceAllocInfo{};
-    TReferenceAllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-
-    Treference = D.createBuffer(TReferenceBufferInfo, TReferenceAllocInfo);
+    // movable ones are defragmented
+    Treference =
+        D.createBuffer(TReferenceBufferInfo, orphee::ResourceClass::eSimState,
+                       orphee::Placement::eMovable);
 
     vk::BufferCreateInfo TstagingBufferInfo{
         {},
@@ -224,24 +265,22 @@ public:
         vk::SharingMode::eExclusive,
         {}};
 
-    VmaAllocationCreateInfo TStagingAllocInfo{};
-    TStagingAllocInfo.flags =
-        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-    TStagingAllocInfo.usage = VMA_MEMORY_USAGE_AUTO;
-
-    Tstaging = D.createBuffer(TstagingBufferInfo, TStagingAllocInfo);
+    Tstaging =
+        D.createBuffer(TstagingBufferInfo, orphee::ResourceClass::eStaging);
 
-    vk::BufferCreateInfo TbufferInfo{{},
-                                     iWidth * iHeight * sizeof(float),
-                                     vk::BufferUsageFlagBits::eStorageBuffer |
-                                         vk::BufferUsageFlagBits::eTransferDst,
-                                     vk::SharingMode::eExclusive,
-                                     {}};
-    VmaAllocationCreateInfo vbAllocateInfo{};
-    vbAllocateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-
-    T[0] = D.createBuffer(TbufferInfo, vbAllocateInfo);
-    T[1] = D.createBuffer(TbufferInfo, vbAllocateInfo);
+    vk::BufferCreateInfo TbufferInfo{
+        {},
+        iWidth * iHeight * sizeof(float),
+        vk::BufferUsageFlagBits::eStorageBuffer |
+            vk::BufferUsageFlagBits::eTransferSrc |
+            vk::BufferUsageFlagBits::eTransferDst |
+            vk::BufferUsageFlagBits::eShaderDeviceAddress,
+        vk::SharingMode::eExclusive,
+        {}};
+    T[0] = D.createBuffer(TbufferInfo, orphee::ResourceClass::eSimState,
+                          orphee::Placement::eMovable);
+    T[1] = D.createBuffer(TbufferInfo, orphee::ResourceClass::eSimState,
+                          orphee::Placement::eMovable);
 
     vk::ImageCreateInfo imgInfo{{},
                                 vk::ImageType::e2D,
@@ -260,10 +299,8 @@ public:
                                 {},
                                 vk::ImageLayout::eUndefined};
 
-    VmaAllocationCreateInfo imageAllocCreateInfo{};
-    imageAllocCreateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-
-    targetImg = D.createImage(imgInfo, imageAllocCreateInfo);
+    targetImg = D.createImage(imgInfo, orphee::ResourceClass::eRenderTarget,
+                              orphee::Placement::eMovable);
 
     targetImgView =
         D.h.createImageView({{},
@@ -272,6 +309,75 @@ public:
                              vk::Format::eR8G8B8A8Unorm,
                              {},
                              {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}});
+    /* defragmentation */
+    DF = std::make_unique<orphee::Defragmenter>(D, *Q);
+    DF->track(Treference, TReferenceBufferInfo);
+    DF->track(T[0], TbufferInfo);
+    DF->track(T[1], TbufferInfo);
+    // the color mapped image is rewritten every frame
+    DF->track(targetImg, imgInfo, vk::ImageLayout::eUndefined, [this] {
+      targetImgView = D.h.createImageView(
+          {{},
+           targetImg.h,
+           vk::ImageViewType::e2D,
+           vk::Format::eR8G8B8A8Unorm,
+           {},
+           {vk::ImageAspectFlagBits::eColor, 0, 1, 0, 1}});
+      BH.setStorageImage(targetImgIdx, targetImgView);
+    });
+    targetImgIdx = BH.addStorageImage(targetImgView);
+    /* autotuning, the buffers hold no data yet */
+    orphee::Autotuner tuner{D, *Q};
+    const auto size =
+        std::to_string(tInfo.width) + "x" + std::to_string(tInfo.height);
+
+    const std::array<uint32_t, 3> rows{1, 2, 4};
+    htSpec = tuner.tune(
+        "heatTransfer-" + size,
+        orphee::expand(
+            orphee::localSizeCandidates(D, heatTransfer.reflection, 2),
+            HT_ROWS, rows),
+        [&](const orphee::Specialization &s) {
+          return orphee::ComputeKernel{D, code, BH, s};
+        },
+        [this](const vk::raii::CommandBuffer &cmd,
+               const orphee::ComputeKernel &kernel) {
+          BH.bind(cmd, vk::PipelineBindPoint::eCompute);
+          const HTArgs args{T[0].address, T[1].address, tInfo};
+          const auto g = htGroups(kernel);
+          kernel.dispatch(cmd, args, g[0], g[1]);
+        });
+    heatTransfer = orphee::ComputeKernel{D, code, BH, htSpec};
+
+    cmSpec = tuner.tune(
+        "colorMapping-" + size,
+        orphee::localSizeCandidates(D, colorMapping.reflection, 2),
+        [&](const orphee::Specialization &s) {
+          return orphee::ComputeKernel{D, cmCode, BH, s};
+        },
+        [this](const vk::raii::CommandBuffer &cmd,
+               const orphee::ComputeKernel &kernel) {
+          vk::ImageMemoryBarrier2 toGeneral{
+              vk::PipelineStageFlagBits2::eNone,
+              vk::AccessFlagBits2::eNone,
+              vk::PipelineStageFlagBits2::eComputeShader,
+              vk::AccessFlagBits2::eShaderWrite,
+              vk::ImageLayout::eUndefined,
+              vk::ImageLayout::eGeneral,
+              Q->fIdx,
+              Q->fIdx,
+              targetImg.h,
+              vk::ImageSubresourceRange{vk::ImageAspectFlagBits::eColor, 0,
+                                        vk::RemainingMipLevels, 0,
+                                        vk::RemainingArrayLayers}};
+          cmd.pipelineBarrier2({{}, {}, {}, toGeneral});
+
+          BH.bind(cmd, vk::PipelineBindPoint::eCompute);
+          const CMArgs args{T[0].address, tInfo, targetImgIdx};
+          const auto g = kernel.groups(tInfo.width, tInfo.height);
+          kernel.dispatch(cmd, args, g[0], g[1]);
+        });
+    colorMapping = orphee::ComputeKernel{D, cmCode, BH, cmSpec};
     /* RT init */
     Tdata = std::make_unique<float[]>(iWidth * iHeight);
 
@@ -327,37 +433,57 @@ public:
 
   ~App() {
     D.h.waitIdle();
+    ORPHEE_TRACE_SAVE("heat_transfer.trace.json", GP.get());
     // ImGui
     ImGui_ImplVulkan_Shutdown();
-    ImGui_ImplSDL2_Shutdown();
+    if (mWindow != nullptr) {
+      ImGui_ImplSDL2_Shutdown();
+    }
     ImGui::DestroyContext();
     // SDL
-    SDL_DestroyWindow(mWindow);
-    SDL_Quit();
+    presentation::destroyWindow(mWindow);
   }
 
   void run() {
+    ORPHEE_TRACE_THREAD("main");
+    presentation::FrameClock clock{.frames = mOptions.frames};
     bool isRunning = true;
     while (isRunning) {
       SDL_Event event;
       while (SDL_PollEvent(&event) != 0) {
-        ImGui_ImplSDL2_ProcessEvent(&event);
+        if (mWindow != nullptr) {
+          ImGui_ImplSDL2_ProcessEvent(&event);
+        }
         if (event.type == SDL_QUIT) {
           isRunning = false;
         }
       }
 
       draw();
+
+      if (clock.tick()) {
+        isRunning = false;
+      }
     }
+    clock.report();
   }
 
 private:
+  [[nodiscard]] std::array<uint32_t, 3>
+  htGroups(const orphee::ComputeKernel &kernel) const {
+    const auto rows = kernel.specialization.at(HT_ROWS);
+    return kernel.groups(tInfo.width, (tInfo.height + rows - 1) / rows);
+  }
+
   void draw() {
+    ORPHEE_ZONE("App::draw");
     ImGui_ImplVulkan_NewFrame();
-    ImGui_ImplSDL2_NewFrame();
+    if (mWindow != nullptr) {
+      ImGui_ImplSDL2_NewFrame();
+    }
     ImGui::NewFrame();
 
-    ImGui::ShowDemoWindow();
+    orphee::ui::gpuProfilerWindow(*GP);
 
     ImGui::Render();
 
@@ -368,45 +494,32 @@ private:
 
     D.h.resetFences(*DrawFence);
 
+    // the initialization copy is complete after the fence wait
+    if (!initSim && Tstaging.allocation != nullptr) {
+      Tstaging.clear();
+      Tstaging = nullptr;
+    }
+
+    DF->update();
+#ifdef ORPHEE_SHADER_COMPILER
+    // rebuilds start from poll, the previous kernels are no longer in use
+    // after the fence wait
+    SCC->poll();
+    htReload->swap(heatTransfer);
+    cmReload->swap(colorMapping);
+#endif
+
     const auto aiR = SC.h.acquireNextImage(UINT64_MAX, ImageAvailable);
     if (aiR.first != vk::Result::eSuccess) {
       throw std::runtime_error("Failed to acquire next image");
     }
     const auto imageIndex = aiR.second;
 
-    /* heat transfer */
-    /* binding 0 - current grid */
-    vk::DescriptorBufferInfo htCurrentInfo{T[TIdx].h, 0, T[TIdx].size};
-    /* binding 1 - target grid */
-    vk::DescriptorBufferInfo htTargetInfo{T[(TIdx + 1) % 2].h, 0,
-                                          T[(TIdx + 1) % 2].size};
-    /****/
-    std::array<vk::DescriptorBufferInfo, 2> htBufferInfos{htCurrentInfo,
-                                                          htTargetInfo};
-    vk::WriteDescriptorSet htWriteDescriptors{
-        htArgs,        0, {}, vk::DescriptorType::eStorageBuffer, {},
-        htBufferInfos, {}};
-
-    D.h.updateDescriptorSets(htWriteDescriptors, {});
-    /* color mapping */
-    /* binding 0 - temperature grid */
-    vk::DescriptorBufferInfo bInfo{T[(TIdx + 1) % 2].h, 0,
-                                   T[(TIdx + 1) % 2].size};
-    vk::WriteDescriptorSet writeBufferDescriptor{
-        cmArgs, 0, {}, vk::DescriptorType::eStorageBuffer, {}, bInfo, {}};
-    /* binding 1 - dst img */
-    vk::DescriptorImageInfo imageInfo{
-        {}, targetImgView, vk::ImageLayout::eGeneral};
-    vk::WriteDescriptorSet writeImageDescriptor{
-        cmArgs, 1, {}, vk::DescriptorType::eStorageImage, imageInfo, {}, {}};
-    /****/
-    std::array<vk::WriteDescriptorSet, 2> cmWriteDescriptors{
-        writeBufferDescriptor, writeImageDescriptor};
-    D.h.updateDescriptorSets(cmWriteDescriptors, {});
-
     vk::CommandBufferBeginInfo beginInfo{
         vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
     CMD.begin(beginInfo);
+    // the previous frame is complete after the fence wait
+    GP->beginFrame(CMD);
 
     if (initSim) {
       vk::BufferMemoryBarrier2 toCopyBufferSrc{
@@ -492,9 +605,13 @@ private:
       CMD.pipelineBarrier2(toCopyToRef);
     }
 
-    vk::BufferCopy2 refToCurCopy{0, 0, Treference.size};
-    vk::CopyBufferInfo2 copyReftoCurInfo{Treference.h, T[TIdx].h, refToCurCopy};
-    CMD.copyBuffer2(copyReftoCurInfo);
+    {
+      const auto scope = GP->scope(CMD, "reset");
+      vk::BufferCopy2 refToCurCopy{0, 0, Treference.size};
+      vk::CopyBufferInfo2 copyReftoCurInfo{Treference.h, T[TIdx].h,
+                                           refToCurCopy};
+      CMD.copyBuffer2(copyReftoCurInfo);
+    }
 
     vk::BufferMemoryBarrier2 toHeatTransferCurrent{
         vk::PipelineStageFlagBits2::eCopy,
@@ -524,12 +641,13 @@ private:
     CMD.pipelineBarrier2(toHeatTransferInfo);
 
     // heat transfer
-    CMD.bindPipeline(vk::PipelineBindPoint::eCompute, heatTransfer);
-    CMD.bindDescriptorSets(vk::PipelineBindPoint::eCompute, htLayout, 0,
-                           *htArgs, {});
-    CMD.pushConstants<TInfo>(htLayout, vk::ShaderStageFlagBits::eCompute, 0,
-                             tInfo);
-    CMD.dispatch(SC.extent.width, SC.extent.height, 1);
+    BH.bind(CMD, vk::PipelineBindPoint::eCompute);
+    {
+      const auto scope = GP->scope(CMD, "heatTransfer");
+      const HTArgs htArgs{T[TIdx].address, T[(TIdx + 1) % 2].address, tInfo};
+      const auto htG = htGroups(heatTransfer);
+      heatTransfer.dispatch(CMD, htArgs, htG[0], htG[1]);
+    }
 
     vk::BufferMemoryBarrier2 toColorMapBuffer{
         vk::PipelineStageFlagBits2::eComputeShader,
@@ -561,13 +679,13 @@ private:
     CMD.pipelineBarrier2(toColorMapInfo);
 
     // color mapping
-    CMD.bindPipeline(vk::PipelineBindPoint::eCompute, colorMapping);
-    CMD.bindDescriptorSets(vk::PipelineBindPoint::eCompute, cmLayout, 0,
-                           *cmArgs, {});
-    CMD.pushConstants<TInfo>(cmLayout, vk::ShaderStageFlagBits::eCompute, 0,
-                             tInfo);
-
-    CMD.dispatch(SC.extent.width, SC.extent.height, 1);
+    {
+      const auto scope = GP->scope(CMD, "colorMapping");
+      const CMArgs cmArgsValues{T[(TIdx + 1) % 2].address, tInfo,
+                                targetImgIdx};
+      const auto cmG = colorMapping.groups(tInfo.width, tInfo.height);
+      colorMapping.dispatch(CMD, cmArgsValues, cmG[0], cmG[1]);
+    }
 
     vk::ImageMemoryBarrier2 toCopyImageSrc{
         vk::PipelineStageFlagBits2::eComputeShader,
@@ -614,9 +732,11 @@ private:
         SC.images[imageIndex], vk::ImageLayout::eTransferDstOptimal,
         copyRegion};
 
-    CMD.copyImage2(copyImageInfo);
+    {
+      const auto scope = GP->scope(CMD, "copyImage");
+      CMD.copyImage2(copyImageInfo);
+    }
 
-    /*
     vk::ImageMemoryBarrier2 toWriteBarrier{
         vk::PipelineStageFlagBits2::eCopy,
         vk::AccessFlagBits2::eTransferWrite,
@@ -639,9 +759,9 @@ private:
         {},
         {},
         {},
-        vk::AttachmentLoadOp::eClear,
+        vk::AttachmentLoadOp::eLoad,
         vk::AttachmentStoreOp::eStore,
-        {{0.0F, 0.0F, 0.0F, 0.0F}}};
+        {}};
     vk::RenderingInfo renderInfo{{},
                                  {{0, 0}, {SC.extent.width, SC.extent.height}},
                                  1,
@@ -650,17 +770,19 @@ private:
                                  {},
                                  {}};
 
-    CMD.beginRendering(renderInfo);
-    ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), *CMD);
-    CMD.endRendering();
-    */
+    {
+      const auto scope = GP->scope(CMD, "imgui");
+      CMD.beginRendering(renderInfo);
+      ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), *CMD);
+      CMD.endRendering();
+    }
 
     vk::ImageMemoryBarrier2 toPresentBarrier{
-        vk::PipelineStageFlagBits2::eCopy,
-        vk::AccessFlagBits2::eTransferWrite,
+        vk::PipelineStageFlagBits2::eColorAttachmentOutput,
+        vk::AccessFlagBits2::eColorAttachmentWrite,
         vk::PipelineStageFlagBits2::eNone,
         vk::AccessFlagBits2::eNone,
-        vk::ImageLayout::eTransferDstOptimal,
+        vk::ImageLayout::eColorAttachmentOptimal,
         vk::ImageLayout::ePresentSrcKHR,
         Q->fIdx,
         Q->fIdx,
@@ -692,6 +814,7 @@ private:
 
   // App
   std::string mName{"Heat Transfer"};
+  presentation::Options mOptions;
   // SDL
   SDL_Window *mWindow;
   // Vulkan
@@ -708,8 +831,9 @@ private:
   vk::raii::Fence DrawFence{nullptr};
   vk::raii::Semaphore ImageAvailable{nullptr};
   vk::raii::Semaphore RenderFinished{nullptr};
-  /* DP */
-  vk::raii::DescriptorPool DP{nullptr};
+  std::unique_ptr<orphee::GpuProfiler> GP;
+  /* bindless */
+  orphee::BindlessHeap BH{nullptr};
   /* RT */
   /* host */
   std::unique_ptr<float[]> Tdata;
@@ -720,16 +844,19 @@ private:
   uint32_t TIdx = 0;
   orphee::vmaImage targetImg{nullptr};
   vk::raii::ImageView targetImgView{nullptr};
+  orphee::BindlessHeap::Index targetImgIdx{};
+  std::unique_ptr<orphee::Defragmenter> DF;
+#ifdef ORPHEE_SHADER_COMPILER
+  std::unique_ptr<orphee::ShaderCompiler> SCC;
+  std::unique_ptr<KernelReload<HTArgs>> htReload;
+  std::unique_ptr<KernelReload<CMArgs>> cmReload;
+#endif
   /* heat transfer */
-  vk::raii::Pipeline heatTransfer{nullptr};
-  vk::raii::PipelineLayout htLayout{nullptr};
-  vk::raii::DescriptorSetLayout htArgsLayout{nullptr};
-  vk::raii::DescriptorSet htArgs{nullptr};
+  orphee::ComputeKernel heatTransfer{nullptr};
+  orphee::Specialization htSpec;
   /* color map */
-  vk::raii::Pipeline colorMapping{nullptr};
-  vk::raii::PipelineLayout cmLayout{nullptr};
-  vk::raii::DescriptorSetLayout cmArgsLayout{nullptr};
-  vk::raii::DescriptorSet cmArgs{nullptr};
+  orphee::ComputeKernel colorMapping{nullptr};
+  orphee::Specialization cmSpec;
   /* ht */
   TInfo tInfo{{}, {}, 0.0F, 1000.0F};
   bool initSim = true;
@@ -737,7 +864,7 @@ private:
 
 int main(int argc, char **argv) {
   try {
-    App sandbox{1080U, 720U};
+    App sandbox{presentation::parse(argc, argv), 1080U, 720U};
     sandbox.run();
   } catch (const std::exception &e) {
     std::cout << e.what() << std::endl;
@@ -8,6 +8,8 @@
 
 #include <orphee/orphee.hpp>
 
+#include "presentation.hpp"
+
 class ImGuiSandox {
 public:
   ImGuiSandox(uint32_t iWidth, uint32_t iHeight) {
@@ -19,7 +21,7 @@ public:
                                    SDL_WINDOW_SHOWN);
 
     // Vulkan
-    VK = orphee::vkManager{{.windowing = true}};
+    VK = orphee::vkManager{presentation::settings(mWindow)};
 
     VkSurfaceKHR surface{};
     SDL_Vulkan_CreateSurface(mWindow, *VK.instance, &surface);
@@ -0,0 +1,229 @@
+#include <algorithm>
+#include <array>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <orphee/orphee.hpp>
+
+constexpr vk::DeviceSize CHUNK_SIZE = 64ULL * 1024ULL * 1024ULL;
+
+struct Result {
+  std::string mode;
+  vk::DeviceSize hotBytes;
+  vk::DeviceSize hotDeviceLocalBytes;
+  vk::DeviceSize coldBytes;
+  double oversubscription;
+  double bandwidth;
+};
+
+// Oversubscribes the device local heap with a hot set of simulation buffers
+// and a cold set of streaming buffers, then measures the copy bandwidth of
+// the hot set while the cold set keeps being touched.
+class MemoryPriority {
+public:
+  MemoryPriority(double oversubscription, uint32_t iterations,
+                 vk::DeviceSize budgetLimit)
+      : mOversubscription{oversubscription}, mIterations{iterations},
+        mBudgetLimit{budgetLimit} {
+    // Vulkan
+    VK = orphee::vkManager{{.windowing = false}};
+
+    auto dR = VK.createDevice({
+        .tag = "main",
+        .count = 1,
+        .capabilities = {vk::QueueFlagBits::eCompute},
+    });
+    if (!dR) {
+      throw std::runtime_error("Failed to create device");
+    }
+    D = std::move(*dR);
+
+    Q = D.queues.at("main0").get();
+    // CMD
+    CP = D.h.createCommandPool(
+        {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, Q->fIdx});
+
+    CMD = std::move(
+        D.h.allocateCommandBuffers({CP, vk::CommandBufferLevel::ePrimary, 1})
+            .front());
+    // SYNC
+    vk::SemaphoreTypeCreateInfo semaphoreTypeInfo{vk::SemaphoreType::eTimeline,
+                                                  0};
+    timelineSemaphore = D.h.createSemaphore({{}, &semaphoreTypeInfo});
+    // queries
+    timestamps = D.h.createQueryPool({{}, vk::QueryType::eTimestamp, 2});
+    timestampPeriod = D.physical.getProperties().limits.timestampPeriod;
+  }
+
+  ~MemoryPriority() { D.h.waitIdle(); }
+
+  Result run(bool usePriority) {
+    Result r{usePriority ? "priority" : "flat", 0, 0, 0, 0.0, 0.0};
+
+    const VkPhysicalDeviceMemoryProperties *memoryProperties{};
+    vmaGetMemoryProperties(D.allocator, &memoryProperties);
+
+    uint32_t heap = 0;
+    for (uint32_t i = 0; i < memoryProperties->memoryHeapCount; ++i) {
+      const auto &h = memoryProperties->memoryHeaps[i];
+      if ((h.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0 &&
+          h.size > memoryProperties->memoryHeaps[heap].size) {
+        heap = i;
+      }
+    }
+
+    vmaSetCurrentFrameIndex(D.allocator, ++frame);
+    std::array<VmaBudget, VK_MAX_MEMORY_HEAPS> budgets{};
+    vmaGetHeapBudgets(D.allocator, budgets.data());
+    // on CPU devices the heap is system memory, cap it to keep the host alive
+    const auto budget = mBudgetLimit != 0
+                            ? std::min(budgets[heap].budget, mBudgetLimit)
+                            : budgets[heap].budget;
+
+    vk::BufferCreateInfo bufferInfo{{},
+                                    CHUNK_SIZE,
+                                    vk::BufferUsageFlagBits::eStorageBuffer |
+                                        vk::BufferUsageFlagBits::eTransferSrc |
+                                        vk::BufferUsageFlagBits::eTransferDst,
+                                    vk::SharingMode::eExclusive,
+                                    {}};
+
+    VmaAllocationCreateInfo flatInfo{};
+    flatInfo.usage = VMA_MEMORY_USAGE_AUTO;
+    /* hot set - half of the budget */
+    const auto hotCount =
+        std::max<vk::DeviceSize>(1, budget / CHUNK_SIZE / 4) * 2;
+    std::vector<orphee::vmaBuffer> hot;
+    hot.reserve(hotCount);
+    for (vk::DeviceSize i = 0; i < hotCount; ++i) {
+      hot.push_back(usePriority
+                        ? D.createBuffer(bufferInfo,
+                                         orphee::ResourceClass::eSimState)
+                        : D.createBuffer(bufferInfo, flatInfo));
+
+      const auto type = hot.back().allocationInfo.memoryType;
+      if ((memoryProperties->memoryTypes[type].propertyFlags &
+           VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0) {
+        r.hotDeviceLocalBytes += CHUNK_SIZE;
+      }
+      r.hotBytes += CHUNK_SIZE;
+    }
+    /* cold set - up to the requested oversubscription */
+    const auto target =
+        static_cast<vk::DeviceSize>(static_cast<double>(budget) *
+                                    mOversubscription);
+    std::vector<orphee::vmaBuffer> cold;
+    while (r.hotBytes + r.coldBytes < target) {
+      try {
+        cold.push_back(usePriority
+                           ? D.createBuffer(bufferInfo,
+                                            orphee::ResourceClass::eStreaming)
+                           : D.createBuffer(bufferInfo, flatInfo));
+      } catch (const std::runtime_error &) {
+        // the heap can not be oversubscribed any further
+        break;
+      }
+      r.coldBytes += CHUNK_SIZE;
+    }
+    r.oversubscription = static_cast<double>(r.hotBytes + r.coldBytes) /
+                         static_cast<double>(budget);
+    /* measure */
+    double seconds = 0.0;
+    for (uint32_t it = 0; it < mIterations; ++it) {
+      CMD.begin({vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+
+      for (const auto &b : cold) {
+        CMD.fillBuffer(b.h, 0, vk::WholeSize, it);
+      }
+
+      CMD.resetQueryPool(timestamps, 0, 2);
+      CMD.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, timestamps,
+                          0);
+      for (size_t i = 0; i + 1 < hot.size(); i += 2) {
+        vk::BufferCopy2 copyRegion{0, 0, CHUNK_SIZE};
+        CMD.copyBuffer2({hot[i].h, hot[i + 1].h, copyRegion});
+      }
+      CMD.writeTimestamp2(vk::PipelineStageFlagBits2::eAllCommands, timestamps,
+                          1);
+
+      CMD.end();
+
+      vk::CommandBufferSubmitInfo cmdSubmit{*CMD};
+      vk::SemaphoreSubmitInfo signalSemaphore{timelineSemaphore, ++timeline, {},
+                                              {}};
+      vk::SubmitInfo2 info{{}, {}, cmdSubmit, signalSemaphore};
+      Q->h.submit2(info);
+
+      std::array<uint64_t, 1> waitValue{timeline};
+      const auto wR =
+          D.h.waitSemaphores({{}, *timelineSemaphore, waitValue}, UINT64_MAX);
+      if (wR != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to wait for semaphore");
+      }
+
+      const auto [qR, ticks] = timestamps.getResults<uint64_t>(
+          0, 2, 2 * sizeof(uint64_t), sizeof(uint64_t),
+          vk::QueryResultFlagBits::e64 | vk::QueryResultFlagBits::eWait);
+      if (qR != vk::Result::eSuccess) {
+        throw std::runtime_error("Failed to read timestamps");
+      }
+      seconds += static_cast<double>(ticks[1] - ticks[0]) * timestampPeriod *
+                 1e-9;
+    }
+
+    const auto copied = static_cast<double>(r.hotBytes / 2) * mIterations;
+    r.bandwidth = copied / seconds / 1e9;
+
+    return r;
+  }
+
+private:
+  double mOversubscription;
+  uint32_t mIterations;
+  vk::DeviceSize mBudgetLimit;
+  // Vulkan
+  orphee::vkManager VK;
+  orphee::Device D;
+  orphee::Queue *Q;
+  /* CMD */
+  vk::raii::CommandPool CP{nullptr};
+  vk::raii::CommandBuffer CMD{nullptr};
+  /* SYNC */
+  vk::raii::Semaphore timelineSemaphore{nullptr};
+  uint64_t timeline = 0;
+  /* queries */
+  vk::raii::QueryPool timestamps{nullptr};
+  float timestampPeriod{};
+  uint32_t frame = 0;
+};
+
+int main(int argc, char **argv) {
+  if (argc > 4) {
+    std::cerr << "Usage: " << argv[0]
+              << " [oversubscription] [iterations] [budget limit MiB]\n";
+    return 1;
+  }
+
+  const double oversubscription = argc > 1 ? std::stod(argv[1]) : 1.25;
+  const uint32_t iterations = argc > 2 ? std::stoul(argv[2]) : 32;
+  const vk::DeviceSize budgetLimit =
+      argc > 3 ? std::stoull(argv[3]) * 1024ULL * 1024ULL : 0;
+
+  try {
+    MemoryPriority bench{oversubscription, iterations, budgetLimit};
+
+    for (const auto usePriority : {false, true}) {
+      const auto r = bench.run(usePriority);
+      std::cout << r.mode << ": hot " << (r.hotBytes >> 20U) << " MiB ("
+                << (r.hotDeviceLocalBytes >> 20U) << " MiB device local), cold "
+                << (r.coldBytes >> 20U) << " MiB, oversubscription "
+                << r.oversubscription << "x, hot copy bandwidth "
+                << r.bandwidth << " GB/s\n";
+    }
+  } catch (const std::exception &e) {
+    std::cout << e.what() << std::endl;
+  }
+
+  return 0;
+}
@@ -2,16 +2,16 @@
 #include <iostream>
 
 #include <SDL.h>
-#include <SDL_vulkan.h>
 
 #define GLM_FORCE_RADIANS
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <orphee/orphee.hpp>
+#include <orphee/shaders.hpp>
 
 #include "mesh/util.hpp"
-#include "shader/util.hpp"
+#include "presentation.hpp"
 
 struct MeshUniform {
   glm::mat4 model;
@@ -21,26 +21,22 @@ struct MeshUniform {
 
 class MeshSandbox {
 public:
-  MeshSandbox(std::string modelPath, uint32_t iWidth, uint32_t iHeight)
-      : mPath{std::move(modelPath)} {
+  MeshSandbox(std::string modelPath, const presentation::Options &options,
+              uint32_t iWidth, uint32_t iHeight)
+      : mOptions{options}, mPath{std::move(modelPath)} {
     /** SDL **/
-    SDL_Init(SDL_INIT_VIDEO);
-    mWindow = SDL_CreateWindow(mName.c_str(), SDL_WINDOWPOS_UNDEFINED,
-                               SDL_WINDOWPOS_UNDEFINED, iWidth, iHeight,
-                               SDL_WINDOW_VULKAN | SDL_WINDOW_ALLOW_HIGHDPI |
-                                   SDL_WINDOW_SHOWN);
+    mWindow = presentation::createWindow(mOptions, mName, iWidth, iHeight);
     /** Vulkan **/
-    VK = orphee::vkManager{{.windowing = true}};
+    VK = orphee::vkManager{presentation::settings(
+        mWindow, {.shaderObjects = true, .pipelineLibraries = true})};
 
-    VkSurfaceKHR surface{};
-    SDL_Vulkan_CreateSurface(mWindow, *VK.instance, &surface);
-    S = vk::raii::SurfaceKHR{VK.instance, surface};
+    S = presentation::createSurface(VK, mWindow);
 
     auto dR = VK.createDevice({
         .tag = "main",
         .count = 1,
         .capabilities = {vk::QueueFlagBits::eGraphics},
-        .surface = surface,
+        .surface = *S,
     });
     if (!dR) {
       throw std::runtime_error("Failed to create device");
@@ -50,11 +46,8 @@ public:
     Q = D.queues.at("main0").get();
 
     uint32_t minInageCount = 2;
-    int dw{};
-    int dh{};
-    SDL_Vulkan_GetDrawableSize(mWindow, &dw, &dh);
-    vk::Extent2D swapchainExtent{static_cast<uint32_t>(dw),
-                                 static_cast<uint32_t>(dh)};
+    const auto swapchainExtent =
+        presentation::extent(mWindow, iWidth, iHeight);
     vk::Format swapchainFormat{vk::Format::eB8G8R8A8Unorm};
     vk::SwapchainCreateInfoKHR swapchainInfo{
         {},
@@ -99,105 +92,50 @@ public:
         1,
         vk::ShaderStageFlagBits::eVertex,
         {}};
-    uboLayout = D.h.createDescriptorSetLayout({{}, uboLayoutBinding});
+    pushDescriptors = D.capabilities.pushDescriptors;
+    uboLayout = D.descriptorSetLayout(
+        {pushDescriptors
+             ? vk::DescriptorSetLayoutCreateFlagBits::ePushDescriptorKHR
+             : vk::DescriptorSetLayoutCreateFlags{},
+         uboLayoutBinding});
 
     /* descriptors */
-    vk::DescriptorPoolSize uboDescriptorPool{vk::DescriptorType::eUniformBuffer,
-                                             1};
-
-    descriptorPool = D.h.createDescriptorPool(
-        {vk::DescriptorPoolCreateFlagBits::eFreeDescriptorSet, 1,
-         uboDescriptorPool});
-
-    meshDescriptorSet = std::move(
-        D.h.allocateDescriptorSets({descriptorPool, *uboLayout}).front());
-
-    /* vertex shader */
-    const auto vertexCode =
-        shader::load(std::filesystem::path{"meshVertex.spv"});
-    const auto vertexModule = D.h.createShaderModule({{}, vertexCode});
-    /* fragment shader */
-    const auto fragmentCode =
-        shader::load(std::filesystem::path{"meshFragment.spv"});
-    const auto fragmentModule = D.h.createShaderModule({{}, fragmentCode});
-    /* shader modules */
-    std::array<vk::PipelineShaderStageCreateInfo, 2> shaderStages{
-        vk::PipelineShaderStageCreateInfo{
-            {}, vk::ShaderStageFlagBits::eVertex, vertexModule, "main", {}},
-        vk::PipelineShaderStageCreateInfo{
-            {}, vk::ShaderStageFlagBits::eFragment, fragmentModule, "main", {}},
-    };
-    /* vertex input */
-    vk::VertexInputBindingDescription bindingDescription{
-        0, sizeof(glm::vec3), vk::VertexInputRate::eVertex};
-    vk::VertexInputAttributeDescription attributeDescription{
-        0, 0, vk::Format::eR32G32B32Sfloat, 0};
-    vk::PipelineVertexInputStateCreateInfo vertexInputInfo{
-        {}, bindingDescription, attributeDescription};
-    /* input assembly */
-    vk::PipelineInputAssemblyStateCreateInfo inputAssemblyInfo{
-        {}, vk::PrimitiveTopology::eTriangleList, vk::False};
-    /* viewport */
-    vk::PipelineViewportStateCreateInfo viewportInfo{{}, 1, {}, 1, {}};
-    /* rasterization  */
-    vk::PipelineRasterizationStateCreateInfo rasterizationInfo{
-        {},
-        vk::False,
-        vk::False,
-        vk::PolygonMode::eFill,
-        vk::CullModeFlagBits::eBack,
-        vk::FrontFace::eCounterClockwise,
-        vk::False,
-        0.0F,
-        0.0F,
-        0.0F,
-        1.0F};
-    /* sampling */
-    vk::PipelineMultisampleStateCreateInfo multisampleInfo{
-        {}, vk::SampleCountFlagBits::e1, vk::False, 1.0F, {}, {}, {}};
-    /* color blending */
-    vk::PipelineColorBlendAttachmentState colorBlendAttachment{
-        vk::False,
-        vk::BlendFactor::eOne,
-        vk::BlendFactor::eZero,
-        vk::BlendOp::eAdd,
-        vk::BlendFactor::eOne,
-        vk::BlendFactor::eZero,
-        vk::BlendOp::eAdd,
-        vk::ColorComponentFlagBits::eR | vk::ColorComponentFlagBits::eG |
-            vk::ColorComponentFlagBits::eB | vk::ColorComponentFlagBits::eA};
-
-    vk::PipelineColorBlendStateCreateInfo colorBlendInfo{
-        {}, vk::False, vk::LogicOp::eCopy, colorBlendAttachment, {}};
-    /* dynamic state */
-    std::array<vk::DynamicState, 2> dynamicStates{vk::DynamicState::eViewport,
-                                                  vk::DynamicState::eScissor};
-    vk::PipelineDynamicStateCreateInfo dynamicStateInfo{{}, dynamicStates};
+    if (!pushDescriptors) {
+      DA = std::make_unique<orphee::DescriptorAllocator>(D);
+      meshDescriptorSet = DA->allocate(uboLayout);
+    }
+
     /* pipeline layout */
-    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{{}, *uboLayout};
-    graphicsLayout = D.h.createPipelineLayout(pipelineLayoutInfo);
-    /* dynamic rendering */
-    vk::PipelineRenderingCreateInfo renderingInfo{{}, SC.format, {}, {}};
-    /* graphics pipeline creation */
-    vk::GraphicsPipelineCreateInfo graphicsInfo{{},
-                                                shaderStages,
-                                                &vertexInputInfo,
-                                                &inputAssemblyInfo,
-                                                {},
-                                                &viewportInfo,
-                                                &rasterizationInfo,
-                                                &multisampleInfo,
-                                                {},
-                                                &colorBlendInfo,
-                                                &dynamicStateInfo,
-                                                graphicsLayout,
-                                                {},
-                                                {},
-                                                {},
-                                                {},
-                                                &renderingInfo};
-
-    graphicsPipeline = D.h.createGraphicsPipeline(nullptr, graphicsInfo);
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo{{}, uboLayout};
+    graphicsLayout = D.pipelineLayout(pipelineLayoutInfo);
+    const auto vertexCode = orphee::shaders::get("meshVertex");
+    const auto fragmentCode = orphee::shaders::get("meshFragment");
+    shaderObjects = D.capabilities.shaderObjects;
+    if (shaderObjects) {
+      /* shader objects, the render state is set when drawing */
+      const std::array<vk::DescriptorSetLayout, 1> setLayouts{uboLayout};
+      meshShaders = orphee::GraphicsShaders{D, vertexCode, fragmentCode,
+                                            setLayouts};
+    } else {
+      meshDesc = orphee::GraphicsPipelineDesc{
+          .vertexCode = {vertexCode.begin(), vertexCode.end()},
+          .fragmentCode = {fragmentCode.begin(), fragmentCode.end()},
+          .layout = graphicsLayout,
+          .vertexBindings = {{0, sizeof(glm::vec3),
+                              vk::VertexInputRate::eVertex}},
+          .vertexAttributes = {{0, 0, vk::Format::eR32G32B32Sfloat, 0}},
+          .colorFormats = {SC.format},
+      };
+      if (D.capabilities.pipelineLibraries) {
+        /* pipeline library, fast-linked before the mesh loads */
+        PL = std::make_unique<orphee::GraphicsPipelineLibrary>(D);
+        meshPipeline = PL->prepare(meshDesc);
+      } else {
+        /* graphics pipeline, compiled while the mesh loads */
+        PC = std::make_unique<orphee::PipelineCompiler>(D);
+        graphicsPipeline = PC->compile(meshDesc);
+      }
+    }
     /* CMD */
     CP = D.h.createCommandPool(
         {vk::CommandPoolCreateFlagBits::eResetCommandBuffer, Q->fIdx});
@@ -226,6 +164,15 @@ public:
     uboAllocateInfo.usage = VMA_MEMORY_USAGE_CPU_TO_GPU;
 
     ubo = D.createBuffer(uboInfo, uboAllocateInfo);
+    // the ubo handle never changes, only its contents are rewritten every
+    // frame, without push descriptors the set is written once
+    if (!pushDescriptors) {
+      vk::DescriptorBufferInfo meshUniformInfo{ubo.h, 0, sizeof(MeshUniform)};
+      vk::WriteDescriptorSet writeDescriptor{
+          meshDescriptorSet, 0, {}, vk::DescriptorType::eUniformBuffer, {},
+          meshUniformInfo,   {}};
+      D.h.updateDescriptorSets(writeDescriptor, {});
+    }
     /* vertex buffer */
     vk::BufferCreateInfo vbStagingInfo{
         {},
@@ -235,12 +182,7 @@ public:
         vk::SharingMode::eExclusive,
         {}};
 
-    VmaAllocationCreateInfo vbStagingAllocateInfo{};
-    vbStagingAllocateInfo.flags =
-        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-    vbStagingAllocateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-
-    vbStaging = D.createBuffer(vbStagingInfo, vbStagingAllocateInfo);
+    vbStaging = D.createBuffer(vbStagingInfo, orphee::ResourceClass::eStaging);
 
     vk::BufferCreateInfo vbInfo{{},
                                 mesh.vertices.size() * sizeof(glm::vec3),
@@ -248,10 +190,7 @@ public:
                                     vk::BufferUsageFlagBits::eTransferDst,
                                 vk::SharingMode::eExclusive,
                                 {}};
-    VmaAllocationCreateInfo vbAllocateInfo{};
-    vbAllocateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-
-    vb = D.createBuffer(vbInfo, vbAllocateInfo);
+    vb = D.createBuffer(vbInfo, orphee::ResourceClass::eStreaming);
 
     vmaCopyMemoryToAllocation(D.allocator, mesh.vertices.data(),
                               vbStaging.allocation, 0,
@@ -265,12 +204,7 @@ public:
         vk::SharingMode::eExclusive,
         {}};
 
-    VmaAllocationCreateInfo ibStagingAllocateInfo{};
-    ibStagingAllocateInfo.flags =
-        VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT;
-    ibStagingAllocateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-
-    ibStaging = D.createBuffer(ibStagingInfo, ibStagingAllocateInfo);
+    ibStaging = D.createBuffer(ibStagingInfo, orphee::ResourceClass::eStaging);
 
     vk::BufferCreateInfo ibInfo{{},
                                 mesh.indices.size() * sizeof(uint32_t),
@@ -279,9 +213,7 @@ public:
                                 vk::SharingMode::eExclusive,
                                 {}};
 
-    VmaAllocationCreateInfo ibAllocateInfo{};
-    ibAllocateInfo.usage = VMA_MEMORY_USAGE_AUTO;
-    ib = D.createBuffer(ibInfo, ibAllocateInfo);
+    ib = D.createBuffer(ibInfo, orphee::ResourceClass::eStreaming);
 
     vmaCopyMemoryToAllocation(D.allocator, mesh.indices.data(),
                               ibStaging.allocation, 0,
@@ -289,6 +221,7 @@ public:
   }
 
   void run() {
+    presentation::FrameClock clock{.frames = mOptions.frames};
     bool isRunning = true;
     while (isRunning) {
       SDL_Event event;
@@ -298,18 +231,27 @@ public:
         }
       }
       draw();
+
+      if (clock.tick()) {
+        isRunning = false;
+      }
     }
+    clock.report();
   }
 
   ~MeshSandbox() {
     D.h.waitIdle();
 
-    SDL_DestroyWindow(mWindow);
-    SDL_Quit();
+    presentation::destroyWindow(mWindow);
   }
 
 private:
   void draw() {
+    // rethrows the compilation error instead of drawing empty frames
+    if (graphicsPipeline.failed()) {
+      graphicsPipeline.wait();
+    }
+
     const auto wfR = D.h.waitForFences(*DrawFence, vk::True, UINT64_MAX);
     if (wfR != vk::Result::eSuccess) {
       throw std::runtime_error("Failed to wait for fence");
@@ -335,12 +277,6 @@ private:
     vmaCopyMemoryToAllocation(D.allocator, &meshUniform, ubo.allocation, 0,
                               sizeof(MeshUniform));
 
-    vk::DescriptorBufferInfo meshUniformInfo{ubo.h, 0, sizeof(MeshUniform)};
-    vk::WriteDescriptorSet writeDescriptor{
-        meshDescriptorSet, 0, {}, vk::DescriptorType::eUniformBuffer, {},
-        meshUniformInfo,   {}};
-    D.h.updateDescriptorSets(writeDescriptor, {});
-
     vk::CommandBufferBeginInfo beginInfo{
         vk::CommandBufferUsageFlagBits::eOneTimeSubmit};
     CMD.begin(beginInfo);
@@ -386,25 +322,51 @@ private:
                                  {}};
 
     CMD.beginRendering(renderInfo);
-    CMD.bindPipeline(vk::PipelineBindPoint::eGraphics, graphicsPipeline);
-    CMD.bindVertexBuffers(0, vb.h, {0});
-    CMD.bindIndexBuffer(ib.h, 0, vk::IndexType::eUint32);
+    bool drawable = true;
+    if (shaderObjects) {
+      meshShaders.bind(CMD);
+      orphee::setRenderState(CMD, meshState, SC.extent);
+    } else {
+      // the mesh is not drawn until its pipeline is compiled
+      const auto pipeline = PL ? PL->get(meshPipeline) : graphicsPipeline.get();
+      drawable = static_cast<bool>(pipeline);
+      if (drawable) {
+        CMD.bindPipeline(vk::PipelineBindPoint::eGraphics, pipeline);
+      }
 
-    vk::Viewport viewport{0.0F,
-                          0.0F,
-                          static_cast<float>(SC.extent.width),
-                          static_cast<float>(SC.extent.height),
-                          0.0F,
-                          1.0F};
-    CMD.setViewport(0, viewport);
+      vk::Viewport viewport{0.0F,
+                            0.0F,
+                            static_cast<float>(SC.extent.width),
+                            static_cast<float>(SC.extent.height),
+                            0.0F,
+                            1.0F};
+      CMD.setViewport(0, viewport);
 
-    vk::Rect2D scissor{{0, 0}, SC.extent};
-    CMD.setScissor(0, scissor);
+      vk::Rect2D scissor{{0, 0}, SC.extent};
+      CMD.setScissor(0, scissor);
+    }
+    CMD.bindVertexBuffers(0, vb.h, {0});
+    CMD.bindIndexBuffer(ib.h, 0, vk::IndexType::eUint32);
 
-    CMD.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, graphicsLayout, 0,
-                           *meshDescriptorSet, {});
+    if (pushDescriptors) {
+      vk::DescriptorBufferInfo meshUniformInfo{ubo.h, 0, sizeof(MeshUniform)};
+      orphee::pushDescriptors(
+          CMD, vk::PipelineBindPoint::eGraphics, graphicsLayout, 0,
+          vk::WriteDescriptorSet{{},
+                                 0,
+                                 {},
+                                 vk::DescriptorType::eUniformBuffer,
+                                 {},
+                                 meshUniformInfo,
+                                 {}});
+    } else {
+      CMD.bindDescriptorSets(vk::PipelineBindPoint::eGraphics, graphicsLayout,
+                             0, meshDescriptorSet, {});
+    }
 
-    CMD.drawIndexed(mesh.indices.size(), 1, 0, 0, 0);
+    if (drawable) {
+      CMD.drawIndexed(mesh.indices.size(), 1, 0, 0, 0);
+    }
 
     CMD.endRendering();
 
@@ -445,6 +407,7 @@ private:
 
   /** App **/
   std::string mName{"Mesh sandbox"};
+  presentation::Options mOptions;
   /** SDL **/
   SDL_Window *mWindow;
   /** Vulkan **/
@@ -454,12 +417,24 @@ private:
   orphee::Swapchain SC;
   orphee::Queue *Q;
   /* CMD STATE */
-  vk::raii::DescriptorPool descriptorPool{nullptr};
-  vk::raii::DescriptorSet meshDescriptorSet{nullptr};
+  bool pushDescriptors = false;
+  std::unique_ptr<orphee::DescriptorAllocator> DA;
+  vk::DescriptorSet meshDescriptorSet{};
   /* Graphics */
-  vk::raii::DescriptorSetLayout uboLayout{nullptr};
-  vk::raii::PipelineLayout graphicsLayout{nullptr};
-  vk::raii::Pipeline graphicsPipeline{nullptr};
+  vk::DescriptorSetLayout uboLayout{};
+  vk::PipelineLayout graphicsLayout{};
+  std::unique_ptr<orphee::PipelineCompiler> PC;
+  orphee::PipelineHandle graphicsPipeline{nullptr};
+  std::unique_ptr<orphee::GraphicsPipelineLibrary> PL;
+  orphee::GraphicsPipelineLibrary::Handle meshPipeline{};
+  orphee::GraphicsPipelineDesc meshDesc;
+  bool shaderObjects = false;
+  orphee::GraphicsShaders meshShaders{nullptr};
+  orphee::RenderState meshState{
+      .vertexBindings = {{0, sizeof(glm::vec3), vk::VertexInputRate::eVertex,
+                          1}},
+      .vertexAttributes = {{0, 0, vk::Format::eR32G32B32Sfloat, 0}},
+  };
   /* CMD */
   vk::raii::CommandPool CP{nullptr};
   vk::raii::CommandBuffer CMD{nullptr};
@@ -481,13 +456,15 @@ private:
 };
 
 int main(int argc, char **argv) {
-  if (argc != 2) {
-    std::cerr << "Usage: " << argv[0] << " <usd file>\n";
+  if (argc < 2) {
+    std::cerr << "Usage: " << argv[0]
+              << " <usd file> [--headless] [--frames N]\n";
     return 1;
   }
 
   try {
-    MeshSandbox sandbox{std::string(argv[1]), 1080U, 720U};
+    MeshSandbox sandbox{std::string(argv[1]),
+                        presentation::parse(argc, argv, 2), 1080U, 720U};
     sandbox.run();
   } catch (const std::exception &e) {
     std::cout << e.what() << std::endl;
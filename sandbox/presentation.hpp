@@ -0,0 +1,141 @@
+#pragma once
+
+#include <chrono>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <SDL.h>
+#include <SDL_vulkan.h>
+
+#include <orphee/orphee.hpp>
+
+// Window or VK_EXT_headless_surface presentation shared by the sandboxes.
+// Headless runs the same acquire, render and present loop without a display
+// server, e.g. on lavapipe.
+namespace presentation {
+struct Options {
+  // --headless
+  bool headless = false;
+  // --frames N, stops after N frames and prints the average frame time,
+  // 0 runs until quit
+  uint32_t frames = 0;
+};
+
+// arguments from first on
+inline Options parse(int argc, char **argv, int first = 1) {
+  Options o;
+  for (int i = first; i < argc; ++i) {
+    const std::string_view arg{argv[i]};
+    if (arg == "--headless") {
+      o.headless = true;
+    } else if (arg == "--frames" && i + 1 < argc) {
+      o.frames = static_cast<uint32_t>(std::stoul(argv[++i]));
+    } else {
+      throw std::runtime_error("Unknown argument " + std::string{arg});
+    }
+  }
+
+  return o;
+}
+
+// null when headless, SDL_QUIT still comes from SIGINT
+inline SDL_Window *createWindow(const Options &o, const std::string &name,
+                                uint32_t width, uint32_t height) {
+  if (o.headless) {
+    SDL_Init(SDL_INIT_EVENTS);
+    return nullptr;
+  }
+
+  SDL_Init(SDL_INIT_VIDEO);
+  auto *window = SDL_CreateWindow(
+      name.c_str(), SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+      static_cast<int>(width), static_cast<int>(height),
+      SDL_WINDOW_VULKAN | SDL_WINDOW_ALLOW_HIGHDPI | SDL_WINDOW_SHOWN);
+  if (window == nullptr) {
+    throw std::runtime_error(std::string{"Failed to create window: "} +
+                             SDL_GetError());
+  }
+
+  return window;
+}
+
+// windowing with the surface extensions SDL needs for window, headless
+// without one
+inline orphee::Settings settings(SDL_Window *window, orphee::Settings s = {}) {
+  s.windowing = true;
+  s.headless = window == nullptr;
+  if (window != nullptr) {
+    unsigned int count = 0;
+    SDL_Vulkan_GetInstanceExtensions(window, &count, nullptr);
+    std::vector<const char *> names(count);
+    SDL_Vulkan_GetInstanceExtensions(window, &count, names.data());
+    s.surfaceExtensions.assign(names.begin(), names.end());
+  }
+
+  return s;
+}
+
+inline vk::raii::SurfaceKHR createSurface(const orphee::vkManager &VK,
+                                         SDL_Window *window) {
+  if (window == nullptr) {
+    return VK.createHeadlessSurface();
+  }
+
+  VkSurfaceKHR surface{};
+  if (SDL_Vulkan_CreateSurface(window, *VK.instance, &surface) != SDL_TRUE) {
+    throw std::runtime_error(std::string{"Failed to create surface: "} +
+                             SDL_GetError());
+  }
+
+  return vk::raii::SurfaceKHR{VK.instance, surface};
+}
+
+// the drawable size of window, width and height when headless
+inline vk::Extent2D extent(SDL_Window *window, uint32_t width,
+                           uint32_t height) {
+  if (window == nullptr) {
+    return {width, height};
+  }
+
+  int dw{};
+  int dh{};
+  SDL_Vulkan_GetDrawableSize(window, &dw, &dh);
+
+  return {static_cast<uint32_t>(dw), static_cast<uint32_t>(dh)};
+}
+
+inline void destroyWindow(SDL_Window *window) {
+  if (window != nullptr) {
+    SDL_DestroyWindow(window);
+  }
+  SDL_Quit();
+}
+
+// counts presented frames against Options::frames
+struct FrameClock {
+  // true once the requested frames are presented
+  [[nodiscard]] bool tick() {
+    ++count;
+    return frames != 0 && count >= frames;
+  }
+
+  // average frame time since start, when frames were requested
+  void report() const {
+    if (frames == 0 || count == 0) {
+      return;
+    }
+    const auto ms = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    std::cout << count << " frames, " << ms / count << " ms per frame\n";
+  }
+
+  uint32_t frames = 0;
+  uint32_t count = 0;
+  std::chrono::steady_clock::time_point start{
+      std::chrono::steady_clock::now()};
+};
+} // namespace presentation
@@ -5,6 +5,8 @@
 
 #include <orphee/orphee.hpp>
 
+#include "presentation.hpp"
+
 class Sandbox {
 public:
   Sandbox(std::string appName, uint32_t iWidth, uint32_t iHeight)
@@ -17,7 +19,7 @@ public:
                                    SDL_WINDOW_SHOWN);
 
     // Vulkan
-    VK = orphee::vkManager{{.windowing = true}};
+    VK = orphee::vkManager{presentation::settings(mWindow)};
 
     VkSurfaceKHR surface{};
     SDL_Vulkan_CreateSurface(mWindow, *VK.instance, &surface);
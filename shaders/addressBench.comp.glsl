@@ -0,0 +1,18 @@
+#version 460
+#extension GL_EXT_buffer_reference : require
+
+layout (local_size_x = 64) in;
+
+layout(buffer_reference, std430, buffer_reference_align = 4) buffer Counters
+{
+  uint counters[];
+};
+
+layout(push_constant) uniform Args {
+    Counters slice;
+};
+
+void main()
+{
+    slice.counters[gl_GlobalInvocationID.x] += 1;
+}
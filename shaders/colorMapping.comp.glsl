@@ -1,18 +1,25 @@
 #version 460
+#extension GL_EXT_buffer_reference : require
 
-layout(push_constant) uniform TInfo {
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer Temperatures
+{
+  float T[];
+};
+
+// workgroup size tuned at startup, 16x16 by default
+layout(local_size_x = 16, local_size_y = 16, local_size_x_id = 0, local_size_y_id = 1) in;
+
+layout(push_constant) uniform Args {
+    Temperatures temperatures;
     uint width;
     uint height;
     float minTemperature;
     float maxTemperature;
+    uint image;
 };
 
-layout (set = 0, binding = 0) buffer Temperatures
-{
-  float T[];
-};
-
-layout(set = 0, rgba8, binding = 1) uniform writeonly image2D image;
+// bindless heap storage images
+layout(set = 0, rgba8, binding = 1) uniform writeonly image2D images[];
 
 vec4 temperatureToColor(float temperature) {
     vec4 blue = vec4(0.0, 0.0, 1.0, 1.0);
@@ -32,14 +39,14 @@ vec4 temperatureToColor(float temperature) {
 void main()
 {
     ivec2 pixelCoords = ivec2(gl_GlobalInvocationID.xy);
-    ivec2 size = imageSize(image);
+    ivec2 size = imageSize(images[image]);
 
     if(pixelCoords.x < size.x && pixelCoords.y < size.y)
     {
-        float temperature = T[pixelCoords.y * size.x + pixelCoords.x];
+        float temperature = temperatures.T[pixelCoords.y * size.x + pixelCoords.x];
         float normalizedTemperature = (temperature - minTemperature) / (maxTemperature - minTemperature);
 
         vec4 color = temperatureToColor(normalizedTemperature);
-        imageStore(image, pixelCoords, color);
+        imageStore(images[image], pixelCoords, color);
     }
 }
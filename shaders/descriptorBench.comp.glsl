@@ -0,0 +1,13 @@
+#version 460
+
+layout (local_size_x = 64) in;
+
+layout(set = 0, binding = 0) buffer Counters
+{
+  uint counters[];
+};
+
+void main()
+{
+    counters[gl_GlobalInvocationID.x] += 1;
+}
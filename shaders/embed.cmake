@@ -0,0 +1,28 @@
+# Writes the SPIR-V module SPV to HEADER as orphee::shaders::NAME
+file(READ ${SPV} HEX HEX)
+string(LENGTH "${HEX}" LENGTH)
+math(EXPR WORDS "${LENGTH} / 8")
+math(EXPR REMAINDER "${LENGTH} % 8")
+if(WORDS EQUAL 0 OR NOT REMAINDER EQUAL 0)
+    message(FATAL_ERROR "${SPV} is not a SPIR-V module")
+endif()
+
+# SPIR-V words are little endian
+string(REGEX REPLACE "(..)(..)(..)(..)" "0x\\4\\3\\2\\1U, " CODE "${HEX}")
+string(REPEAT "0x[0-9a-f]+U, " 6 LINE)
+string(REGEX REPLACE "(${LINE})" "\\1\n    " CODE "${CODE}")
+string(REPLACE ", \n" ",\n" CODE "${CODE}")
+string(STRIP "${CODE}" CODE)
+string(REGEX REPLACE ",$" "" CODE "${CODE}")
+
+file(WRITE ${HEADER} "// generated from ${NAME}.spv, do not edit
+#pragma once
+
+#include <array>
+#include <cstdint>
+
+namespace orphee::shaders {
+inline constexpr std::array<uint32_t, ${WORDS}> ${NAME}{
+    ${CODE}};
+} // namespace orphee::shaders
+")
@@ -1,43 +1,63 @@
 #version 460
+#extension GL_EXT_buffer_reference : require
+#extension GL_EXT_control_flow_attributes : require
 
-layout(push_constant) uniform TInfo {
-    int width;
-    int height;
-    float minTemperature;
-    float maxTemperature;
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer TCurrent
+{
+  float currentT[];
 };
 
-layout (set = 0, binding = 0) buffer TCurrent
+layout(buffer_reference, std430, buffer_reference_align = 4) writeonly buffer TTarget
 {
-  readonly float currentT[];
+  float targetT[];
 };
 
-layout (set = 0, binding = 1) buffer TTarget
-{
-  writeonly float targetT[];
+layout(local_size_x = 16, local_size_y = 16, local_size_x_id = 0, local_size_y_id = 1) in;
+// consecutive rows computed by an invocation, tuned with the workgroup size
+layout(constant_id = 2) const uint ROWS = 1;
+
+layout(push_constant) uniform Args {
+    TCurrent current;
+    TTarget target;
+    uint width;
+    uint height;
+    float minTemperature;
+    float maxTemperature;
 };
 
 void main()
 {
     int x = int(gl_GlobalInvocationID.x);
-    int y = int(gl_GlobalInvocationID.y);
+    int w = int(width);
+    int h = int(height);
+
+    if (x >= w) {
+        return;
+    }
 
     int left = (x > 0) ? x - 1 : 0;
-    int right = (x < width - 1) ? x + 1 : width - 1;
-
-    int top = (y > 0) ? y - 1 : 0;
-    int bottom = (y < height - 1) ? y + 1 : height - 1;
-
-    int offset = x + y * width;
-    int offsetLeft = left + y * width;
-    int offsetRight = right + y * width;
-    int offsetTop = x + top * width;
-    int offsetBottom = x + bottom * width;
-    // offset diagonals
-    int offsetTopLeft = left + top * width;
-    int offsetTopRight = right + top * width;
-    int offsetBottomLeft = left + bottom * width;
-    int offsetBottomRight = right + bottom * width;
-
-    targetT[offset] = currentT[offset] + .025 * ((currentT[offsetTop] + currentT[offsetBottom] + currentT[offsetLeft] + currentT[offsetRight] + currentT[offsetTopLeft] + currentT[offsetTopRight] + currentT[offsetBottomLeft] + currentT[offsetBottomRight]) - (currentT[offset] * 8.0));
+    int right = (x < w - 1) ? x + 1 : w - 1;
+
+    [[unroll]] for (uint r = 0; r < ROWS; ++r) {
+        int y = int(gl_GlobalInvocationID.y * ROWS + r);
+        if (y >= h) {
+            return;
+        }
+
+        int top = (y > 0) ? y - 1 : 0;
+        int bottom = (y < h - 1) ? y + 1 : h - 1;
+
+        int offset = x + y * w;
+        int offsetLeft = left + y * w;
+        int offsetRight = right + y * w;
+        int offsetTop = x + top * w;
+        int offsetBottom = x + bottom * w;
+        // offset diagonals
+        int offsetTopLeft = left + top * w;
+        int offsetTopRight = right + top * w;
+        int offsetBottomLeft = left + bottom * w;
+        int offsetBottomRight = right + bottom * w;
+
+        target.targetT[offset] = current.currentT[offset] + .025 * ((current.currentT[offsetTop] + current.currentT[offsetBottom] + current.currentT[offsetLeft] + current.currentT[offsetRight] + current.currentT[offsetTopLeft] + current.currentT[offsetTopRight] + current.currentT[offsetBottomLeft] + current.currentT[offsetBottomRight]) - (current.currentT[offset] * 8.0));
+    }
 }
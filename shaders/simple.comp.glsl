@@ -1,6 +1,7 @@
 #version 460
 
-layout (local_size_x = 16, local_size_y = 16) in;
+// workgroup size tuned at startup, 16x16 by default
+layout (local_size_x = 16, local_size_y = 16, local_size_x_id = 0, local_size_y_id = 1) in;
 
 layout(rgba16f,set = 0, binding = 0) uniform image2D image;
 